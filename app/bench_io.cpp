@@ -0,0 +1,49 @@
+#include "io.hpp"
+#include <chrono>
+
+/**
+ * @brief Measures how fast each input is read through open_source(), which
+ * detects the compression format from its magic bytes.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <filename> [filename...]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Formats built in:";
+    for (const auto& decompressor : decompressors())
+        if (decompressor.open)
+            std::cout << " " << decompressor.name;
+    std::cout << std::endl;
+
+    std::vector<char> buffer(IO_BUFFER_SIZE);
+    int status = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string filename = argv[i];
+        const Decompressor* decompressor = detect_compression(filename);
+        std::string format = decompressor ? decompressor->name : "raw";
+        // BGZF is gzip too, but its blocks are inflated in parallel
+        if (format == "gzip" && is_bgzf(filename))
+            format = "bgzf";
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<ByteSource> source = open_source(filename);
+        if (!source || !source->is_open()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            status = 1;
+            continue;
+        }
+        std::uint64_t bytes = 0;
+        while (std::size_t got = source->read(buffer.data(), buffer.size()))
+            bytes += got;
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end_time - start_time).count();
+        std::cout << filename << " [" << format << "]: " << bytes << " bytes in "
+                  << static_cast<long>(seconds * 1000) << " ms, "
+                  << (seconds > 0 ? bytes / seconds / 1e6 : 0) << " MB/s" << std::endl;
+    }
+
+    return status;
+}
@@ -0,0 +1,204 @@
+#include "../utils/myRS/myRSmodule.cpp"
+#include <bit>
+#include <chrono>
+#include <string>
+
+/**
+ * @brief xoshiro256** generator, seeded through splitmix64, so runs are repeatable.
+ */
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) {
+        for (auto& word : state) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        const uint64_t result = std::rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = std::rotl(state[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Draw a number below bound without modulo bias worth measuring.
+     * @param bound Exclusive upper limit.
+     * @return A number in [0, bound).
+     */
+    uint64_t below(uint64_t bound) { return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * bound) >> 64); }
+
+private:
+    std::array<uint64_t, 4> state;
+};
+
+/**
+ * @brief One point of the sweep.
+ */
+struct BenchCase {
+    unsigned int power;  ///< Field GF(2^power).
+    int k;               ///< Data symbols per codeword.
+    int nsym;            ///< Parity symbols per codeword.
+    int errors;          ///< Symbols changed at unknown positions.
+    int erasures;        ///< Symbols changed at positions given to the decoder.
+};
+
+/**
+ * @brief Measure one case and print it as a JSON object.
+ * @tparam T Symbol type wide enough for the field.
+ * @param c The case.
+ * @param codewords Number of codewords to encode and decode.
+ * @param rng Random source for data and damage.
+ */
+template <typename T>
+void run_case(const BenchCase& c, size_t codewords, Xoshiro256& rng) {
+    using clock = std::chrono::steady_clock;
+    const ReedSolomon<T> rs(c.power);
+    const size_t n = c.k + c.nsym;
+    const T mask = static_cast<T>(rs.gf.size() - 1);
+
+    std::vector<T> sent(codewords * n);
+    for (size_t i = 0; i < codewords; ++i)
+        for (int j = 0; j < c.k; ++j)
+            sent[i * n + j] = static_cast<T>(rng.next()) & mask;
+
+    auto start = clock::now();
+    for (size_t i = 0; i < codewords; ++i) {
+        std::span<T> codeword(sent.data() + i * n, n);
+        rs.encode(codeword.first(c.k), codeword.last(c.nsym), c.nsym);
+    }
+    const double encode_seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    // Damage distinct positions: the first erasures are reported, the rest are errors
+    std::vector<T> received(sent);
+    std::vector<std::vector<unsigned int>> erasures(codewords);
+    std::vector<unsigned int> positions(n);
+    for (size_t i = 0; i < codewords; ++i) {
+        for (size_t p = 0; p < n; ++p)
+            positions[p] = static_cast<unsigned int>(p);
+        for (int d = 0; d < c.errors + c.erasures; ++d) {
+            std::swap(positions[d], positions[d + rng.below(n - d)]);
+            T& symbol = received[i * n + positions[d]];
+            symbol ^= static_cast<T>(1 + rng.below(mask));
+            if (d < c.erasures)
+                erasures[i].push_back(positions[d]);
+        }
+    }
+
+    std::vector<uint64_t> latency(codewords);
+    std::vector<T> decoded(n);
+    size_t decoded_ok = 0, miscorrected = 0;
+    start = clock::now();
+    for (size_t i = 0; i < codewords; ++i) {
+        auto begin = clock::now();
+        bool ok = rs.decode(decoded.data(), nullptr, received.data() + i * n, c.k, c.nsym, erasures[i], false);
+        latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count();
+        if (ok && std::equal(decoded.begin(), decoded.end(), sent.begin() + i * n))
+            decoded_ok++;
+        else if (ok)
+            miscorrected++;
+    }
+    const double decode_seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    // Latency histogram in powers of two: bucket b counts decodes under 2^b ns
+    std::array<size_t, 64> buckets{};
+    for (uint64_t ns : latency)
+        buckets[std::bit_width(ns)]++;
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](double q) { return latency[std::min(codewords - 1, static_cast<size_t>(q * codewords))]; };
+
+    const double bytes = static_cast<double>(codewords) * c.k * c.power / 8;
+    std::cout << "    {\"field\": " << c.power << ", \"n\": " << n << ", \"k\": " << c.k << ", \"nsym\": " << c.nsym
+              << ", \"errors\": " << c.errors << ", \"erasures\": " << c.erasures << ", \"codewords\": " << codewords << ",\n"
+              << "     \"encode\": {\"mb_per_s\": " << bytes / encode_seconds / 1e6
+              << ", \"codewords_per_s\": " << codewords / encode_seconds << "},\n"
+              << "     \"decode\": {\"mb_per_s\": " << bytes / decode_seconds / 1e6
+              << ", \"codewords_per_s\": " << codewords / decode_seconds
+              << ", \"success_rate\": " << static_cast<double>(decoded_ok) / codewords
+              << ", \"miscorrection_rate\": " << static_cast<double>(miscorrected) / codewords << ",\n"
+              << "      \"latency_ns\": {\"p50\": " << percentile(0.5) << ", \"p99\": " << percentile(0.99)
+              << ", \"max\": " << latency.back() << ", \"histogram\": [";
+    bool first = true;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        if (buckets[b] == 0)
+            continue;
+        std::cout << (first ? "" : ", ") << "{\"below\": " << (uint64_t{1} << b) << ", \"count\": " << buckets[b] << "}";
+        first = false;
+    }
+    std::cout << "]}}}";
+}
+
+/**
+ * @brief Sweeps field size, code shape and damage, and prints encode and decode
+ * throughput, latency and success rate as JSON.
+ */
+int main(int argc, char* argv[]) {
+    size_t codewords = 2000;
+    uint64_t seed = 1;
+    std::vector<unsigned int> fields;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--codewords" && i + 1 < argc) {
+            codewords = std::stoul(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--field" && i + 1 < argc) {
+            fields.push_back(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--codewords N] [--seed S] [--field POWER]..." << std::endl;
+            return 1;
+        }
+    }
+    if (codewords == 0)
+        codewords = 1;
+    if (fields.empty())
+        fields = {4, 8, 12, 16};
+
+    // Code shapes per field: short and full-length codewords, light to heavy redundancy
+    const std::map<unsigned int, std::vector<std::pair<int, int>>> shapes = {
+        {4, {{11, 4}, {7, 8}}},
+        {8, {{32, 16}, {239, 16}, {223, 32}, {191, 64}}},
+        {12, {{991, 32}, {895, 128}}},
+        {16, {{4032, 64}, {16128, 256}}},
+    };
+
+    std::vector<BenchCase> cases;
+    for (unsigned int power : fields) {
+        auto it = shapes.find(power);
+        if (it == shapes.end()) {
+            std::cerr << "No code shapes for GF(2^" << power << ")" << std::endl;
+            return 1;
+        }
+        // Clean, within the 2e + f <= nsym bound, and one error past it
+        for (auto [k, nsym] : it->second) {
+            int t = nsym / 2;
+            for (auto [errors, erasures] : {std::pair{0, 0}, {t / 2, 0}, {t, 0}, {0, nsym}, {t / 2, t}, {t + 1, 0}})
+                cases.push_back({power, k, nsym, errors, erasures});
+        }
+    }
+
+    Xoshiro256 rng(seed);
+    std::cout << "{\"seed\": " << seed << ", \"kernel\": " << static_cast<int>(gf256::best_kernel()) << ", \"cases\": [\n";
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const BenchCase& c = cases[i];
+        // Keep the slow, wide codes to a similar amount of work as the small ones
+        const size_t work = static_cast<size_t>(c.k + c.nsym) * c.nsym;
+        const size_t count = std::max<size_t>(1, std::min(codewords, (codewords * 255 * 32) / work));
+        if (c.power <= 8)
+            run_case<uint8_t>(c, count, rng);
+        else
+            run_case<uint16_t>(c, count, rng);
+        std::cout << (i + 1 < cases.size() ? ",\n" : "\n");
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -2,12 +2,28 @@
 #include <chrono>
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
+    bool direct = false, inner = false;
+    int first = 1;
+    for (; first < argc; ++first) {
+        const std::string option = argv[first];
+        if (option == "--direct")
+            direct = true;
+        else if (option == "--inner")
+            inner = true;
+        else
+            break;
+    }
+    if (argc <= first) {
+        std::cerr << "Usage: " << argv[0] << " [--direct] [--inner] <filename> [lane...]" << std::endl;
         return 1;
     }
-    const std::string filename = argv[1];
+    const std::string filename = argv[first];
     Codec codec(filename);
+    codec.set_direct_io(direct);
+    if (inner)
+        codec.set_inner_code();
+    for (int i = first + 1; i < argc; ++i)
+        codec.add_lane(argv[i]);
     codec.print_info();
     auto start_time = std::chrono::high_resolution_clock::now();
     codec.decode(); // also writes
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <deque>
+#include <future>
+#include "io.hpp"
+#include "qc.hpp"
+#include "records.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Reads a batch of sequences stored back to back in one buffer.
+ */
+struct ReadBatch {
+    std::string seqs;               ///< Concatenated sequences.
+    std::vector<uint32_t> ends;     ///< End offset of each sequence in seqs.
+};
+
+QCStats accumulate(const ReadBatch& batch) {
+    QCStats stats;
+    uint32_t begin = 0;
+    for (uint32_t end : batch.ends) {
+        stats.add(std::string_view(batch.seqs).substr(begin, end - begin));
+        begin = end;
+    }
+    return stats;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <filename>..." << std::endl;
+        return 1;
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    ThreadPool& pool = ThreadPool::shared();
+    QCStats total;
+    std::deque<std::future<QCStats>> pending;
+
+    // Every file is a lane of the same run; records are views into the reader's buffers
+    RecordReader reader(std::vector<std::string>(argv + 1, argv + argc));
+    if (!reader.is_open())
+        return 1;
+
+    ReadBatch batch;
+    std::vector<Record> records;
+    while (reader.next_batch(records)) {
+        for (const auto& record : records) {
+            batch.seqs.append(record.seq);
+            batch.ends.push_back(static_cast<uint32_t>(batch.seqs.size()));
+        }
+
+        // The views are only valid until the next batch, so the sequences are copied for the workers
+        pending.push_back(pool.submit([b = std::move(batch)] { return accumulate(b); }));
+        batch = ReadBatch{};
+        // Keep a bounded number of batches in flight so memory stays constant
+        while (pending.size() > 2 * pool.size()) {
+            total.merge(pending.front().get());
+            pending.pop_front();
+        }
+    }
+
+    for (auto& result : pending)
+        total.merge(result.get());
+
+    total.print(std::cout);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout <<  "Elapsed Time " << duration.count() << " ms" << std::endl;
+
+    return 0;
+}
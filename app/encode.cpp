@@ -2,18 +2,46 @@
 #include <chrono>
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
+    bool direct = false, fountain = false, inner = false, stats = false;
+    int first = 1;
+    for (; first < argc - 1; ++first) {
+        const std::string option = argv[first];
+        if (option == "--direct")
+            direct = true;
+        else if (option == "--fountain")
+            fountain = true;
+        else if (option == "--inner")
+            inner = true;
+        else if (option == "--stats")
+            stats = true;
+        else
+            break;
+    }
+    if (first != argc - 1) {
+        std::cerr << "Usage: " << argv[0] << " [--direct] [--fountain] [--inner] [--stats] <filename>" << std::endl;
         return 1;
     }
-    const std::string filename = argv[1];
+    const std::string filename = argv[argc - 1];
     Codec codec(filename);
+    codec.set_direct_io(direct);
+    if (fountain)
+        codec.set_fountain();
+    if (inner)
+        codec.set_inner_code();
     codec.print_info();
     auto start_time = std::chrono::high_resolution_clock::now();
-    codec.encode();
+    // Fountain mode needs the whole file in memory; otherwise the stages stream group by group
+    std::vector<StageStats> stages;
+    if (fountain) {
+        codec.encode();
+        //codec.oligodump();
+        codec.write_duplex();
+    } else if (!codec.encode_pipelined(&stages)) {
+        return 1;
+    }
     auto end_time = std::chrono::high_resolution_clock::now();
-    //codec.oligodump();
-    codec.write_duplex();
+    if (stats)
+        print_stage_stats(std::cout, stages);
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
     std::cout <<  "Elapsed Time " << duration.count() << " ms" << std::endl;
 
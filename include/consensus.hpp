@@ -0,0 +1,57 @@
+/**
+ * @file consensus.hpp
+ * @brief Trace reconstruction: recover an oligo from several noisy reads of it.
+ */
+#ifndef CONSENSUS_HPP
+#define CONSENSUS_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include "utils.hpp"
+
+class ThreadPool;
+
+/**
+ * @brief Group reads that are likely copies of the same oligo.
+ *
+ * Reads are indexed by their minimizers; each read is compared only against the
+ * clusters it shares minimizers with, so the cost is close to linear in the
+ * number of reads.
+ *
+ * @param reads The reads to cluster.
+ * @param maxdist Maximum Levenshtein distance to a cluster's first read.
+ * @param ws Workspace for the distance computations.
+ * @return The clusters, each a list of indices into reads.
+ */
+std::vector<std::vector<std::size_t>> cluster_reads(std::span<const std::string_view> reads, int maxdist, AlignmentWorkspace& ws);
+
+/**
+ * @brief Reconstruct the most likely original strand from a cluster of noisy reads.
+ *
+ * Progressive alignment: every read is aligned to the running consensus with Diff,
+ * each consensus position collects base and deletion votes and each gap collects
+ * insertion votes, and the majority becomes the next consensus. This repeats until
+ * the consensus is stable, then it is trimmed or extended to the expected length.
+ *
+ * @param reads Reads of one oligo, of any length.
+ * @param length Expected length of the original strand.
+ * @param ws Workspace for the alignments.
+ * @return The reconstructed strand, exactly length characters long.
+ */
+std::string reconstruct(std::span<const std::string_view> reads, std::size_t length, AlignmentWorkspace& ws);
+
+/**
+ * @brief Reconstruct every cluster in parallel.
+ * @param reads All reads.
+ * @param clusters Clusters of indices into reads, as returned by cluster_reads().
+ * @param length Expected length of the original strands.
+ * @param pool Pool to spread the clusters over.
+ * @return One reconstructed strand per cluster, in cluster order.
+ */
+std::vector<std::string> reconstruct_clusters(std::span<const std::string_view> reads,
+        const std::vector<std::vector<std::size_t>>& clusters, std::size_t length, ThreadPool& pool);
+
+#endif // CONSENSUS_HPP
@@ -0,0 +1,170 @@
+/**
+ * @file fountain.hpp
+ * @brief Rateless LT (fountain) code over 64-bit segments, with a peeling decoder.
+ */
+#ifndef FOUNTAIN_HPP
+#define FOUNTAIN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * @brief Robust soliton degree distribution and the segment choice of each droplet.
+ *
+ * A droplet is the XOR of the segments its seed selects: the seed drives a
+ * splitmix64 generator that first draws a degree d, then d distinct segments.
+ * Encoder and decoder rebuild the same choice from the seed alone.
+ */
+class DropletSampler {
+public:
+    /**
+     * @brief Build the degree distribution for a number of segments.
+     * @param segments Number of segments (K); at least 1.
+     * @param c Robust soliton spike parameter.
+     * @param delta Robust soliton failure bound.
+     */
+    explicit DropletSampler(std::size_t segments, double c = 0.1, double delta = 0.05);
+
+    /**
+     * @brief Get the number of segments.
+     * @return K.
+     */
+    std::size_t segments() const { return count; }
+
+    /**
+     * @brief Get the segments a droplet combines.
+     * @param seed Seed of the droplet.
+     * @param out Output segment indices, sorted and distinct.
+     */
+    void choose(uint32_t seed, std::vector<uint32_t>& out) const;
+
+private:
+    std::size_t count;          ///< Number of segments.
+    std::vector<double> cdf;    ///< Cumulative probability of each degree, up to the largest drawn.
+};
+
+/**
+ * @brief Produces droplets from the segments of a message.
+ */
+class FountainEncoder {
+public:
+    /**
+     * @brief Prepare to encode.
+     * @param segments The message, one 64-bit segment per data oligo.
+     */
+    explicit FountainEncoder(std::span<const uint64_t> segments);
+
+    /**
+     * @brief Compute the payload of one droplet.
+     * @param seed Seed of the droplet.
+     * @return XOR of the segments the seed selects.
+     */
+    uint64_t droplet(uint32_t seed) const;
+
+    /**
+     * @brief Compute the payloads of droplets with seeds first, first + 1, ... in parallel.
+     * @param first Seed of the first droplet.
+     * @param out Output payloads, one per droplet.
+     * @param pool Threads to run on.
+     */
+    void droplets(uint32_t first, std::span<uint64_t> out, ThreadPool& pool) const;
+
+private:
+    std::span<const uint64_t> data;  ///< Segments.
+    DropletSampler sampler;          ///< Segment choice of each seed.
+};
+
+/**
+ * @brief Recovers segments from droplets as they arrive.
+ *
+ * Peeling (belief propagation over GF(2)): a droplet with one unknown segment left
+ * reveals it, which is XORed out of every droplet that contains it, which can leave
+ * them with one unknown in turn. Each droplet keeps the XOR of its unknown segment
+ * indices, so the last one is found without a search, and the whole pass is linear in
+ * the total degree. When peeling stalls, solve() runs Gaussian elimination on the
+ * droplets still holding unknowns. Droplets carry no checksum, so a corrupted one
+ * corrupts what is peeled from it.
+ */
+class FountainDecoder {
+public:
+    /**
+     * @brief Prepare to decode.
+     * @param segments Number of segments in the message.
+     */
+    explicit FountainDecoder(std::size_t segments);
+
+    /**
+     * @brief Add a droplet and peel what it allows.
+     * @param seed Seed of the droplet.
+     * @param payload Payload of the droplet.
+     * @return True once every segment is known.
+     */
+    bool add(uint32_t seed, uint64_t payload);
+
+    /**
+     * @brief Solve for the remaining segments by Gaussian elimination over GF(2).
+     * @param max_unknowns Give up if more segments than this are unknown.
+     * @return True once every segment is known.
+     */
+    bool solve(std::size_t max_unknowns = 1 << 12);
+
+    /**
+     * @brief Check whether every segment is known.
+     * @return True if decoding is complete.
+     */
+    bool done() const { return found == values.size(); }
+
+    /**
+     * @brief Get the number of segments in the message.
+     * @return K.
+     */
+    std::size_t segments() const { return values.size(); }
+
+    /**
+     * @brief Get the number of segments known.
+     * @return Recovered segments.
+     */
+    std::size_t recovered() const { return found; }
+
+    /**
+     * @brief Get the number of droplets added.
+     * @return Droplets received.
+     */
+    std::size_t received() const { return seeds.size(); }
+
+    /**
+     * @brief Check whether a segment is known.
+     * @param i Segment index.
+     * @return True if it has been recovered.
+     */
+    bool is_known(std::size_t i) const { return known[i]; }
+
+    /**
+     * @brief Get a recovered segment.
+     * @param i Segment index; must be known.
+     * @return Its value.
+     */
+    uint64_t segment(std::size_t i) const { return values[i]; }
+
+private:
+    void resolve(uint32_t segment, uint64_t value);
+
+    DropletSampler sampler;                     ///< Segment choice of each seed.
+    std::vector<uint64_t> values;               ///< Segment values, valid where known.
+    std::vector<bool> known;                    ///< Segments recovered so far.
+    std::size_t found = 0;                      ///< Number of known segments.
+    std::vector<std::vector<uint32_t>> holders; ///< Droplets still holding each unknown segment.
+    std::vector<uint32_t> seeds;                ///< Seed of each droplet.
+    std::vector<uint64_t> payloads;             ///< Payload minus the known segments.
+    std::vector<uint32_t> unknowns;             ///< Unknown segments left in each droplet.
+    std::vector<uint32_t> index_xor;            ///< XOR of those segments' indices.
+    std::vector<uint32_t> chosen;               ///< Scratch for the segment choice.
+    std::vector<std::pair<uint32_t, uint64_t>> ready; ///< Segments revealed but not yet propagated.
+};
+
+#endif // FOUNTAIN_HPP
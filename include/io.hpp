@@ -5,12 +5,44 @@
 #include <fstream>
 #include <vector>
 #include <filesystem>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <cstdint>
+#include <cstdlib>
 
 // Check if zlib is linked
 #ifdef ZLIB_FOUND
 #include <zlib.h>
 #endif
 
+// Further decompressors, each enabled when CMake finds the library
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+// io_uring is used for file I/O when liburing is linked
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+struct iovec;
+
+class ThreadPool;
+
+/**
+ * @brief Size of the fixed buffers used for streaming input.
+ */
+constexpr std::size_t IO_BUFFER_SIZE = 1 << 20;
+
 /**
  * @brief Opens a file and gets its size.
  * @param filename The name of the file to open.
@@ -26,16 +58,610 @@ std::ifstream open_file(const char* filename, std::streampos& file_size);
 void process_regular_file(const std::vector<char>& buffer);
 
 /**
- * @brief Processes the content of a gzipped file.
- * @param buffer The buffer containing the gzipped file content.
+ * @brief Writes a file to standard output, inflating compressed files as they are read.
+ * @param filename The name of the file to process.
  */
-void process_gzipped_file(const std::vector<char>& buffer);
+void process_file(const char* filename);
 
 /**
- * @brief Processes a file by opening it, reading its content, and handling .gz files.
- * @param filename The name of the file to process.
+ * @brief Check whether a file holds FASTQ records, looking through a compression extension.
+ * @param filename The name of the file.
+ * @return True for .fastq/.fq files, compressed or not.
  */
-void process_file(const char* filename);
+bool is_fastq(const std::string& filename);
 
-#endif // IO_HPP
+/**
+ * @brief A stream of bytes read sequentially, such as a file or a decompressor.
+ */
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+
+    /**
+     * @brief Check whether the source was opened successfully.
+     * @return True if bytes can be read.
+     */
+    virtual bool is_open() const = 0;
+
+    /**
+     * @brief Read up to n bytes.
+     * @param dst Destination buffer.
+     * @param n Capacity of dst.
+     * @return The number of bytes read; 0 only at end of input or on error.
+     */
+    virtual std::size_t read(char* dst, std::size_t n) = 0;
+
+    /**
+     * @brief Read until n bytes have been read or the input ends.
+     * @param dst Destination buffer.
+     * @param n Number of bytes wanted.
+     * @return The number of bytes read; less than n only at end of input or on error.
+     */
+    std::size_t read_full(char* dst, std::size_t n);
+};
+
+/**
+ * @brief Reads an uncompressed file.
+ */
+class FileSource : public ByteSource {
+public:
+    /**
+     * @brief Open a file for reading.
+     * @param filename The name of the file.
+     */
+    explicit FileSource(const std::string& filename);
+
+    bool is_open() const override { return file.is_open(); }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    std::ifstream file; ///< Input file stream.
+};
+
+/**
+ * @brief Check whether a file starts with a BGZF (blocked gzip) block header.
+ * @param filename The name of the file.
+ * @return True if the first gzip member carries the BGZF "BC" extra subfield.
+ */
+bool is_bgzf(const std::string& filename);
+
+#ifdef ZLIB_FOUND
+/**
+ * @brief Inflates a gzip file as it is read, through a fixed-size input buffer.
+ *
+ * Concatenated gzip members are decoded back to back, as gzip(1) does.
+ */
+class GzipSource : public ByteSource {
+public:
+    /**
+     * @brief Open a gzip file for reading.
+     * @param filename The name of the file.
+     * @param buffer_size Size of the compressed input buffer.
+     */
+    explicit GzipSource(const std::string& filename, std::size_t buffer_size = IO_BUFFER_SIZE);
+
+    /**
+     * @brief Releases the zlib state.
+     */
+    ~GzipSource() override;
+
+    bool is_open() const override { return opened; }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    std::ifstream file;         ///< Compressed input stream.
+    std::vector<char> in;       ///< Compressed input buffer.
+    z_stream stream{};          ///< zlib inflate state.
+    bool opened = false;        ///< File opened and zlib initialized.
+    bool ready = false;         ///< zlib state is live; cleared at end of input or on error.
+    bool in_member = false;     ///< Inside a gzip member that has not ended yet.
+};
+
+/**
+ * @brief Inflates a BGZF file with its blocks spread over a thread pool.
+ *
+ * BGZF splits the data into independent gzip members of at most 64 KiB, each
+ * recording its compressed size. Blocks are read in order, inflated in parallel,
+ * and handed back in file order; a bounded number are in flight at once.
+ */
+class BgzfSource : public ByteSource {
+public:
+    /**
+     * @brief Open a BGZF file for reading.
+     * @param filename The name of the file.
+     * @param threads Number of inflate workers; 0 uses the shared pool.
+     */
+    explicit BgzfSource(const std::string& filename, std::size_t threads = 0);
+
+    /**
+     * @brief Waits for in-flight blocks and stops the workers, if the source started its own.
+     */
+    ~BgzfSource() override;
+
+    bool is_open() const override { return opened; }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    bool submit_next_block();
+
+    std::ifstream file;                             ///< Compressed input stream.
+    std::unique_ptr<ThreadPool> own_pool;           ///< Inflate workers, if not the shared pool.
+    ThreadPool* pool;                               ///< Inflate workers in use.
+    std::deque<std::future<std::vector<char>>> pending; ///< Blocks in flight, in file order.
+    std::size_t max_pending;                        ///< Bound on blocks in flight.
+    std::vector<char> current;                      ///< Inflated block being consumed.
+    std::size_t offset = 0;                         ///< Consumed bytes of current.
+    bool opened = false;                            ///< File opened.
+    bool failed = false;                            ///< A block was malformed; stop reading.
+};
+#endif
+
+#ifdef HAVE_ZSTD
+/**
+ * @brief Decompresses a zstd file as it is read, through a fixed-size input buffer.
+ *
+ * Concatenated frames are decoded back to back.
+ */
+class ZstdSource : public ByteSource {
+public:
+    /**
+     * @brief Open a zstd file for reading.
+     * @param filename The name of the file.
+     * @param buffer_size Size of the compressed input buffer.
+     */
+    explicit ZstdSource(const std::string& filename, std::size_t buffer_size = IO_BUFFER_SIZE);
+
+    /**
+     * @brief Releases the zstd state.
+     */
+    ~ZstdSource() override;
+
+    bool is_open() const override { return opened; }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    std::ifstream file;             ///< Compressed input stream.
+    std::vector<char> in;           ///< Compressed input buffer.
+    ZSTD_inBuffer input{};          ///< Unconsumed part of in.
+    ZSTD_DStream* stream = nullptr; ///< zstd decompression state.
+    bool opened = false;            ///< File opened and zstd initialized.
+    bool ready = false;             ///< More output may follow; cleared at end of input or on error.
+    bool in_frame = false;          ///< Inside a frame that has not ended yet.
+};
+#endif
+
+#ifdef HAVE_LZMA
+/**
+ * @brief Decompresses an xz file as it is read, through a fixed-size input buffer.
+ *
+ * Concatenated streams are decoded back to back.
+ */
+class XzSource : public ByteSource {
+public:
+    /**
+     * @brief Open an xz file for reading.
+     * @param filename The name of the file.
+     * @param buffer_size Size of the compressed input buffer.
+     */
+    explicit XzSource(const std::string& filename, std::size_t buffer_size = IO_BUFFER_SIZE);
+
+    /**
+     * @brief Releases the liblzma state.
+     */
+    ~XzSource() override;
+
+    bool is_open() const override { return opened; }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    std::ifstream file;                     ///< Compressed input stream.
+    std::vector<char> in;                   ///< Compressed input buffer.
+    lzma_stream stream = LZMA_STREAM_INIT;  ///< liblzma decoder state.
+    bool opened = false;                    ///< File opened and liblzma initialized.
+    bool ready = false;                     ///< More output may follow; cleared at end of input or on error.
+};
+#endif
+
+/**
+ * @brief Reads another source ahead on a background thread.
+ *
+ * The producer fills a fixed ring of blocks while the consumer drains them, so
+ * reading (and decompression) overlaps with parsing and memory use is constant.
+ */
+class AsyncSource : public ByteSource {
+public:
+    /**
+     * @brief Start reading ahead.
+     * @param inner The source to read from.
+     * @param block_size Size of each block in the ring.
+     * @param depth Number of blocks in the ring.
+     */
+    explicit AsyncSource(std::unique_ptr<ByteSource> inner, std::size_t block_size = IO_BUFFER_SIZE, std::size_t depth = 4);
+
+    /**
+     * @brief Stops the producer thread.
+     */
+    ~AsyncSource() override;
+
+    bool is_open() const override { return inner->is_open(); }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    /**
+     * @brief One block of the ring.
+     */
+    struct Block {
+        std::vector<char> data; ///< Block storage.
+        std::size_t size = 0;   ///< Valid bytes in data.
+    };
+
+    void produce();
+
+    std::unique_ptr<ByteSource> inner;  ///< Source being read ahead.
+    std::vector<Block> ring;            ///< Ring of blocks.
+    std::size_t head = 0;               ///< Block being consumed.
+    std::size_t offset = 0;             ///< Consumed bytes of the head block.
+    std::size_t filled = 0;             ///< Blocks ready for the consumer.
+    bool done = false;                  ///< Producer reached end of input.
+    bool stopping = false;              ///< Consumer is shutting down.
+    std::mutex mutex;                   ///< Guards the ring indices and flags.
+    std::condition_variable cv;         ///< Signals both producer and consumer.
+    std::thread worker;                 ///< Producer thread.
+};
+
+#ifdef HAVE_LIBURING
+/**
+ * @brief Reads a file ahead through io_uring.
+ *
+ * A ring of blocks is kept queued in the kernel at consecutive file offsets;
+ * each block is requeued as soon as it has been consumed.
+ */
+class UringSource : public ByteSource {
+public:
+    /**
+     * @brief Open a file and queue the first reads.
+     * @param filename The name of the file.
+     * @param block_size Size of each read.
+     * @param depth Number of reads in flight.
+     */
+    explicit UringSource(const std::string& filename, std::size_t block_size = IO_BUFFER_SIZE, std::size_t depth = 4);
 
+    /**
+     * @brief Waits for reads in flight and releases the ring.
+     */
+    ~UringSource() override;
+
+    bool is_open() const override { return opened; }
+    std::size_t read(char* dst, std::size_t n) override;
+
+private:
+    /**
+     * @brief One block of the ring.
+     */
+    struct Block {
+        std::vector<char> data;     ///< Block storage.
+        std::size_t size = 0;       ///< Bytes requested, then bytes read.
+        std::uint64_t position = 0; ///< File offset of the block.
+        bool queued = false;        ///< A read is in flight.
+        bool ready = false;         ///< The read has completed.
+    };
+
+    bool queue(Block& block);
+    bool wait_one();
+
+    io_uring uring{};               ///< Submission and completion queues.
+    int fd = -1;                    ///< Input file descriptor.
+    std::uint64_t file_size = 0;    ///< Size of the file when opened.
+    std::uint64_t next_position = 0; ///< Offset of the next read to queue.
+    std::vector<Block> ring;        ///< Ring of blocks, consumed in file order.
+    std::size_t head = 0;           ///< Block being consumed.
+    std::size_t offset = 0;         ///< Consumed bytes of the head block.
+    std::size_t in_flight = 0;      ///< Reads not yet completed.
+    bool opened = false;            ///< File opened and ring set up.
+    bool failed = false;            ///< A read failed; stop reading.
+};
+#endif
+
+/**
+ * @brief Open a file for reading raw bytes ahead of the consumer.
+ *
+ * io_uring is used where available; otherwise a thread reads ahead into a ring of
+ * blocks. No decompression takes place.
+ * @param filename The name of the file.
+ * @return The source.
+ */
+std::unique_ptr<ByteSource> open_file_source(const std::string& filename);
+
+/**
+ * @brief A compression format recognized by its leading magic bytes.
+ */
+struct Decompressor {
+    const char* name;       ///< Format name, e.g. "xz".
+    std::string_view magic; ///< Bytes every file of this format starts with.
+    /**
+     * @brief Opens a decompressing source; nullptr if support was not built in.
+     */
+    std::unique_ptr<ByteSource> (*open)(const std::string& filename);
+};
+
+/**
+ * @brief Get the registry of known compression formats.
+ *
+ * Every format is listed; those whose library was not found at build time have
+ * no open function.
+ * @return The registered formats.
+ */
+const std::vector<Decompressor>& decompressors();
+
+/**
+ * @brief Detect the compression format of a file from its magic bytes.
+ * @param filename The name of the file.
+ * @return The matching format, or nullptr for uncompressed (or unreadable) files.
+ */
+const Decompressor* detect_compression(const std::string& filename);
+
+/**
+ * @brief Open a file as a byte source, decompressing it on background threads.
+ *
+ * The format is detected from the magic bytes, not the extension. BGZF files are
+ * inflated block-parallel; other compressed files are decoded as a single stream
+ * read ahead on one thread.
+ * @param filename The name of the file.
+ * @return The source, or nullptr if the format is not supported in this build.
+ */
+std::unique_ptr<ByteSource> open_source(const std::string& filename);
+
+/**
+ * @brief A stream of bytes written sequentially, such as a file.
+ */
+class ByteSink {
+public:
+    virtual ~ByteSink() = default;
+
+    /**
+     * @brief Check whether the sink was opened successfully.
+     * @return True if bytes can be written.
+     */
+    virtual bool is_open() const = 0;
+
+    /**
+     * @brief Write n bytes.
+     * @param src Bytes to write.
+     * @param n Number of bytes.
+     * @return False if an earlier or current write failed.
+     */
+    virtual bool write(const char* src, std::size_t n) = 0;
+
+    /**
+     * @brief Write out everything still buffered and close the sink.
+     * @return True if every write succeeded.
+     */
+    virtual bool close() = 0;
+
+    /**
+     * @brief Write a string.
+     * @param s Bytes to write.
+     * @return False if a write failed.
+     */
+    bool write(std::string_view s) { return write(s.data(), s.size()); }
+};
+
+/**
+ * @brief Writes an uncompressed file.
+ */
+class FileSink : public ByteSink {
+public:
+    /**
+     * @brief Create or truncate a file for writing.
+     * @param filename The name of the file.
+     */
+    explicit FileSink(const std::string& filename);
+
+    bool is_open() const override { return file.is_open(); }
+    bool write(const char* src, std::size_t n) override;
+    bool close() override;
+    using ByteSink::write;
+
+private:
+    std::ofstream file; ///< Output file stream.
+};
+
+/**
+ * @brief Writes a file through large aligned buffers flushed with writev.
+ *
+ * Several buffers are filled before a single writev writes them all, so the
+ * number of system calls is the output size over the combined buffer size.
+ * When the final size is known the file is preallocated, and O_DIRECT may be
+ * requested to bypass the page cache; it is dropped if the file system refuses it.
+ */
+class OutputWriter : public ByteSink {
+public:
+    /**
+     * @brief Alignment of the buffers, and of O_DIRECT writes.
+     */
+    static constexpr std::size_t ALIGNMENT = 4096;
+
+    /**
+     * @brief Create or truncate a file for writing.
+     * @param filename The name of the file.
+     * @param expected_size Final size of the file if known, for preallocation; 0 if unknown.
+     * @param direct Bypass the page cache with O_DIRECT.
+     * @param buffer_size Size of each buffer, rounded up to ALIGNMENT.
+     * @param buffers Number of buffers gathered into one writev.
+     */
+    explicit OutputWriter(const std::string& filename, std::uint64_t expected_size = 0, bool direct = false,
+                          std::size_t buffer_size = IO_BUFFER_SIZE, std::size_t buffers = 4);
+
+    /**
+     * @brief Closes the file if close() was not called.
+     */
+    ~OutputWriter() override;
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    bool is_open() const override { return fd >= 0; }
+    bool write(const char* src, std::size_t n) override;
+    bool close() override;
+    using ByteSink::write;
+
+    /**
+     * @brief Check whether O_DIRECT is in effect.
+     * @return True if writes bypass the page cache.
+     */
+    bool direct() const { return direct_io; }
+
+private:
+    /**
+     * @brief Releases memory from std::aligned_alloc.
+     */
+    struct AlignedDelete {
+        void operator()(char* p) const { std::free(p); }
+    };
+
+    bool flush(std::size_t tail);
+    bool write_vectors(struct iovec* iov, int count);
+
+    int fd = -1;                                            ///< Output file descriptor.
+    std::vector<std::unique_ptr<char, AlignedDelete>> buffers; ///< Aligned buffers, filled in order.
+    std::size_t buffer_size;                                ///< Size of each buffer.
+    std::size_t current = 0;                                ///< Buffer being filled.
+    std::size_t used = 0;                                   ///< Bytes in the current buffer.
+    std::uint64_t written = 0;                              ///< Bytes written to the file.
+    bool direct_io = false;                                 ///< O_DIRECT is set on fd.
+    bool preallocated = false;                              ///< Space was reserved past the data.
+    bool failed = false;                                    ///< A write failed.
+};
+
+/**
+ * @brief Writes to another sink behind the caller on a background thread.
+ *
+ * The caller fills blocks of a fixed ring and hands each full block to the writer
+ * thread, so formatting the next block overlaps with writing the previous one.
+ */
+class AsyncSink : public ByteSink {
+public:
+    /**
+     * @brief Start the writer thread.
+     * @param inner The sink to write to.
+     * @param block_size Size of each block in the ring.
+     * @param depth Number of blocks in the ring.
+     */
+    explicit AsyncSink(std::unique_ptr<ByteSink> inner, std::size_t block_size = IO_BUFFER_SIZE, std::size_t depth = 4);
+
+    /**
+     * @brief Closes the sink if close() was not called.
+     */
+    ~AsyncSink() override;
+
+    bool is_open() const override { return inner->is_open(); }
+    bool write(const char* src, std::size_t n) override;
+    bool close() override;
+    using ByteSink::write;
+
+private:
+    /**
+     * @brief One block of the ring.
+     */
+    struct Block {
+        std::vector<char> data; ///< Block storage.
+        std::size_t size = 0;   ///< Valid bytes in data.
+    };
+
+    bool hand_off();
+    void consume();
+
+    std::unique_ptr<ByteSink> inner;    ///< Sink being written behind.
+    std::vector<Block> ring;            ///< Ring of blocks.
+    std::size_t head = 0;               ///< Block being written out.
+    std::size_t tail = 0;               ///< Block being filled by the caller.
+    std::size_t filled = 0;             ///< Blocks handed to the writer.
+    bool closing = false;               ///< No more blocks will be handed off.
+    bool closed = false;                ///< close() has run.
+    bool failed = false;                ///< A write failed.
+    std::mutex mutex;                   ///< Guards the ring indices and flags.
+    std::condition_variable cv;         ///< Signals both caller and writer.
+    std::thread worker;                 ///< Writer thread.
+};
+
+#ifdef HAVE_LIBURING
+/**
+ * @brief Writes a file behind the caller through io_uring.
+ *
+ * Full blocks are queued to the kernel at consecutive file offsets while the
+ * caller fills the next free block.
+ */
+class UringSink : public ByteSink {
+public:
+    /**
+     * @brief Create or truncate a file and set up the ring.
+     * @param filename The name of the file.
+     * @param expected_size Final size of the file if known, for preallocation; 0 if unknown.
+     * @param block_size Size of each write.
+     * @param depth Number of blocks in the ring.
+     */
+    explicit UringSink(const std::string& filename, std::uint64_t expected_size = 0,
+                       std::size_t block_size = IO_BUFFER_SIZE, std::size_t depth = 4);
+
+    /**
+     * @brief Closes the sink if close() was not called.
+     */
+    ~UringSink() override;
+
+    bool is_open() const override { return opened; }
+    bool write(const char* src, std::size_t n) override;
+    bool close() override;
+    using ByteSink::write;
+
+private:
+    /**
+     * @brief One block of the ring.
+     */
+    struct Block {
+        std::vector<char> data;     ///< Block storage.
+        std::size_t size = 0;       ///< Valid bytes in data.
+        std::uint64_t position = 0; ///< File offset of the block.
+        bool queued = false;        ///< A write is in flight.
+    };
+
+    bool queue(Block& block);
+    bool wait_one();
+
+    io_uring uring{};               ///< Submission and completion queues.
+    int fd = -1;                    ///< Output file descriptor.
+    std::uint64_t next_position = 0; ///< Offset of the next block to queue.
+    std::vector<Block> ring;        ///< Ring of blocks.
+    std::size_t tail = 0;           ///< Block being filled by the caller.
+    std::size_t in_flight = 0;      ///< Writes not yet completed.
+    bool opened = false;            ///< File opened and ring set up.
+    bool preallocated = false;      ///< Space was reserved past the data.
+    bool failed = false;            ///< A write failed.
+};
+#endif
+
+/**
+ * @brief Open a file for writing in the caller's thread.
+ *
+ * The OutputWriter gathers the caller's bytes into its own aligned buffers, so
+ * they are copied once and each write() may block on the disk. The codec's
+ * outputs go through open_async_sink() instead, which writes behind the caller.
+ * @param filename The name of the file.
+ * @param expected_size Final size of the file if known, for preallocation; 0 if unknown.
+ * @param direct Bypass the page cache with O_DIRECT.
+ * @return The sink.
+ */
+std::unique_ptr<ByteSink> open_sink(const std::string& filename, std::uint64_t expected_size = 0, bool direct = false);
+
+/**
+ * @brief Open a file for writing behind the caller.
+ *
+ * io_uring is used where available; otherwise a thread writes out a ring of blocks
+ * through the sink open_sink() returns. O_DIRECT output never goes through io_uring.
+ * @param filename The name of the file.
+ * @param expected_size Final size of the file if known, for preallocation; 0 if unknown.
+ * @param direct Bypass the page cache with O_DIRECT.
+ * @return The sink.
+ */
+std::unique_ptr<ByteSink> open_async_sink(const std::string& filename, std::uint64_t expected_size = 0, bool direct = false);
+
+#endif // IO_HPP
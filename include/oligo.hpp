@@ -1,11 +1,19 @@
+/**
+ * @file oligo.hpp
+ * @brief Oligonucleotide of up to MAX_BP bases, packed two bits per base.
+ */
+#ifndef OLIGO_HPP
+#define OLIGO_HPP
+
 #include <string>
 #include <cstdint>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <optional>
+#include "io.hpp"
 #include "utils.hpp"
 
-
 /**
  * @brief Maximum number of base pairs allowed for an oligonucleotide.
  */
@@ -43,7 +51,7 @@ public:
      * @brief Constructor from string.
      * @param s The string representation of the oligonucleotide.
      */
-    Oligo(const std::string& s) : basepairs(s.length() > MAX_BP ? 0 : s.length()), data_block(0) {
+    Oligo(std::string_view s) : basepairs(s.length() > MAX_BP ? 0 : s.length()), data_block(0) {
         for (char c : s) {
             std::optional<int> nt = char2nt(c);
             if (nt.has_value()) {
@@ -74,16 +82,22 @@ public:
      * @return The string representation of the data_block.
      */
     std::string seq() const {
-        std::string result;
-        result.reserve(basepairs);
-
-        for (size_t i = 0; i < std::min(basepairs, MAX_BP); ++i) {
-            int nt = static_cast<int>((data_block >> (2 * (basepairs - i - 1))) & 0x3);
-            result += nt2string(nt);
-        }
+        std::string result(bp(), '\0');
+        write_seq(result.data());
         return result;
     }
 
+    /**
+     * @brief Write the bases into a buffer, without building a string.
+     * @param out Room for bp() characters.
+     * @return The end of the bases written.
+     */
+    char* write_seq(char* out) const {
+        for (size_t i = 0; i < basepairs; ++i)
+            *out++ = nucleotideStr[(data_block >> (2 * (basepairs - i - 1))) & 0x3];
+        return out;
+    }
+
     /**
      * @brief Compare the oligo with another oligo.
      * @param other The other oligo to compare.
@@ -169,61 +183,17 @@ public:
         of.write(arr, sizeof(uint64_t));
     }
 
-#ifdef HAVE_RS_MODULE
     /**
-     * @brief Function to encode an Oligo using libfec Reed-Solomon Error Corretion
-     * @param oligo The oligo to be encoded
+     * @brief Write binary data to a sink, the bytes its bases hold (four bases per byte)
+     * @param sink the sink to write to
+     * @return False if the write failed
      */
-    void encode() const {
-        unsigned char data[8];    // Data to be encoded
-        unsigned char parity[8];  // Parity data after encoding
-
-        // Convert the oligo into an appropriate format for encoding
+    bool write_bin(ByteSink &sink) const {
+        char arr[8];
         for (int i = 0; i < 8; i++)
-            data[i] = static_cast<char>((data_block >> (i * 8)) & 0xFF);
-
-        // Perform encoding using libfec
-        encode_rs_char(init_rs_char(8, 0x187, 0, 1, 32, 0), data, parity);
-
-        // TODO: Handle the encoded data (e.g., storing it or transmitting)
-        // For now, let's print the encoded data for demonstration purposes
-        std::cout << "Encoded data: ";
-        for (size_t i = 0; i < 8; i++)
-            std::cout << static_cast<int>(parity[i]) << " ";
-        std::cout << std::endl;
-    }
-
-    /**
-     * @brief Function to decode an Oligo using libfec
-     */
-    void decode() const {
-        unsigned char receivedData[MAX_BP];  // Received data to be decoded
-        int erasures[MAX_BP];                // Array to store erasure positions (if any)
-
-        // Simulating received data (encoded data from transmission)
-        // Replace this with the actual received data
-        for (size_t i = 0; i < basepairs; ++i)
-            receivedData[i] = static_cast<unsigned char>((data_block >> (2 * (basepairs - i - 1))) & 0x3);
-
-        // Simulating erasures (missing/corrupted positions)
-        // Replace this with the actual erasure positions
-        int numErasures = 0;  // Number of erasures
-                              // ...
-
-                              // Perform decoding using libfec
-        int decodeResult = decode_rs_char(init_rs_char(8, 0x187, 0, 1, 32, 0), receivedData, erasures, numErasures);
-
-        // Check the decode result
-        if (decodeResult < 0) {
-            std::cout << "Decoded data: ";
-            for (size_t i = 0; i < basepairs; ++i)
-                std::cout << static_cast<int>(receivedData[i]) << " ";
-            std::cout << std::endl;
-        }
-        else {
-            std::cout << "Decoding failed." << std::endl;
-        }
+            arr[i] = static_cast<char>((data() >> (i * 8)) & 0xFF);
+        return sink.write(arr, bp() / 4);
     }
-#endif
 };
 
+#endif // OLIGO_HPP
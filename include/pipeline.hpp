@@ -0,0 +1,418 @@
+/**
+ * @file pipeline.hpp
+ * @brief Stages running concurrently, connected by bounded lock-free queues, with per-stage timing.
+ */
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Blocking and closing shared by the bounded queues.
+ *
+ * The queues themselves take no lock. A thread that finds its queue full (or empty)
+ * sleeps on an event counter that every push, pop and close bumps, so it wakes as soon
+ * as the other side has moved. Items are meant to be batches, so the counter is touched
+ * far less often than the data.
+ */
+class QueueSignal {
+public:
+    /**
+     * @brief Stop the queue: pushes fail from now on, and pops fail once it is empty.
+     */
+    void close() {
+        closed.store(true, std::memory_order_release);
+        signal();
+    }
+
+    /**
+     * @brief Check whether close() has been called.
+     * @return True once closed.
+     */
+    bool is_closed() const { return closed.load(std::memory_order_acquire); }
+
+protected:
+    /**
+     * @brief Wait until ready() holds or the queue is closed.
+     * @param ready Condition to wait for.
+     * @return False if the queue was closed first.
+     */
+    template <typename Ready>
+    bool wait_until(Ready ready) {
+        for (;;) {
+            const uint32_t seen = events.load(std::memory_order_acquire);
+            if (ready())
+                return true;
+            if (is_closed())
+                return ready();
+            events.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    /**
+     * @brief Wake the threads waiting on the queue.
+     */
+    void signal() {
+        events.fetch_add(1, std::memory_order_release);
+        events.notify_all();
+    }
+
+private:
+    std::atomic<uint32_t> events{0};  ///< Bumped on every change.
+    std::atomic<bool> closed{false};  ///< No more pushes.
+};
+
+/**
+ * @brief Bounded ring buffer for exactly one producer thread and one consumer thread.
+ * @tparam T Item type.
+ */
+template <typename T>
+class SpscQueue : public QueueSignal {
+public:
+    /**
+     * @brief Create an empty queue.
+     * @param capacity Items it holds before push() blocks; rounded up to a power of two.
+     */
+    explicit SpscQueue(std::size_t capacity) : slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+    /**
+     * @brief Add an item, waiting while the queue is full.
+     * @param item The item.
+     * @return False if the queue was closed.
+     */
+    bool push(T item) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (is_closed() || !wait_until([&] { return t - head.load(std::memory_order_acquire) < slots.size(); }) || is_closed())
+            return false;
+        slots[t & (slots.size() - 1)] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        signal();
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest item, waiting while the queue is empty.
+     * @param item Receives the item.
+     * @return False once the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (!wait_until([&] { return tail.load(std::memory_order_acquire) != h; }))
+            return false;
+        item = std::move(slots[h & (slots.size() - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        signal();
+        return true;
+    }
+
+private:
+    std::vector<T> slots;                          ///< Ring of items.
+    alignas(64) std::atomic<std::size_t> head{0};  ///< Next slot to pop; written by the consumer.
+    alignas(64) std::atomic<std::size_t> tail{0};  ///< Next slot to push; written by the producer.
+};
+
+/**
+ * @brief Bounded queue for any number of producer and consumer threads.
+ *
+ * Each cell carries a sequence number that says whose turn it is (Vyukov's bounded
+ * MPMC queue): a producer claims a cell by advancing the enqueue position with a
+ * compare-and-swap, and hands it over by setting the sequence, and so do consumers.
+ * @tparam T Item type.
+ */
+template <typename T>
+class MpmcQueue : public QueueSignal {
+public:
+    /**
+     * @brief Create an empty queue.
+     * @param capacity Items it holds before push() blocks; rounded up to a power of two.
+     */
+    explicit MpmcQueue(std::size_t capacity) : cells(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {
+        for (std::size_t i = 0; i < cells.size(); ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add an item, waiting while the queue is full.
+     * @param item The item.
+     * @return False if the queue was closed.
+     */
+    bool push(T item) {
+        Cell* cell = nullptr;
+        std::size_t pos = 0;
+        auto claim = [&] {
+            pos = enqueue.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells[pos & (cells.size() - 1)];
+                const auto diff = static_cast<std::ptrdiff_t>(cell->sequence.load(std::memory_order_acquire) - pos);
+                if (diff == 0 && enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return true;
+                if (diff < 0)
+                    return false;  // full
+                if (diff > 0)
+                    pos = enqueue.load(std::memory_order_relaxed);
+            }
+        };
+        if (is_closed() || !wait_until(claim))
+            return false;
+        cell->value = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        signal();
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest item, waiting while the queue is empty.
+     * @param item Receives the item.
+     * @return False once the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        Cell* cell = nullptr;
+        std::size_t pos = 0;
+        auto claim = [&] {
+            pos = dequeue.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells[pos & (cells.size() - 1)];
+                const auto diff = static_cast<std::ptrdiff_t>(cell->sequence.load(std::memory_order_acquire) - (pos + 1));
+                if (diff == 0 && dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return true;
+                if (diff < 0)
+                    return false;  // empty
+                if (diff > 0)
+                    pos = dequeue.load(std::memory_order_relaxed);
+            }
+        };
+        if (!wait_until(claim))
+            return false;
+        item = std::move(cell->value);
+        cell->sequence.store(pos + cells.size(), std::memory_order_release);
+        signal();
+        return true;
+    }
+
+private:
+    /**
+     * @brief One slot and the turn it is at.
+     */
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};  ///< Equal to the position for a producer's turn, position + 1 for a consumer's.
+        T value{};                             ///< The item.
+    };
+
+    std::vector<Cell> cells;                          ///< Ring of cells.
+    alignas(64) std::atomic<std::size_t> enqueue{0};  ///< Next position to push.
+    alignas(64) std::atomic<std::size_t> dequeue{0};  ///< Next position to pop.
+};
+
+/**
+ * @brief Throughput and waiting of one pipeline stage.
+ */
+struct StageStats {
+    std::string name;          ///< Stage name.
+    std::size_t workers = 0;   ///< Threads running the stage.
+    std::size_t items = 0;     ///< Items processed.
+    std::size_t bytes = 0;     ///< Bytes processed, as the stage counts them.
+    double busy = 0;           ///< Seconds working, summed over the workers.
+    double starved = 0;        ///< Seconds waiting for input, summed over the workers.
+    double blocked = 0;        ///< Seconds waiting for room downstream, summed over the workers.
+};
+
+/**
+ * @brief Stages running concurrently on their own threads, connected by bounded queues.
+ *
+ * A stage is a loop that pops from its input queue, processes, and pushes to its
+ * output, through its Stage so the time spent waiting is recorded. A full queue
+ * blocks its producer (backpressure), so memory stays bounded and the slowest stage
+ * sets the rate; its stats show it busy while the others are starved or blocked.
+ */
+class Pipeline {
+public:
+    /**
+     * @brief A stage's handle for waiting on queues and counting its work.
+     */
+    class Stage {
+    public:
+        /**
+         * @brief Pop from the stage's input, counting the wait as starved.
+         * @param queue The input queue.
+         * @param item Receives the item.
+         * @return False once the input is closed and empty.
+         */
+        template <typename Queue, typename T>
+        bool pop(Queue& queue, T& item) {
+            const auto start = clock::now();
+            const bool ok = queue.pop(item);
+            add(starved, start);
+            return ok;
+        }
+
+        /**
+         * @brief Push to the stage's output, counting the wait as blocked.
+         * @param queue The output queue.
+         * @param item The item.
+         * @return False if the output was closed, as when the pipeline is cancelled.
+         */
+        template <typename Queue, typename T>
+        bool push(Queue& queue, T&& item) {
+            const auto start = clock::now();
+            const bool ok = queue.push(std::forward<T>(item));
+            add(blocked, start);
+            return ok;
+        }
+
+        /**
+         * @brief Count one processed item.
+         * @param bytes Its size.
+         */
+        void processed(std::size_t bytes) {
+            items.fetch_add(1, std::memory_order_relaxed);
+            this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Stop the whole pipeline, for a stage that hit an error.
+         */
+        void fail() { pipeline.cancel(); }
+
+    private:
+        friend class Pipeline;
+        using clock = std::chrono::steady_clock;
+
+        Stage(Pipeline& pipeline, std::string name, std::size_t workers) : pipeline(pipeline), name(std::move(name)), workers(workers) {}
+
+        void add(std::atomic<int64_t>& total, clock::time_point start) {
+            total.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count(), std::memory_order_relaxed);
+        }
+
+        Pipeline& pipeline;                ///< Owner, for cancel().
+        std::string name;                  ///< Stage name.
+        std::size_t workers;               ///< Threads running the stage.
+        std::function<void(Stage&)> body; ///< The stage's loop.
+        std::function<void()> on_finish;   ///< Run once every worker has returned.
+        std::atomic<std::size_t> running{0}; ///< Workers not yet returned.
+        std::atomic<std::size_t> items{0}; ///< Items processed.
+        std::atomic<std::size_t> bytes{0}; ///< Bytes processed.
+        std::atomic<int64_t> elapsed{0};   ///< Nanoseconds the workers ran, summed.
+        std::atomic<int64_t> starved{0};   ///< Nanoseconds waiting for input.
+        std::atomic<int64_t> blocked{0};   ///< Nanoseconds waiting for room downstream.
+    };
+
+    Pipeline() = default;
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /**
+     * @brief Create a queue that lives as long as the pipeline and closes when it is cancelled.
+     * @tparam Queue SpscQueue or MpmcQueue of some item type.
+     * @param capacity Items it holds before producers block.
+     * @return The queue.
+     */
+    template <typename Queue>
+    Queue& queue(std::size_t capacity) {
+        auto owned = std::make_shared<Queue>(capacity);
+        Queue& q = *owned;
+        queues.push_back(owned);
+        return q;
+    }
+
+    /**
+     * @brief Add a stage.
+     * @param name Name shown in the stats.
+     * @param workers Threads running body; more than one needs MPMC queues on both sides.
+     * @param body The stage's loop, run by each worker until its input runs out.
+     * @param on_finish Run once every worker has returned, typically to close the stage's output queue.
+     */
+    void add_stage(std::string name, std::size_t workers, std::function<void(Stage&)> body, std::function<void()> on_finish = {}) {
+        stages.push_back(std::unique_ptr<Stage>(new Stage(*this, std::move(name), std::max<std::size_t>(1, workers))));
+        stages.back()->body = std::move(body);
+        stages.back()->on_finish = std::move(on_finish);
+    }
+
+    /**
+     * @brief Run every stage to completion.
+     * @return False if a stage called fail().
+     */
+    bool run() {
+        std::vector<std::thread> threads;
+        for (auto& stage : stages) {
+            stage->running = stage->workers;
+            for (std::size_t i = 0; i < stage->workers; ++i) {
+                threads.emplace_back([&stage = *stage] {
+                    const auto start = Stage::clock::now();
+                    stage.body(stage);
+                    stage.add(stage.elapsed, start);
+                    if (stage.running.fetch_sub(1) == 1 && stage.on_finish)
+                        stage.on_finish();
+                });
+            }
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return !cancelled.load();
+    }
+
+    /**
+     * @brief Close every queue, so each stage's next pop or push fails and it returns.
+     */
+    void cancel() {
+        cancelled = true;
+        for (auto& q : queues)
+            q->close();
+    }
+
+    /**
+     * @brief Get the throughput and waiting of every stage, in the order they were added.
+     * @return One entry per stage.
+     */
+    std::vector<StageStats> stats() const {
+        std::vector<StageStats> out;
+        for (const auto& stage : stages) {
+            StageStats s;
+            s.name = stage->name;
+            s.workers = stage->workers;
+            s.items = stage->items.load();
+            s.bytes = stage->bytes.load();
+            s.starved = stage->starved.load() * 1e-9;
+            s.blocked = stage->blocked.load() * 1e-9;
+            s.busy = std::max(0.0, stage->elapsed.load() * 1e-9 - s.starved - s.blocked);
+            out.push_back(s);
+        }
+        return out;
+    }
+
+private:
+    std::vector<std::shared_ptr<QueueSignal>> queues;  ///< Every queue, for cancel().
+    std::vector<std::unique_ptr<Stage>> stages;        ///< Stages in the order added.
+    std::atomic<bool> cancelled{false};                ///< A stage failed.
+};
+
+/**
+ * @brief Print one line per stage: items, MB/s while busy, and the share of time busy, starved and blocked.
+ * @param os Output stream.
+ * @param stats Stats from Pipeline::stats().
+ */
+inline void print_stage_stats(std::ostream& os, std::span<const StageStats> stats) {
+    for (const auto& s : stats) {
+        const double total = std::max(1e-9, s.busy + s.starved + s.blocked);
+        os << std::left << std::setw(10) << s.name << std::right << " x" << s.workers << std::setw(10) << s.items << " items"
+           << std::fixed << std::setprecision(1) << std::setw(10) << (s.busy > 0 ? s.bytes / s.busy / 1e6 : 0) << " MB/s busy"
+           << std::setw(7) << 100 * s.busy / total << "% busy" << std::setw(7) << 100 * s.starved / total << "% starved"
+           << std::setw(7) << 100 * s.blocked / total << "% blocked" << std::endl;
+        os.unsetf(std::ios::floatfield);
+    }
+}
+
+#endif // PIPELINE_HPP
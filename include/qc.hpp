@@ -0,0 +1,68 @@
+/**
+ * @file qc.hpp
+ * @brief Nucleotide composition and quality-control statistics for reads.
+ */
+#ifndef QC_HPP
+#define QC_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Count the A, C, G and T bytes of a sequence with a SIMD byte histogram.
+ * @param seq The sequence to count.
+ * @param counts Per-nucleotide totals, indexed by Nucleotide; incremented, not overwritten.
+ */
+void count_nucleotides(std::string_view seq, std::array<std::uint64_t, 4>& counts);
+
+/**
+ * @brief Accumulated composition statistics over a set of reads.
+ *
+ * Instances are cheap to merge, so each worker can fill its own and the results
+ * can be combined at the end.
+ */
+class QCStats {
+public:
+    /**
+     * @brief Add one read to the statistics.
+     * @param seq The read sequence.
+     */
+    void add(std::string_view seq);
+
+    /**
+     * @brief Fold another set of statistics into this one.
+     * @param other The statistics to merge.
+     */
+    void merge(const QCStats& other);
+
+    /**
+     * @brief Get the number of reads added.
+     * @return The read count.
+     */
+    std::uint64_t reads() const { return read_count; }
+
+    /**
+     * @brief Get the GC content over all A, C, G and T bases.
+     * @return The GC content as a double between 0 and 1.
+     */
+    double gc_content() const;
+
+    /**
+     * @brief Print a human-readable report.
+     * @param os The stream to write to.
+     */
+    void print(std::ostream& os) const;
+
+private:
+    std::uint64_t read_count = 0;                               ///< Number of reads.
+    std::array<std::uint64_t, 4> base_counts{};                 ///< A, C, G, T totals.
+    std::uint64_t other_bases = 0;                              ///< Bytes that are not A, C, G or T.
+    std::vector<std::array<std::uint64_t, 5>> position_counts;  ///< A, C, G, T, other per read position.
+    std::vector<std::uint64_t> homopolymer_hist;                ///< Reads by calculateMaxHomopolymerLen.
+    std::vector<std::uint64_t> length_hist;                     ///< Reads by length.
+};
+
+#endif // QC_HPP
@@ -0,0 +1,124 @@
+/**
+ * @file records.hpp
+ * @brief Batched, zero-copy reading of sequencing records from FASTA, FASTQ and raw line files.
+ */
+#ifndef RECORDS_HPP
+#define RECORDS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "io.hpp"
+
+/**
+ * @brief Layout of the records in an input file.
+ */
+enum class RecordFormat {
+    Auto,   /**< Detect from the first character: '@' for FASTQ, '>' for FASTA, raw otherwise */
+    Raw,    /**< One sequence per non-empty line */
+    Fasta,  /**< '>' header followed by one or more sequence lines */
+    Fastq   /**< Four lines: '@' header, sequence, '+' separator, qualities */
+};
+
+/**
+ * @brief One sequencing record.
+ */
+struct Record {
+    std::string_view seq;   ///< Bases, with line breaks removed.
+    std::string_view qual;  ///< Quality string; empty for FASTA and raw input.
+};
+
+/**
+ * @brief Reads records from one or more files (lanes) in batches.
+ *
+ * Records are views into the reader's own buffers: an uncompressed file is mapped
+ * into memory whole, while compressed files (or all files, if mapping is turned off)
+ * are streamed through a buffer that grows only for records longer than it.
+ * Multi-line FASTA sequences are joined in place in that buffer. The lanes are read
+ * one after another and a batch never spans two of them.
+ */
+class RecordReader {
+public:
+    /**
+     * @brief Open the lanes for reading.
+     * @param filenames Files to read, in order.
+     * @param format Record layout; Auto detects it for each file.
+     * @param batch_size Maximum number of records per batch.
+     * @param use_mmap Map uncompressed files instead of streaming them.
+     */
+    explicit RecordReader(std::vector<std::string> filenames, RecordFormat format = RecordFormat::Auto,
+                          std::size_t batch_size = 1 << 16, bool use_mmap = true);
+
+    /**
+     * @brief Releases the current lane.
+     */
+    ~RecordReader();
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    /**
+     * @brief Check whether every lane exists and can be read.
+     * @return True if all the files can be opened.
+     */
+    bool is_open() const { return opened; }
+
+    /**
+     * @brief Read the next batch of records.
+     * @param batch Output records, valid until the next call.
+     * @return False once every lane has been read, or on error.
+     */
+    bool next_batch(std::vector<Record>& batch);
+
+    /**
+     * @brief Get the lane the last batch came from.
+     * @return The name of the file.
+     */
+    const std::string& current_file() const { return filenames[std::min(lane, filenames.size() - 1)]; }
+
+    /**
+     * @brief Get the layout of the lane the last batch came from.
+     * @return The detected (or requested) record format.
+     */
+    RecordFormat current_format() const { return lane_format; }
+
+private:
+    /**
+     * @brief Outcome of parsing one record.
+     */
+    enum class ParseResult { Ok, NeedMore, Done };
+
+    bool open_lane();
+    void close_lane();
+    bool fill();
+    bool find_line(std::size_t from, std::size_t& stop) const;
+    std::string_view line_view(std::size_t from, std::size_t stop) const;
+    std::size_t after(std::size_t stop) const { return stop < end ? stop + 1 : end; }
+    ParseResult parse(Record& record);
+    ParseResult parse_raw(Record& record);
+    ParseResult parse_fasta(Record& record);
+    ParseResult parse_fastq(Record& record);
+
+    std::vector<std::string> filenames;     ///< Lanes, in reading order.
+    RecordFormat format;                    ///< Requested layout.
+    std::size_t batch_size;                 ///< Maximum records per batch.
+    bool use_mmap;                          ///< Map uncompressed files.
+    bool opened = true;                     ///< Every lane could be opened.
+
+    std::size_t lane = 0;                   ///< Lane being read.
+    bool lane_open = false;                 ///< The current lane has been opened.
+    RecordFormat lane_format = RecordFormat::Raw; ///< Layout of the current lane.
+    std::unique_ptr<ByteSource> source;     ///< Streaming input, if not mapped.
+    std::vector<char> buffer;               ///< Streaming buffer.
+    char* mapped = nullptr;                 ///< Mapped file, if mapped.
+    std::size_t mapped_size = 0;            ///< Length of the mapping.
+    char* data = nullptr;                   ///< Start of the bytes being parsed.
+    std::size_t begin = 0;                  ///< Start of unparsed data.
+    std::size_t end = 0;                    ///< End of valid data.
+    bool eof = false;                       ///< The lane has no more bytes to load.
+};
+
+#endif // RECORDS_HPP
@@ -0,0 +1,357 @@
+/**
+ * @file strand.hpp
+ * @brief Strand layout and the inner and outer codes, shared by Codec and the stream encoder and decoder.
+ */
+#ifndef STRAND_HPP
+#define STRAND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "fountain.hpp"
+#include "oligo.hpp"
+
+class ThreadPool;
+
+/**
+ * @brief Length of an encoded duplex: index oligo followed by data oligo.
+ */
+const size_t DUPLEX_BP = 2 * MAX_BP;
+
+/**
+ * @brief Default inner-code parity bytes per duplex: corrects two substituted bytes in a strand.
+ */
+const size_t INNER_PARITY_BYTES = 4;
+
+/**
+ * @brief Reads whose length differs from the strand length by at most this much are kept for trace reconstruction.
+ */
+const size_t MAX_INDEL = 8;
+
+/**
+ * @brief Maximum edit distance between reads placed in the same cluster.
+ */
+const int CLUSTER_MAXDIST = 12;
+
+/**
+ * @brief Default number of data rows in an outer-code group (RS message length).
+ */
+const size_t OUTER_DATA_ROWS = 223;
+
+/**
+ * @brief Default number of parity rows in an outer-code group (RS parity symbols).
+ */
+const size_t OUTER_PARITY_ROWS = 32;
+
+/**
+ * @brief Data oligos per row of a full outer-code group.
+ */
+const size_t OUTER_COLUMNS = 64;
+
+/**
+ * @brief Index bit that marks an outer-code parity oligo.
+ *
+ * A parity index packs, from the top: this flag, the group number (31 bits), the
+ * number of data oligos in the group (16 bits), the parity row (8 bits) and the
+ * column (8 bits).
+ */
+const uint64_t PARITY_FLAG = 1ULL << 63;
+
+/**
+ * @brief Index bit that marks a fountain-code droplet oligo (with PARITY_FLAG clear).
+ *
+ * A droplet index packs, below this flag, the number of segments in the file
+ * (30 bits) and the droplet's seed (32 bits).
+ */
+const uint64_t DROPLET_FLAG = 1ULL << 62;
+
+/**
+ * @brief Default extra droplets per segment in fountain mode.
+ */
+const double FOUNTAIN_OVERHEAD = 0.25;
+
+/**
+ * @brief Droplets that must agree on a segment count before the fountain decoder starts.
+ */
+const size_t DROPLET_QUORUM = 8;
+
+/**
+ * @brief Check whether an index belongs to a fountain-code droplet.
+ * @param index The index oligo's value.
+ * @return True for a droplet.
+ */
+inline bool is_droplet(uint64_t index) {
+    return (index & (PARITY_FLAG | DROPLET_FLAG)) == DROPLET_FLAG;
+}
+
+/**
+ * @brief Layout of one outer-code group.
+ *
+ * A group is `rows` rows of `columns` consecutive data oligos. Each byte position of
+ * each column is one RS(rows + parity, rows) codeword over GF(2^8), so a lost oligo is
+ * one erasure in eight codewords. Full groups have OUTER_COLUMNS columns; the last one
+ * is narrowed so a small file does not carry a full set of parity rows per column.
+ */
+struct OuterGroup {
+    size_t first;    ///< Index of the first data oligo.
+    size_t blocks;   ///< Number of data oligos.
+    size_t columns;  ///< Data oligos per row.
+    size_t rows;     ///< Number of data rows; the last one may be partial.
+
+    /**
+     * @brief Compute the layout of a group.
+     * @param group Group number.
+     * @param blocks Number of data oligos in the group.
+     * @param data_rows Data rows in a full group.
+     */
+    OuterGroup(size_t group, size_t blocks, size_t data_rows)
+        : first(group * data_rows * OUTER_COLUMNS),
+          blocks(blocks),
+          columns(std::min(OUTER_COLUMNS, (blocks + data_rows - 1) / data_rows)),
+          rows((blocks + columns - 1) / columns) {}
+
+    /**
+     * @brief Get the index of a parity oligo.
+     * @param group Group number.
+     * @param row Parity row.
+     * @param column Column.
+     * @return The index, with PARITY_FLAG set.
+     */
+    uint64_t parity_index(size_t group, size_t row, size_t column) const {
+        return PARITY_FLAG | (static_cast<uint64_t>(group) << 32) | (static_cast<uint64_t>(blocks) << 16) | (row << 8) | column;
+    }
+};
+
+/**
+ * @brief Compute the parity oligos of one outer-code group.
+ *
+ * A row of a group is consecutive data oligos, so each step of the column-wise
+ * encoder is a SIMD multiply-add over 8 * columns bytes.
+ * @param group Layout of the group.
+ * @param rows The group's data blocks; padded with zeros here to whole rows.
+ * @param parity_rows Parity rows per group.
+ * @return Parity blocks, parity row by parity row, group.columns per row.
+ */
+std::vector<uint64_t> outer_group_parity(const OuterGroup& group, std::vector<uint64_t> rows, size_t parity_rows);
+
+/**
+ * @brief Make the duplexes of one outer-code group.
+ * @param group Group number.
+ * @param blocks The group's data blocks.
+ * @param tail_bp Bases of the last data oligo if it holds the partial last block of the data, else 0.
+ * @param data_rows Data rows in a full group.
+ * @param parity_rows Parity rows per group; 0 adds no parity oligos.
+ * @return Index and data oligos: the data oligos, then the parity oligos row by row.
+ */
+std::vector<std::pair<Oligo, Oligo>> outer_group_duplexes(size_t group, const std::vector<uint64_t>& blocks, size_t tail_bp,
+                                                          size_t data_rows, size_t parity_rows);
+
+/**
+ * @brief Compute the inner-code parity of many duplexes.
+ *
+ * The codewords are laid out back to back and encoded as one parallel batch.
+ * @param count Number of duplexes.
+ * @param duplex Returns the index and data oligos of duplex i.
+ * @param nsym Inner-code parity bytes.
+ * @param pool Threads for the batch encode.
+ * @return The parity oligo of each duplex.
+ */
+std::vector<Oligo> inner_parity_batch(size_t count, const std::function<std::pair<Oligo, Oligo>(size_t)>& duplex, size_t nsym,
+                                      ThreadPool& pool);
+
+/**
+ * @brief Strands the inner code has seen while decoding.
+ */
+struct InnerStats {
+    size_t corrected = 0;  ///< Strands with at least one byte corrected.
+    size_t rejected = 0;   ///< Strands with more damage than the parity bytes can correct.
+};
+
+/**
+ * @brief Split full-length strands into duplexes, correcting each with the inner code.
+ *
+ * With the inner code on, the strands' codewords are decoded as one parallel batch,
+ * and strands with more damage than the parity bytes can correct are left out.
+ * @param strands Strands of DUPLEX_BP + 4 * nsym bases.
+ * @param nsym Inner-code parity bytes; 0 if the inner code is off.
+ * @param pool Threads for the batch decode.
+ * @param out Output index and data oligos, in the order of the strands.
+ * @param stats Counts of corrected and rejected strands, added to.
+ */
+void split_strands(std::span<const std::string_view> strands, size_t nsym, ThreadPool& pool,
+                   std::vector<std::pair<Oligo, Oligo>>& out, InnerStats& stats);
+
+/**
+ * @brief Oligos the outer code has dealt with while decoding.
+ */
+struct OuterStats {
+    size_t recovered = 0;  ///< Lost data oligos rebuilt.
+    size_t corrected = 0;  ///< Data oligos read with errors and corrected.
+    size_t lost = 0;       ///< Lost data oligos in columns with too much damage.
+};
+
+/**
+ * @brief Recover lost data oligos from the outer code, correct damaged ones, and drop the parity oligos.
+ *
+ * The syndromes of a whole group are computed at once, so a group with every oligo
+ * present and every codeword clean costs one pass. Otherwise the codewords of each
+ * column with missing oligos or a non-zero syndrome are gathered, and those of all
+ * groups are decoded as one parallel batch, with the missing data and parity rows
+ * as erasures. Columns with more damage than the parity rows can fix are left
+ * as they are. Groups with fewer than half their parity oligos read are left
+ * uncorrected, and their data kept as read. Data oligos past the last group, or
+ * past the group after it when that one is full, are taken as damaged indices,
+ * and so are those read again.
+ * A corrected oligo keeps its number of bases, so the partial last block stays partial;
+ * if that block was lost it is recovered whole.
+ * @param decode_duplex Index and data oligos as read; parity oligos are removed and recovered ones added.
+ * @param outer_data_rows Data rows per outer-code group.
+ * @param outer_parity_rows Parity rows per outer-code group.
+ * @return What was recovered and corrected, or nothing if there were no parity oligos.
+ */
+std::optional<OuterStats> recover_outer(std::vector<std::pair<Oligo, Oligo>>& decode_duplex, size_t outer_data_rows,
+                                        size_t outer_parity_rows);
+
+/**
+ * @brief Count the data oligos from the parity oligos read.
+ * @param duplexes Index and data oligos as read.
+ * @param outer_data_rows Data rows per outer-code group.
+ * @param outer_parity_rows Parity rows per outer-code group.
+ * @return One past the last data index, from the shape of the last group; 0 if no parity oligo was read
+ * or the last group kept is full, so the data may go on into a group whose parity was lost.
+ */
+size_t outer_data_blocks(std::span<const std::pair<Oligo, Oligo>> duplexes, size_t outer_data_rows, size_t outer_parity_rows);
+
+/**
+ * @brief Split a strand that may hold the partial last block of the data.
+ *
+ * The last data oligo carries four bases per byte of the block, so its strand is
+ * 4 to 28 bases shorter than the others.
+ * @param strand A read shorter than DUPLEX_BP + 4 * nsym bases.
+ * @param nsym Inner-code parity bytes; 0 if the inner code is off.
+ * @return Its index and data oligos, or nothing if its length does not fit or the inner code rejects it.
+ */
+std::optional<std::pair<Oligo, Oligo>> split_tail(std::string_view strand, size_t nsym);
+
+/**
+ * @brief Pick the partial last block among the reads split_tail() accepted.
+ *
+ * A read with indels can have a tail's length, so the reads of the last index vote.
+ * @param tails Index and data oligos from split_tail().
+ * @param last Index of the last data oligo.
+ * @return The data oligo most of the reads of that index agree on, with its index, or nothing.
+ */
+std::optional<std::pair<Oligo, Oligo>> find_tail(std::span<const std::pair<Oligo, Oligo>> tails, uint64_t last);
+
+/**
+ * @brief Bytes an inner-code codeword protects: the index block, then the data block.
+ */
+const size_t INNER_MESSAGE_BYTES = 2 * sizeof(uint64_t);
+
+/**
+ * @brief Largest number of inner-code parity bytes: four bases per byte fill one oligo.
+ */
+const size_t MAX_INNER_PARITY = MAX_BP / 4;
+
+/**
+ * @brief Lay out the message of a duplex's inner codeword.
+ * @param index The index oligo.
+ * @param data The data oligo.
+ * @param out Output, INNER_MESSAGE_BYTES bytes: each block least significant byte first, as write_bin stores it.
+ */
+void inner_message(const Oligo& index, const Oligo& data, uint8_t* out);
+
+/**
+ * @brief Render inner-code parity bytes as an oligo, four bases per byte, first byte first.
+ * @param parity The parity bytes.
+ * @param nsym Number of parity bytes, at most MAX_INNER_PARITY.
+ * @return An oligo of 4 * nsym bases.
+ */
+Oligo parity_oligo(const uint8_t* parity, size_t nsym);
+
+/**
+ * @brief Read inner-code parity bytes back from their oligo.
+ * @param parity The parity oligo, four bases per byte.
+ * @param out Output, parity.bp() / 4 bytes.
+ */
+void parity_bytes(const Oligo& parity, uint8_t* out);
+
+/**
+ * @brief Compute the inner-code parity of a duplex.
+ * @param index The index oligo.
+ * @param data The data oligo.
+ * @param nsym Number of parity bytes, 1 to MAX_INNER_PARITY.
+ * @return The parity oligo, 4 * nsym bases.
+ */
+Oligo inner_encode(const Oligo& index, const Oligo& data, size_t nsym);
+
+/**
+ * @brief Correct a duplex with its inner-code parity.
+ *
+ * A substituted base changes one byte, so nsym parity bytes correct up to nsym / 2
+ * substitutions in different bytes of the strand.
+ * @param index The index oligo; corrected in place.
+ * @param data The data oligo; corrected in place.
+ * @param parity The parity oligo read with them.
+ * @param corrected If not null, receives the number of bytes corrected.
+ * @return False if the damage is beyond the code; the oligos are then left as they are.
+ */
+bool inner_decode(Oligo& index, Oligo& data, const Oligo& parity, unsigned int* corrected = nullptr);
+
+/**
+ * @brief Collects droplets and starts the fountain decoder once their segment count is settled.
+ *
+ * One substituted base can change the segment count in a droplet's index, or make a
+ * Reed-Solomon index look like a droplet. Droplets are therefore held until one count
+ * has DROPLET_QUORUM votes and a majority of them; droplets with any other count are
+ * dropped from then on. Counts of 0, or of more segments than the input can hold, get
+ * no vote.
+ */
+class DropletCollector {
+public:
+    /**
+     * @brief Prepare to collect droplets.
+     * @param max_segments Most segments the input can hold.
+     */
+    explicit DropletCollector(size_t max_segments = MAX_SEGMENTS) : max_segments(std::min(max_segments, MAX_SEGMENTS)) {}
+
+    /**
+     * @brief Add a droplet.
+     * @param index The droplet's index.
+     * @param payload The droplet's payload.
+     * @return True once the decoder knows every segment.
+     */
+    bool add(uint64_t index, uint64_t payload);
+
+    /**
+     * @brief Settle the segment count among the droplets held if no count reached a quorum.
+     * @return The decoder, or null if no count has two votes and a majority.
+     */
+    FountainDecoder* finish();
+
+    /**
+     * @brief Check whether the decoder knows every segment.
+     * @return False until the segment count is settled.
+     */
+    bool done() const { return fountain && fountain->done(); }
+
+private:
+    static constexpr size_t MAX_SEGMENTS = (1ULL << 30) - 1;  ///< Largest count a droplet index holds.
+
+    void start(size_t segments);
+
+    size_t max_segments;                                ///< Larger counts are damage.
+    std::optional<FountainDecoder> fountain;            ///< Decoder, once the count is settled.
+    std::map<size_t, size_t> votes;                     ///< Droplets held per segment count.
+    size_t voters = 0;                                  ///< Droplets held.
+    std::vector<std::pair<uint64_t, uint64_t>> held;    ///< Index and payload of the droplets held.
+};
+
+#endif // STRAND_HPP
@@ -0,0 +1,197 @@
+/**
+ * @file stream.hpp
+ * @brief In-memory encoder and decoder that stream through caller-supplied sinks, without files.
+ */
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "records.hpp"
+#include "strand.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Code settings of a stream. The decoder must use the encoder's; the defaults match Codec.
+ */
+struct StreamOptions {
+    std::size_t outer_data_rows = 223;   ///< Data rows per outer-code group.
+    std::size_t outer_parity_rows = 32;  ///< Parity rows per outer-code group; 0 turns the outer code off.
+    std::size_t inner_parity_bytes = 0;  ///< Inner-code parity bytes per strand; 0 turns the inner code off.
+};
+
+/**
+ * @brief Receives the strands an Encoder produces.
+ */
+class StrandSink {
+public:
+    virtual ~StrandSink() = default;
+
+    /**
+     * @brief Take a batch of strands.
+     * @param strands Strands of bases, as Codec writes them one per line; valid only during the call.
+     * @return False to stop encoding.
+     */
+    virtual bool write(std::span<const std::string> strands) = 0;
+};
+
+/**
+ * @brief Receives the bytes a Decoder recovers.
+ */
+class BlockSink {
+public:
+    virtual ~BlockSink() = default;
+
+    /**
+     * @brief Take decoded bytes.
+     *
+     * Ranges arrive in the order their strands are read. A range is written again if the
+     * outer code later corrects it, so the last write of a range wins.
+     * @param offset Position of the bytes in the encoded data, from the strand's index.
+     * @param bytes The bytes; valid only during the call.
+     * @return False to stop decoding.
+     */
+    virtual bool write(std::uint64_t offset, std::span<const std::byte> bytes) = 0;
+};
+
+/**
+ * @brief Encodes bytes into strands as they are pushed.
+ *
+ * Data is cut into 8-byte blocks. Each outer-code group is sent to the sink as one
+ * batch, its data strands followed by its parity strands, as soon as it is full, so
+ * at most one group of data is held. The strands are those Codec::encode() writes,
+ * in a different order. Fountain mode needs the whole input up front and is not offered.
+ */
+class Encoder {
+public:
+    /**
+     * @brief Prepare to encode.
+     * @param sink Receives the strands; must outlive the encoder.
+     * @param options Code settings.
+     * @param pool Threads for the batch encodes.
+     */
+    explicit Encoder(StrandSink& sink, StreamOptions options = {}, ThreadPool& pool = ThreadPool::shared());
+
+    /**
+     * @brief Encode more bytes.
+     * @param bytes The next bytes of the data.
+     * @return False if the settings are invalid, the sink refused a batch, or finish() was called.
+     */
+    bool push(std::span<const std::byte> bytes);
+
+    /**
+     * @brief Encode the last partial block and group.
+     * @return False if encoding failed at any point.
+     */
+    bool finish();
+
+    /**
+     * @brief Get the number of strands sent to the sink.
+     * @return Strands written so far.
+     */
+    std::size_t strands() const { return written; }
+
+    /**
+     * @brief Get the number of bytes pushed, which the decoder needs to end the data where it ended.
+     * @return Bytes encoded so far.
+     */
+    std::uint64_t bytes() const { return pushed; }
+
+private:
+    bool flush_group();
+
+    StrandSink& sink;                  ///< Destination of the strands.
+    StreamOptions options;             ///< Code settings.
+    ThreadPool& pool;                  ///< Threads for the batch encodes.
+    std::vector<std::uint64_t> blocks; ///< Data blocks of the group being filled.
+    std::uint64_t pending = 0;         ///< Bytes of a block not yet complete.
+    std::size_t pending_size = 0;      ///< Number of those bytes.
+    std::size_t tail_bp = 0;           ///< Bases of the last data oligo, once finish() has made it.
+    std::size_t group = 0;             ///< Number of the group being filled.
+    std::size_t written = 0;           ///< Strands sent to the sink.
+    std::uint64_t pushed = 0;          ///< Bytes pushed.
+    bool ok = true;                    ///< No error so far.
+    bool finished = false;             ///< finish() has been called.
+};
+
+/**
+ * @brief Decodes strands into bytes as records are pushed.
+ *
+ * Data strands are passed to the sink as soon as they are read (after the inner code,
+ * if on). Parity strands, droplets and reads with indels are kept until finish(), which
+ * reconstructs the reads with indels, solves the fountain code and runs the outer code,
+ * and sends what they recover or correct. Only the first read of each index is used.
+ */
+class Decoder {
+public:
+    /**
+     * @brief Prepare to decode.
+     * @param sink Receives the bytes; must outlive the decoder.
+     * @param options Code settings the strands were encoded with.
+     * @param pool Threads for the batch decodes.
+     */
+    explicit Decoder(BlockSink& sink, StreamOptions options = {}, ThreadPool& pool = ThreadPool::shared());
+
+    /**
+     * @brief Decode a batch of records.
+     * @param records Reads, such as a batch from RecordReader; only needed during the call.
+     * @return False if the settings are invalid, the sink refused a range, or finish() was called.
+     */
+    bool push(std::span<const Record> records);
+
+    /**
+     * @brief Give the length of the data, as Encoder::bytes() reported it.
+     *
+     * Nothing is then sent past the end of the data. Without it, the length is taken
+     * from the strand of the partial last block when one is read; if that strand was
+     * lost and the outer code recovers it, its block is sent whole.
+     * @param bytes Bytes encoded.
+     */
+    void set_length(std::uint64_t bytes) { data_length = bytes; }
+
+    /**
+     * @brief Recover what the reads with indels, the fountain code and the outer code allow.
+     * @return False if decoding failed at any point.
+     */
+    bool finish();
+
+    /**
+     * @brief Get the number of distinct data blocks sent to the sink.
+     * @return Blocks known so far.
+     */
+    std::size_t blocks() const { return data.size(); }
+
+    /**
+     * @brief Get the number of strands the inner code could not correct.
+     * @return Strands dropped.
+     */
+    std::size_t rejected() const { return inner_rejected; }
+
+private:
+    bool add(std::span<const std::pair<std::uint64_t, std::uint64_t>> duplexes);
+    bool emit(std::uint64_t index, std::uint64_t block);
+    void add_tail();
+
+    BlockSink& sink;                                      ///< Destination of the bytes.
+    StreamOptions options;                                ///< Code settings.
+    ThreadPool& pool;                                     ///< Threads for the batch decodes.
+    std::unordered_map<std::uint64_t, std::uint64_t> data; ///< Data block of each index read.
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> parity; ///< Outer-code parity strands read.
+    DropletCollector droplets;                            ///< Droplets, and the fountain decoder once they agree.
+    std::vector<std::pair<Oligo, Oligo>> tails;           ///< Reads short enough to hold the partial last block.
+    std::optional<std::uint64_t> data_length;             ///< Bytes of data, once known.
+    std::string noisy;                                    ///< Reads with indels, back to back.
+    std::vector<std::size_t> noisy_ends;                  ///< End offset of each of them in noisy.
+    std::size_t inner_rejected = 0;                       ///< Strands the inner code dropped.
+    bool ok = true;                                       ///< No error so far.
+    bool finished = false;                                ///< finish() has been called.
+};
+
+#endif // STREAM_HPP
@@ -0,0 +1,295 @@
+/**
+ * @file thread_pool.hpp
+ * @brief A fixed-size work-stealing pool of worker threads, with a process-wide shared instance.
+ */
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Counters of a ThreadPool, for tuning.
+ */
+struct ThreadPoolStats {
+    std::size_t submitted = 0;          ///< Tasks submitted.
+    std::size_t executed = 0;           ///< Tasks started.
+    std::size_t stolen = 0;             ///< Tasks a worker took from another worker's queue.
+    std::size_t queued = 0;             ///< Tasks waiting right now, over all queues.
+    std::size_t max_depth = 0;          ///< Deepest any one queue has been.
+    std::vector<std::size_t> depth;     ///< Tasks waiting right now in each worker's queue.
+};
+
+/**
+ * @brief Runs submitted tasks on a fixed set of worker threads.
+ *
+ * Each worker owns a deque. A task submitted from one of the pool's own tasks goes on
+ * the back of that worker's deque, and the worker takes its next task from the back
+ * too, so related work stays on the core whose cache holds its data. Other tasks are
+ * dealt round-robin over the deques. A worker with an empty deque steals from the front
+ * of the others', the oldest and usually largest pieces of work. Idle workers sleep.
+ *
+ * Stages should share one pool, ThreadPool::shared(), rather than start their own
+ * threads, so the host is not oversubscribed when several run at once.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Start the worker threads.
+     * @param threads Number of workers; 0 uses one per hardware thread.
+     * @param pin Bind worker i to CPU i (modulo the CPU count), where the platform allows it.
+     */
+    explicit ThreadPool(std::size_t threads = 0, bool pin = false) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        queues.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i)
+            queues.push_back(std::make_unique<Queue>());
+        workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { run(i); });
+            if (pin)
+                pin_to_cpu(workers.back(), i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Finish the queued tasks and join the workers.
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    /**
+     * @brief Get the pool every stage shares, started on first use.
+     *
+     * DNA_THREADS sets its number of workers (default: one per hardware thread), and
+     * DNA_PIN_THREADS=1 binds each worker to a CPU.
+     * @return The shared pool.
+     */
+    static ThreadPool& shared() {
+        static ThreadPool pool(env_threads(), env_pin());
+        return pool;
+    }
+
+    /**
+     * @brief Get the number of worker threads.
+     * @return The number of workers.
+     */
+    std::size_t size() const { return workers.size(); }
+
+    /**
+     * @brief Queue a callable for execution.
+     * @param f The callable to run.
+     * @return A future holding the callable's result.
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& f) {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> result = task->get_future();
+
+        const std::size_t target = (current_pool == this) ? current_worker : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        Queue& queue = *queues[target];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.emplace_back([task] { (*task)(); });
+            queue.max_depth = std::max(queue.max_depth, queue.tasks.size());
+        }
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        pending.fetch_add(1);
+        { std::lock_guard lock(sleep_mutex); }  // a worker between its check and its wait sees pending or gets the notify
+        wake.notify_one();
+        return result;
+    }
+
+    /**
+     * @brief Run f over the index range [0, count) on the workers and the calling thread.
+     *
+     * The range is cut into chunks that the threads claim from a shared counter as they
+     * finish, so uneven work balances out. Called from one of the pool's own tasks, the
+     * calling worker runs other queued tasks while it waits, so nested loops cannot
+     * deadlock the pool.
+     * @param count Number of indices.
+     * @param f Callable taking a chunk as (begin, end).
+     */
+    template <typename F>
+    void parallel_for(std::size_t count, F&& f) {
+        if (count == 0)
+            return;
+        const std::size_t chunk = std::max<std::size_t>(1, count / (8 * size()));
+        std::atomic<std::size_t> next{0};
+        auto work = [&] {
+            for (std::size_t begin; (begin = next.fetch_add(chunk)) < count;)
+                f(begin, std::min(count, begin + chunk));
+        };
+
+        std::vector<std::future<void>> helpers;
+        const std::size_t chunks = (count + chunk - 1) / chunk;
+        for (std::size_t i = 1; i < std::min(size() + 1, chunks); ++i)
+            helpers.push_back(submit(work));
+        work();
+        for (auto& helper : helpers)
+            wait(helper);
+    }
+
+    /**
+     * @brief Wait for a future of this pool's tasks.
+     *
+     * On one of the pool's workers, queued tasks are run while waiting instead of blocking.
+     * @param result The future.
+     */
+    template <typename R>
+    void wait(std::future<R>& result) {
+        if (current_pool == this) {
+            while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                if (!run_one(current_worker))
+                    std::this_thread::yield();
+        }
+        result.wait();
+    }
+
+    /**
+     * @brief Get the scheduler's counters.
+     * @return Submitted, executed and stolen tasks, and queue depths.
+     */
+    ThreadPoolStats stats() const {
+        ThreadPoolStats s;
+        s.submitted = submitted.load(std::memory_order_relaxed);
+        for (const auto& queue : queues) {
+            std::lock_guard lock(queue->mutex);
+            s.depth.push_back(queue->tasks.size());
+            s.queued += queue->tasks.size();
+            s.max_depth = std::max(s.max_depth, queue->max_depth);
+            s.executed += queue->executed;
+            s.stolen += queue->stolen;
+        }
+        return s;
+    }
+
+private:
+    /**
+     * @brief A worker's deque and its counters, guarded by its own mutex.
+     */
+    struct Queue {
+        mutable std::mutex mutex;                   ///< Guards the members below.
+        std::deque<std::function<void()>> tasks;    ///< Waiting tasks; the owner works at the back.
+        std::size_t max_depth = 0;                  ///< Deepest the deque has been.
+        std::size_t executed = 0;                   ///< Tasks the owner has started.
+        std::size_t stolen = 0;                     ///< Of those, tasks taken from other deques.
+    };
+
+    static std::size_t env_threads() {
+        const char* value = std::getenv("DNA_THREADS");
+        return value ? std::strtoul(value, nullptr, 10) : 0;
+    }
+
+    static bool env_pin() {
+        const char* value = std::getenv("DNA_PIN_THREADS");
+        return value && std::string(value) == "1";
+    }
+
+    static void pin_to_cpu([[maybe_unused]] std::thread& thread, [[maybe_unused]] std::size_t index) {
+#ifdef __linux__
+        const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+    }
+
+    /**
+     * @brief Take a task from the back of a worker's own deque, or steal one from the front of another.
+     * @param self The worker.
+     * @return False if every deque was empty.
+     */
+    bool run_one(std::size_t self) {
+        std::function<void()> task;
+        bool stole = false;
+        {
+            Queue& own = *queues[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+        for (std::size_t k = 1; !task && k < queues.size(); ++k) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                stole = true;
+            }
+        }
+        if (!task)
+            return false;
+
+        pending.fetch_sub(1);
+        {
+            Queue& own = *queues[self];
+            std::lock_guard lock(own.mutex);
+            own.executed++;
+            own.stolen += stole;
+        }
+        task();
+        return true;
+    }
+
+    void run(std::size_t self) {
+        current_pool = this;
+        current_worker = self;
+        for (;;) {
+            if (run_one(self))
+                continue;
+            std::unique_lock lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping || pending.load() > 0; });
+            if (stopping && pending.load() == 0)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;  ///< One deque per worker.
+    std::vector<std::thread> workers;            ///< Worker threads.
+    std::atomic<std::size_t> pending{0};         ///< Tasks queued and not yet taken.
+    std::atomic<std::size_t> submitted{0};       ///< Tasks ever submitted.
+    std::atomic<std::size_t> next_queue{0};      ///< Round-robin target for tasks from outside the pool.
+    std::mutex sleep_mutex;                      ///< Guards stopping, and the sleep of idle workers.
+    std::condition_variable wake;                ///< Signals new tasks or shutdown.
+    bool stopping = false;                       ///< Set by the destructor.
+
+    static inline thread_local const ThreadPool* current_pool = nullptr; ///< Pool of the calling worker, if any.
+    static inline thread_local std::size_t current_worker = 0;           ///< Index of the calling worker in it.
+};
+
+#endif // THREAD_POOL_HPP
@@ -15,6 +15,10 @@
 #include <unordered_map>
 #include<ranges>
 #include<numeric>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
 /**
  * @brief Enum representing nucleotide types.
  */
@@ -63,7 +67,7 @@ double calculateGCContent(const std::string& sequence);
  * @param sequence The input oligonucleotide sequence.
  * @return The maximum homopolymer length.
  */
-int calculateMaxHomopolymerLen(const std::string& sequence);
+int calculateMaxHomopolymerLen(std::string_view sequence);
 
 /**
  * @brief Generates the reverse complement of a DNA sequence.
@@ -72,6 +76,65 @@ int calculateMaxHomopolymerLen(const std::string& sequence);
  */
 std::string revcom(const std::string& dna);
 
+/**
+ * @brief Scratch memory shared by the dynamic programming alignment routines.
+ *
+ * A bump arena: allocations are carved out of a single block and released all
+ * at once by reset(). Requests that do not fit spill into temporary blocks, and
+ * the next reset() coalesces them into one block sized to the largest problem
+ * seen so far. Once warmed up, alignments perform no heap allocation.
+ *
+ * A workspace is not thread-safe; use one per thread (see thread_workspace()).
+ */
+class AlignmentWorkspace {
+public:
+    AlignmentWorkspace() = default;
+
+    /**
+     * @brief Construct a workspace with an initial arena size.
+     * @param bytes Number of bytes to preallocate.
+     */
+    explicit AlignmentWorkspace(std::size_t bytes);
+
+    /**
+     * @brief Release every allocation, growing the arena to the high-water mark if it spilled.
+     */
+    void reset();
+
+    /**
+     * @brief Allocate an uninitialized array from the arena.
+     * @tparam T Trivially destructible element type.
+     * @param n Number of elements.
+     * @return A span over the allocated elements, valid until the next reset().
+     */
+    template <typename T>
+    std::span<T> alloc(std::size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destroyed");
+        return { static_cast<T*>(allocate(n * sizeof(T), alignof(T))), n };
+    }
+
+    /**
+     * @brief Get the size of the arena block.
+     * @return The number of bytes available without spilling.
+     */
+    std::size_t capacity() const { return block_size; }
+
+private:
+    void* allocate(std::size_t bytes, std::size_t align);
+
+    std::unique_ptr<std::byte[]> block;                 ///< Main arena block.
+    std::size_t block_size = 0;                         ///< Size of the main block.
+    std::size_t used = 0;                               ///< Bytes handed out from the main block.
+    std::vector<std::unique_ptr<std::byte[]>> spill;    ///< Overflow blocks since the last reset.
+    std::size_t spilled = 0;                            ///< Bytes held by the overflow blocks.
+};
+
+/**
+ * @brief Get the workspace owned by the calling thread.
+ * @return A thread-local AlignmentWorkspace used by the overloads without a workspace argument.
+ */
+AlignmentWorkspace& thread_workspace();
+
 /**
  * @brief Calculates the Levenshtein distance between two strings.
  * @param str1 The first string.
@@ -80,6 +143,15 @@ std::string revcom(const std::string& dna);
  */
 int levenshtein_distance(const std::string& str1, const std::string& str2);
 
+/**
+ * @brief Calculates the Levenshtein distance between two strings using caller-supplied scratch memory.
+ * @param str1 The first string.
+ * @param str2 The second string.
+ * @param ws Workspace providing the DP rows; reset on entry.
+ * @return The Levenshtein distance between str1 and str2.
+ */
+int levenshtein_distance(std::string_view str1, std::string_view str2, AlignmentWorkspace& ws);
+
 /**
  * @brief Matches two strings allowing '?' for matching any character.
  * @param p The first string.
@@ -89,6 +161,16 @@ int levenshtein_distance(const std::string& str1, const std::string& str2);
  */
 bool Match(const std::string& p, const std::string& q, int maxdist);
 
+/**
+ * @brief Matches two strings using caller-supplied scratch memory.
+ * @param p The first string.
+ * @param q The second string.
+ * @param maxdist The maximum allowed distance.
+ * @param ws Workspace providing the DP rows; reset on entry.
+ * @return True if the strings match within the specified maximum distance, false otherwise.
+ */
+bool Match(std::string_view p, std::string_view q, int maxdist, AlignmentWorkspace& ws);
+
 /**
  * @brief Finds the minimum of two pairs.
  * @param a First integer.
@@ -121,6 +203,18 @@ void update_distances(int& fj1, int& lj1, int cbMismatch, int& mdist, int& mn, i
  */
 bool Find(const std::string& s, const std::string& subseq, int maxdist, int& pos, int& length);
 
+/**
+ * @brief Finds a substring in a string using caller-supplied scratch memory.
+ * @param s The original string.
+ * @param subseq The substring to find.
+ * @param maxdist The maximum allowed distance.
+ * @param pos Output parameter for the position in the original string.
+ * @param length Output parameter for the length of the found substring.
+ * @param ws Workspace providing the DP rows; reset on entry.
+ * @return True if the substring is found within the specified maximum distance, false otherwise.
+ */
+bool Find(std::string_view s, std::string_view subseq, int maxdist, int& pos, int& length, AlignmentWorkspace& ws);
+
 /**
  * @brief Finds the position and length of the longest prefix with up to maxdist errors.
  * @param s The original string.
@@ -147,4 +241,14 @@ std::pair<int, int> FindSuffix(const std::string& s, const std::string& suffix,
  */
 std::pair<int, std::string> Diff(const std::string& from, const std::string& to);
 
+/**
+ * @brief Computes the difference between two strings using caller-supplied scratch memory.
+ * @param from The source string.
+ * @param to The target string.
+ * @param diff Output edit actions ('-', 'R', 'I', 'D'); its capacity is reused across calls.
+ * @param ws Workspace providing the DP row and backtrack matrix; reset on entry.
+ * @return The minimum edit distance.
+ */
+int Diff(std::string_view from, std::string_view to, std::string& diff, AlignmentWorkspace& ws);
+
 #endif
@@ -1,11 +1,41 @@
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <vector>
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <ostream>
+#include <span>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include "consensus.hpp"
+#include "fountain.hpp"
 #include "io.hpp"
-#include "oligo.cpp"
+#include "pipeline.hpp"
+#include "records.hpp"
+#include "thread_pool.hpp"
+#include "strand.hpp"
+
+/**
+ * @brief Outer-code groups each queue between encode pipeline stages holds.
+ */
+const size_t PIPELINE_DEPTH = 4;
+
+/**
+ * @brief One outer-code group on its way through the encode pipeline; each stage fills in its part.
+ */
+struct EncodeBatch {
+    size_t group = 0;                              ///< Group number.
+    size_t bytes = 0;                              ///< Input bytes the group holds.
+    size_t tail_bp = 0;                            ///< Bases of the last data oligo if it holds the partial last block, else 0.
+    std::vector<uint64_t> blocks;                  ///< Data blocks, from the packetize stage.
+    std::vector<std::pair<Oligo, Oligo>> duplexes; ///< Data and parity duplexes, from the outer-code stage.
+    std::vector<Oligo> inner;                      ///< Inner-code parity oligos, from the inner-code stage.
+    std::string text;                              ///< Strands one per line, from the render stage.
+};
 
 /**
  * @brief Codec class for handling files and Oligo data.
@@ -19,6 +49,14 @@ private:
     std::vector<std::pair<Oligo, Oligo*>> oligo_duplex; // Oligo* points to an entry in oligo_vec
     std::vector<std::pair<Oligo, Oligo>> decode_duplex;
     std::vector<Oligo*> decode_vec; ///< Vector to store Oligo objects.
+    bool direct_io = false; ///< Write output files with O_DIRECT.
+    std::vector<std::string> lanes; ///< Further input files decoded together with filename.
+    size_t outer_data_rows = OUTER_DATA_ROWS; ///< Data rows per outer-code group.
+    size_t outer_parity_rows = OUTER_PARITY_ROWS; ///< Parity rows per outer-code group; 0 turns the outer code off.
+    double fountain_overhead = 0; ///< Extra droplets per segment in fountain mode; 0 uses the Reed-Solomon outer code.
+    size_t inner_parity_bytes = 0; ///< Inner-code parity bytes per duplex; 0 turns the inner code off.
+    std::vector<Oligo> inner_parity; ///< Inner-code parity oligo of each entry in oligo_duplex.
+    InnerStats inner_stats; ///< Strands the inner code corrected or rejected while decoding.
 
 public:
     /**
@@ -63,6 +101,77 @@ public:
      */
     std::string get_filetype() const { return std::filesystem::path(get_filename()).extension().string(); }
 
+    /**
+     * @brief Function to write output files bypassing the page cache (O_DIRECT).
+     * @param direct True to request O_DIRECT; ignored where the file system refuses it.
+     */
+    void set_direct_io(bool direct) { direct_io = direct; }
+
+    /**
+     * @brief Function to add another input file (sequencing lane) to decode along with the main one.
+     * @param lane The name of the file.
+     */
+    void add_lane(const std::string& lane) { lanes.push_back(lane); }
+
+    /**
+     * @brief Function to set the outer code across oligos. Decoding must use the same setting.
+     * @param data_rows Data rows per group.
+     * @param parity_rows Parity rows per group (oligos that may be lost from each column); 0 turns the outer code off.
+     * @return False if the parameters do not fit an RS code over GF(2^8).
+     */
+    bool set_outer_code(size_t data_rows, size_t parity_rows) {
+        if (data_rows == 0 || data_rows + parity_rows >= 256) {
+            std::cerr << "Outer code must have 1 to 255 rows in total" << std::endl;
+            return false;
+        }
+        outer_data_rows = data_rows;
+        outer_parity_rows = parity_rows;
+        fountain_overhead = 0;
+        return true;
+    }
+
+    /**
+     * @brief Function to encode with a rateless fountain code instead of the Reed-Solomon outer code.
+     *
+     * Every oligo is then a droplet, the XOR of segments (data blocks) chosen by its seed,
+     * and any set of slightly more droplets than segments usually decodes. Decoding needs
+     * no setting: droplets are recognised by their indices.
+     * @param overhead Extra droplets per segment, above 0 and at most 3.
+     * @return False if the overhead is out of range.
+     */
+    bool set_fountain(double overhead = FOUNTAIN_OVERHEAD) {
+        if (!(overhead > 0 && overhead <= 3)) {
+            std::cerr << "Fountain overhead must be above 0 and at most 3" << std::endl;
+            return false;
+        }
+        fountain_overhead = overhead;
+        return true;
+    }
+
+    /**
+     * @brief Function to protect each duplex with an inner Reed-Solomon code. Decoding must use the same setting.
+     *
+     * The index and data blocks of every strand get their own parity bytes, written as a
+     * third oligo of four bases per byte after the data oligo, so substitutions in a single
+     * read are corrected and reads beyond repair are dropped before the outer code sees them.
+     * @param parity_bytes Parity bytes per duplex, at most MAX_INNER_PARITY; 0 turns the inner code off.
+     * @return False if there are too many parity bytes.
+     */
+    bool set_inner_code(size_t parity_bytes = INNER_PARITY_BYTES) {
+        if (parity_bytes > MAX_INNER_PARITY) {
+            std::cerr << "Inner code can have at most " << MAX_INNER_PARITY << " parity bytes" << std::endl;
+            return false;
+        }
+        inner_parity_bytes = parity_bytes;
+        return true;
+    }
+
+    /**
+     * @brief Function to get the length of an encoded strand.
+     * @return DUPLEX_BP plus the bases of the inner-code parity.
+     */
+    size_t strand_bp() const { return DUPLEX_BP + 4 * inner_parity_bytes; }
+
     /**
      * @brief Function to print filename, filesize, and filetype.
      */
@@ -109,42 +218,174 @@ public:
     {
         size_t num_blocks = filesize / sizeof(uint64_t);
         size_t remaining_bytes = filesize % 8;
-        oligo_vec.reserve(num_blocks + (remaining_bytes ? 1 : 0));
-        oligo_duplex.reserve(num_blocks + (remaining_bytes ? 1 : 0));
-
-        // Read data into a uint64_t, construct Oligo, and emplace into the vector
-        for (size_t i = 0; i < num_blocks; ++i) {
-            uint64_t data_block;
-            if (!file.read(reinterpret_cast<char*>(&data_block), sizeof(uint64_t))) {
+        // oligo_duplex points into oligo_vec, so room for the parity oligos is reserved up front
+        size_t total_blocks = num_blocks + (remaining_bytes ? 1 : 0);
+        oligo_vec.reserve(total_blocks + outer_parity_count(total_blocks));
+        oligo_duplex.reserve(total_blocks + outer_parity_count(total_blocks));
+
+        // Read ahead in large blocks so the disk stays busy while blocks are packed
+        std::unique_ptr<ByteSource> source = open_file_source(filename);
+        std::vector<char> buffer(IO_BUFFER_SIZE);
+        size_t remaining = static_cast<size_t>(filesize);
+
+        for (size_t i = 0; remaining > 0;) {
+            size_t wanted = std::min(buffer.size(), remaining);
+            if (source->read_full(buffer.data(), wanted) != wanted) {
                 std::cerr << "Error reading file: " << filename << std::endl;
-                oligo_vec.clear(); // Clear the vector in case of an error
-                return; // Exit the constructor if there was an error reading the file
+                oligo_vec.clear(); // Clear the vectors in case of an error
+                oligo_duplex.clear();
+                return;
+            }
+            remaining -= wanted;
+
+            // Construct an Oligo from each uint64_t and emplace it into the vector
+            size_t whole = wanted / sizeof(uint64_t);
+            for (size_t j = 0; j < whole; ++j, ++i) {
+                uint64_t data_block;
+                std::memcpy(&data_block, buffer.data() + j * sizeof(uint64_t), sizeof(uint64_t));
+                oligo_vec.emplace_back(MAX_BP, data_block);
+                oligo_duplex.emplace_back(Oligo(MAX_BP, i), &oligo_vec.back());
+            }
+
+            // Buffers hold whole blocks, so only the end of the file can leave remaining bytes
+            if (wanted % sizeof(uint64_t)) {
+                uint64_t data_block = 0;
+                std::memcpy(&data_block, buffer.data() + whole * sizeof(uint64_t), remaining_bytes);
+                oligo_vec.emplace_back(remaining_bytes * 4, data_block);  // Four bases per byte
+                oligo_duplex.emplace_back(Oligo(MAX_BP, num_blocks), &oligo_vec.back());
             }
-            oligo_vec.emplace_back(MAX_BP, data_block);
-            oligo_duplex.emplace_back(Oligo(MAX_BP, i), &oligo_vec.back());
         }
 
-        // Handle the remaining bytes using a single buffer
-        if (remaining_bytes > 0) {
-            uint64_t data_block = 0;;
-            if (!file.read(reinterpret_cast<char*>(&data_block), remaining_bytes)) {
-                std::cerr << "Error reading remaining bytes from file: " << filename << std::endl;
-                oligo_vec.clear(); // Clear the vector in case of an error
-                oligo_duplex.clear();
-                return; // Exit the constructor if there was an error reading the remaining bytes
+        if (fountain_overhead > 0)
+            encode_fountain(total_blocks);
+        else
+            encode_outer(total_blocks);
+        encode_inner();
+    }
+
+    /**
+     * @brief Function to count the parity oligos the outer code adds.
+     * @param total_blocks Number of data oligos.
+     * @return Number of parity oligos.
+     */
+    size_t outer_parity_count(size_t total_blocks) const {
+        if (outer_parity_rows == 0 || fountain_overhead > 0)
+            return 0;
+        const size_t group_blocks = outer_data_rows * OUTER_COLUMNS;
+        size_t count = (total_blocks / group_blocks) * outer_parity_rows * OUTER_COLUMNS;
+        if (total_blocks % group_blocks)
+            count += outer_parity_rows * OuterGroup(0, total_blocks % group_blocks, outer_data_rows).columns;
+        return count;
+    }
+
+    /**
+     * @brief Function to append the outer-code parity oligos after the data oligos.
+     *
+     * The groups are encoded in parallel.
+     * @param total_blocks Number of data oligos.
+     */
+    void encode_outer(size_t total_blocks) {
+        if (outer_parity_rows == 0 || total_blocks == 0)
+            return;
+
+        const size_t group_blocks = outer_data_rows * OUTER_COLUMNS;
+        const size_t groups = (total_blocks + group_blocks - 1) / group_blocks;
+        if (groups >= (1ULL << 31)) {
+            std::cerr << "File too large for the outer code" << std::endl;
+            return;
+        }
+        ThreadPool& pool = ThreadPool::shared();
+        std::vector<std::future<std::vector<uint64_t>>> parity(groups);
+        for (size_t g = 0; g < groups; ++g) {
+            parity[g] = pool.submit([&, g] {
+                OuterGroup group(g, std::min(group_blocks, total_blocks - g * group_blocks), outer_data_rows);
+                std::vector<uint64_t> rows(group.blocks);
+                for (size_t i = 0; i < group.blocks; ++i)
+                    rows[i] = oligo_vec[group.first + i].data();
+                return outer_group_parity(group, std::move(rows), outer_parity_rows);
+            });
+        }
+
+        for (size_t g = 0; g < groups; ++g) {
+            OuterGroup group(g, std::min(group_blocks, total_blocks - g * group_blocks), outer_data_rows);
+            std::vector<uint64_t> words = parity[g].get();
+            for (size_t j = 0; j < outer_parity_rows; ++j) {
+                for (size_t c = 0; c < group.columns; ++c) {
+                    oligo_vec.emplace_back(MAX_BP, words[j * group.columns + c]);
+                    oligo_duplex.emplace_back(Oligo(MAX_BP, group.parity_index(g, j, c)), &oligo_vec.back());
+                }
             }
-            oligo_vec.emplace_back(remaining_bytes * 8, data_block);  // Adjust the bit count
-            oligo_duplex.emplace_back(Oligo(MAX_BP, num_blocks), &oligo_vec.back());
         }
     }
 
+    /**
+     * @brief Function to replace the data oligos with fountain-code droplets.
+     *
+     * Droplet i has seed i, and its index carries DROPLET_FLAG, the number of
+     * segments and the seed. The droplets are computed in parallel.
+     * @param total_blocks Number of data oligos (segments).
+     */
+    void encode_fountain(size_t total_blocks) {
+        if (total_blocks == 0)
+            return;
+        if (total_blocks >= (1ULL << 30)) {
+            std::cerr << "File too large for the fountain code" << std::endl;
+            return;
+        }
+
+        std::vector<uint64_t> segments(total_blocks);
+        for (size_t i = 0; i < total_blocks; ++i)
+            segments[i] = oligo_vec[i].data();
+        const size_t count = static_cast<size_t>(std::ceil(total_blocks * (1 + fountain_overhead)));
+        std::vector<uint64_t> payloads(count);
+        ThreadPool& pool = ThreadPool::shared();
+        FountainEncoder(segments).droplets(0, payloads, pool);
+
+        oligo_duplex.clear();
+        oligo_vec.clear();
+        oligo_vec.reserve(count);
+        oligo_duplex.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            oligo_vec.emplace_back(MAX_BP, payloads[i]);
+            oligo_duplex.emplace_back(Oligo(MAX_BP, DROPLET_FLAG | (total_blocks << 32) | i), &oligo_vec.back());
+        }
+    }
+
+    /**
+     * @brief Function to compute the inner-code parity of every duplex.
+     */
+    void encode_inner() {
+        inner_parity.clear();
+        if (inner_parity_bytes == 0 || oligo_duplex.empty())
+            return;
+        ThreadPool& pool = ThreadPool::shared();
+        inner_parity = inner_parity_batch(oligo_duplex.size(), [&](size_t i) {
+            return std::pair<Oligo, Oligo>(oligo_duplex[i].first, *oligo_duplex[i].second);
+        }, inner_parity_bytes, pool);
+    }
+
+    /**
+     * @brief Function to get the strand of one duplex as written.
+     * @param i Entry in oligo_duplex.
+     * @return Index oligo, data oligo and, with the inner code on, the parity oligo.
+     */
+    std::string strand(size_t i) const {
+        std::string line = oligo_duplex[i].first.seq() + oligo_duplex[i].second->seq();
+        if (i < inner_parity.size())
+            line += inner_parity[i].seq();
+        return line;
+    }
+
     /**
      * @brief Function to dump Oligo information from duplex to the console.
      */
     void dump_duplex() const {
         for (size_t i = 0; i < oligo_duplex.size(); ++i) {
             std::cout << std::setw(8) << std::setfill('0') << i << " | ";
-            std::cout << oligo_duplex[i].first.seq() << "-" << oligo_duplex[i].second->seq() << std::endl;
+            std::cout << oligo_duplex[i].first.seq() << "-" << oligo_duplex[i].second->seq();
+            if (i < inner_parity.size())
+                std::cout << "-" << inner_parity[i].seq();
+            std::cout << std::endl;
         }
     }
     /**
@@ -154,8 +395,8 @@ public:
         std::vector<std::string> nt_vec;
         nt_vec.reserve(oligo_duplex.size());
 
-        for (const auto& [first, second] : oligo_duplex)
-            nt_vec.emplace_back(first.seq() + second->seq());
+        for (size_t i = 0; i < oligo_duplex.size(); ++i)
+            nt_vec.emplace_back(strand(i));
 
         return nt_vec;
     }
@@ -164,57 +405,401 @@ public:
      * @brief Function to dump Oligo information from duplex to a file.
      */
     void write_duplex() const {
-        std::ofstream outfile(get_filename() + ".encode");
+        // Lines are written behind, through io_uring or a writer thread, while the next ones are formatted
+        std::unique_ptr<ByteSink> outfile = open_async_sink(get_filename() + ".encode", oligo_duplex.size() * (strand_bp() + 1), direct_io);
 
-        if (!outfile.is_open()) {
+        if (!outfile->is_open()) {
             std::cerr << "Error opening file for writing: " << get_filename() + ".encode" << std::endl;
             return;
         }
 
-        for (size_t i = 0; i < oligo_duplex.size(); ++i)
-            outfile << oligo_duplex[i].first.seq() << oligo_duplex[i].second->seq() << std::endl;
+        std::string line;
+        line.reserve(strand_bp() + 1);
+        for (size_t i = 0; i < oligo_duplex.size(); ++i) {
+            line = oligo_duplex[i].first.seq();
+            line += oligo_duplex[i].second->seq();
+            if (i < inner_parity.size())
+                line += inner_parity[i].seq();
+            line += '\n';
+            outfile->write(line);
+        }
 
+        if (!outfile->close()) {
+            std::cerr << "Error writing file: " << get_filename() + ".encode" << std::endl;
+            return;
+        }
         std::cout << "Input file encoded and written to: " << get_filename() + ".encode" << std::endl;
     }
 
     /**
-     * @brief Function to encode the file data into Oligo objects.
+     * @brief Function to encode the file straight into <filename>.encode through a staged pipeline.
+     *
+     * Reading, cutting into blocks, the outer code, the inner code, formatting and writing
+     * run at once on their own threads, an outer-code group at a time, connected by
+     * bounded queues: at most a few groups are in flight, and a slow stage (usually the
+     * disk) holds back the ones before it. The outer code runs on several threads, and the
+     * inner code and formatting on the shared pool. The file holds the strands encode()
+     * and write_duplex() write, each group's data strands followed by its parity strands.
+     * Fountain mode needs the whole file at once and is not offered.
+     * @param stats If not null, receives the throughput and waiting of each stage.
+     * @return False if a file could not be read or written.
+     */
+    bool encode_pipelined(std::vector<StageStats>* stats = nullptr) const {
+        if (fountain_overhead > 0) {
+            std::cerr << "Fountain mode needs the whole file; use encode()" << std::endl;
+            return false;
+        }
+        const size_t group_blocks = outer_data_rows * OUTER_COLUMNS;
+        const size_t total_blocks = (static_cast<size_t>(filesize) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if (total_blocks > 0 && (total_blocks - 1) / group_blocks >= (1ULL << 31)) {
+            std::cerr << "File too large for the outer code" << std::endl;
+            return false;
+        }
+
+        std::unique_ptr<ByteSource> source = open_file_source(filename);
+        const std::string outname = get_filename() + ".encode";
+        const size_t line_bp = strand_bp() + 1;
+        std::unique_ptr<ByteSink> outfile = open_async_sink(outname, (total_blocks + outer_parity_count(total_blocks)) * line_bp, direct_io);
+        if (!outfile->is_open()) {
+            std::cerr << "Error opening file for writing: " << outname << std::endl;
+            return false;
+        }
+
+        ThreadPool& pool = ThreadPool::shared();
+        Pipeline pipeline;
+        auto& chunks = pipeline.queue<SpscQueue<std::vector<char>>>(PIPELINE_DEPTH);
+        auto& packets = pipeline.queue<MpmcQueue<EncodeBatch>>(PIPELINE_DEPTH);
+        auto& coded = pipeline.queue<MpmcQueue<EncodeBatch>>(PIPELINE_DEPTH);
+        auto& inner_coded = pipeline.queue<SpscQueue<EncodeBatch>>(PIPELINE_DEPTH);
+        auto& rendered = pipeline.queue<SpscQueue<EncodeBatch>>(PIPELINE_DEPTH);
+
+        pipeline.add_stage("read", 1, [&](Pipeline::Stage& stage) {
+            for (size_t remaining = static_cast<size_t>(filesize); remaining > 0;) {
+                std::vector<char> chunk(std::min(IO_BUFFER_SIZE, remaining));
+                if (source->read_full(chunk.data(), chunk.size()) != chunk.size()) {
+                    std::cerr << "Error reading file: " << filename << std::endl;
+                    return stage.fail();
+                }
+                remaining -= chunk.size();
+                stage.processed(chunk.size());
+                if (!stage.push(chunks, std::move(chunk)))
+                    return;
+            }
+        }, [&] { chunks.close(); });
+
+        pipeline.add_stage("packetize", 1, [&](Pipeline::Stage& stage) {
+            EncodeBatch batch;
+            batch.blocks.reserve(group_blocks);
+            auto send = [&] {
+                stage.processed(batch.bytes);
+                const size_t next = batch.group + 1;
+                if (!stage.push(packets, std::move(batch)))
+                    return false;
+                batch = EncodeBatch();
+                batch.group = next;
+                batch.blocks.reserve(group_blocks);
+                return true;
+            };
+            // Chunks are whole blocks except at the end of the file
+            std::vector<char> chunk;
+            while (stage.pop(chunks, chunk)) {
+                for (size_t at = 0; at < chunk.size();) {
+                    const size_t count = std::min(group_blocks - batch.blocks.size(), (chunk.size() - at + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+                    const size_t bytes = std::min(count * sizeof(uint64_t), chunk.size() - at);
+                    const size_t old = batch.blocks.size();
+                    batch.blocks.resize(old + count, 0);
+                    std::memcpy(batch.blocks.data() + old, chunk.data() + at, bytes);
+                    if (bytes % sizeof(uint64_t))
+                        batch.tail_bp = (bytes % sizeof(uint64_t)) * 4;
+                    batch.bytes += bytes;
+                    at += bytes;
+                    if (batch.blocks.size() == group_blocks && !send())
+                        return;
+                }
+            }
+            if (!batch.blocks.empty())
+                send();
+        }, [&] { packets.close(); });
+
+        const size_t outer_workers = std::clamp<size_t>(pool.size() / 2, 1, 8);
+        pipeline.add_stage("outer", outer_workers, [&](Pipeline::Stage& stage) {
+            EncodeBatch batch;
+            while (stage.pop(packets, batch)) {
+                batch.duplexes = outer_group_duplexes(batch.group, batch.blocks, batch.tail_bp, outer_data_rows, outer_parity_rows);
+                batch.blocks = {};
+                stage.processed(batch.bytes);
+                if (!stage.push(coded, std::move(batch)))
+                    return;
+            }
+        }, [&] { coded.close(); });
+
+        // Only the render stage's input depends on whether the inner code is on
+        auto render = [&](Pipeline::Stage& stage, auto& input) {
+            EncodeBatch batch;
+            while (stage.pop(input, batch)) {
+                // Lines are full length except for a short last data oligo, so each line's offset is known up front
+                std::vector<size_t> offsets(batch.duplexes.size() + 1, 0);
+                for (size_t i = 0; i < batch.duplexes.size(); ++i)
+                    offsets[i + 1] = offsets[i] + line_bp - (MAX_BP - batch.duplexes[i].second.bp());
+                batch.text.resize(offsets.back());
+                pool.parallel_for(batch.duplexes.size(), [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        char* line = batch.duplexes[i].second.write_seq(batch.duplexes[i].first.write_seq(batch.text.data() + offsets[i]));
+                        if (i < batch.inner.size())
+                            line = batch.inner[i].write_seq(line);
+                        *line = '\n';
+                    }
+                });
+                batch.duplexes = {};
+                batch.inner = {};
+                stage.processed(batch.bytes);
+                if (!stage.push(rendered, std::move(batch)))
+                    return;
+            }
+        };
+        if (inner_parity_bytes > 0) {
+            pipeline.add_stage("inner", 1, [&](Pipeline::Stage& stage) {
+                EncodeBatch batch;
+                while (stage.pop(coded, batch)) {
+                    batch.inner = inner_parity_batch(batch.duplexes.size(), [&](size_t i) { return batch.duplexes[i]; }, inner_parity_bytes, pool);
+                    stage.processed(batch.bytes);
+                    if (!stage.push(inner_coded, std::move(batch)))
+                        return;
+                }
+            }, [&] { inner_coded.close(); });
+            pipeline.add_stage("render", 1, [&](Pipeline::Stage& stage) { render(stage, inner_coded); }, [&] { rendered.close(); });
+        } else {
+            pipeline.add_stage("render", 1, [&](Pipeline::Stage& stage) { render(stage, coded); }, [&] { rendered.close(); });
+        }
+
+        // Several outer-code threads can finish groups out of order, so the writer puts them back in order
+        pipeline.add_stage("write", 1, [&](Pipeline::Stage& stage) {
+            std::map<size_t, EncodeBatch> early;
+            size_t next = 0;
+            EncodeBatch batch;
+            while (stage.pop(rendered, batch)) {
+                early.emplace(batch.group, std::move(batch));
+                for (auto it = early.begin(); it != early.end() && it->first == next; it = early.erase(it), ++next) {
+                    if (!outfile->write(it->second.text.data(), it->second.text.size())) {
+                        std::cerr << "Error writing file: " << outname << std::endl;
+                        return stage.fail();
+                    }
+                    stage.processed(it->second.bytes);
+                }
+            }
+        });
+
+        const bool ok = pipeline.run();
+        if (stats)
+            *stats = pipeline.stats();
+        if (!ok)
+            return false;
+        if (!outfile->close()) {
+            std::cerr << "Error writing file: " << outname << std::endl;
+            return false;
+        }
+        std::cout << "Input file encoded and written to: " << outname << std::endl;
+        return true;
+    }
+
+    /**
+     * @brief Function to decode reads (raw lines or FASTQ, optionally gzipped) back into the original bytes.
      */
     void decode() {
 
         oligo_vec.clear();
         oligo_duplex.clear();
         decode_duplex.clear();
-        size_t line_number = 0;
+        inner_stats = InnerStats();
+        std::string noisy;              // reads with indels, back to back
+        std::vector<size_t> noisy_ends; // end offset of each read in noisy
+
+        // Records (raw lines, FASTA or FASTQ, from every lane) are views into the reader's buffers
+        std::vector<std::string> inputs{filename};
+        inputs.insert(inputs.end(), lanes.begin(), lanes.end());
+        RecordReader reader(inputs);
+        if (!reader.is_open())
+            return;
 
-        for (std::string line; std::getline(file, line); line_number++) {
-            if ((get_filetype() == ".fastq") && (line_number % 4 != 1))
-                continue;
-            if  (line.size() == 64) {
-                Oligo index_oligo(line.substr(0, MAX_BP));
-                Oligo data_oligo(line.substr(32, MAX_BP));
+        // Droplets go to the fountain decoder once they agree on the segment count, and reading
+        // stops once it has every segment; each read takes more than one byte, so the inputs'
+        // size bounds the count
+        size_t input_bytes = static_cast<size_t>(filesize);
+        for (const auto& lane : lanes) {
+            std::error_code error;
+            const auto size = std::filesystem::file_size(lane, error);
+            input_bytes += error ? 0 : static_cast<size_t>(size);
+        }
+        DropletCollector droplets(input_bytes);
+        bool complete = false;
+        const size_t length = strand_bp();
+        ThreadPool& pool = ThreadPool::shared();
+        std::vector<Record> batch;
+        std::vector<std::string_view> strands;
+        std::vector<std::pair<Oligo, Oligo>> duplexes;
+        std::vector<std::pair<Oligo, Oligo>> tails;  // reads short enough to hold the partial last block
+        while (!complete && reader.next_batch(batch)) {
+            strands.clear();
+            for (const auto& record : batch) {
+                std::string_view seq = record.seq;
+                if (seq.size() == length) {
+                    strands.push_back(seq);
+                    continue;
+                }
+                if (auto tail = split_tail(seq, inner_parity_bytes))
+                    tails.push_back(*tail);
+                if (seq.size() + MAX_INDEL >= length && seq.size() <= length + MAX_INDEL) {
+                    noisy.append(seq);
+                    noisy_ends.push_back(noisy.size());
+                }
+            }
+
+            split_strands(strands, inner_parity_bytes, pool, duplexes, inner_stats);
+            for (const auto& [index_oligo, data_oligo] : duplexes) {
+                if (is_droplet(index_oligo.data())) {
+                    if ((complete = droplets.add(index_oligo.data(), data_oligo.data())))
+                        break;
+                    continue;
+                }
                 decode_duplex.emplace_back(index_oligo, data_oligo);
             }
         }
 
+        add_tail(tails);
+        if (complete)
+            std::cout << "Stopped reading after " << droplets.finish()->received() << " droplets" << std::endl;
+        else if (!noisy_ends.empty()) {
+            std::vector<std::string_view> reads;
+            reads.reserve(noisy_ends.size());
+            for (size_t i = 0, start = 0; i < noisy_ends.size(); start = noisy_ends[i++])
+                reads.push_back(std::string_view(noisy).substr(start, noisy_ends[i] - start));
+            reconstruct_noisy(reads);
+        }
+
+        if (inner_parity_bytes > 0)
+            std::cout << "Inner code corrected " << inner_stats.corrected << " strands and rejected " << inner_stats.rejected << std::endl;
+
+        recover_fountain(droplets);
+        recover_missing();
+
         std::sort(decode_duplex.begin(), decode_duplex.end(), [](const auto& a, const auto& b) {
                 return a.first.data() < b.first.data();
                 });
 
-        std::ofstream output_file(get_filename() + ".decode", std::ios::binary);
-        if (!output_file.is_open()) {
+        std::unique_ptr<ByteSink> output_file = open_async_sink(get_filename() + ".decode", decode_duplex.size() * sizeof(uint64_t), direct_io);
+        if (!output_file->is_open()) {
             std::cerr << "Error opening output file: " << get_filename() + ".decode" << std::endl;
             oligo_vec.clear();
             decode_duplex.clear();
             return;
         }
         for (auto &o : decode_duplex)
-            o.second.write_bin(output_file);
+            o.second.write_bin(*output_file);
 
-        output_file.close();
+        if (!output_file->close()) {
+            std::cerr << "Error writing output file: " << get_filename() + ".decode" << std::endl;
+            return;
+        }
         std::cout << "Input file decoded and written to: " << get_filename() + ".decode" << std::endl;
     }
 
+    /**
+     * @brief Add the partial last block of the data, if one was read.
+     *
+     * Its index is the last one the parity oligos describe or, without them, the one
+     * after the last full block read.
+     * @param tails Reads split_tail() accepted.
+     */
+    void add_tail(std::span<const std::pair<Oligo, Oligo>> tails) {
+        if (tails.empty())
+            return;
+        std::unordered_set<uint64_t> seen;
+        uint64_t last = 0;
+        for (const auto& [index_oligo, data_oligo] : decode_duplex) {
+            if (index_oligo.data() & (PARITY_FLAG | DROPLET_FLAG))
+                continue;
+            seen.insert(index_oligo.data());
+            last = std::max<uint64_t>(last, index_oligo.data() + 1);
+        }
+        if (const size_t blocks = outer_data_blocks(decode_duplex, outer_data_rows, outer_parity_rows))
+            last = blocks - 1;
+        if (seen.count(last))
+            return;
+        if (auto tail = find_tail(tails, last))
+            decode_duplex.push_back(*tail);
+    }
+
+    /**
+     * @brief Recover duplexes from reads carrying insertions or deletions.
+     *
+     * The reads are clustered by similarity and each cluster is reconstructed into a
+     * single strand_bp() strand, which the inner code then checks like any other.
+     * Indices already recovered from exact-length reads are kept as is.
+     * @param reads Reads whose length is not strand_bp().
+     */
+    void reconstruct_noisy(std::span<const std::string_view> reads) {
+        auto clusters = cluster_reads(reads, CLUSTER_MAXDIST, thread_workspace());
+
+        ThreadPool& pool = ThreadPool::shared();
+        std::vector<std::string> strands = reconstruct_clusters(reads, clusters, strand_bp(), pool);
+        std::vector<std::string_view> views(strands.begin(), strands.end());
+        std::vector<std::pair<Oligo, Oligo>> duplexes;
+        split_strands(views, inner_parity_bytes, pool, duplexes, inner_stats);
+
+        std::unordered_set<uint64_t> seen;
+        for (const auto& [index_oligo, data_oligo] : decode_duplex)
+            seen.insert(index_oligo.data());
+
+        size_t recovered = 0;
+        for (const auto& [index_oligo, data_oligo] : duplexes) {
+            if (!seen.insert(index_oligo.data()).second)
+                continue;
+            decode_duplex.emplace_back(index_oligo, data_oligo);
+            recovered++;
+        }
+
+        std::cout << "Reconstructed " << recovered << " oligos from " << reads.size() << " reads with indels" << std::endl;
+    }
+
+    /**
+     * @brief Finish fountain decoding and replace the droplets with the recovered segments.
+     *
+     * Droplets rebuilt from reads with indels are peeled first; if segments are still
+     * missing, Gaussian elimination runs on the droplets that hold them.
+     * @param droplets The droplets read so far.
+     */
+    void recover_fountain(DropletCollector& droplets) {
+        for (const auto& [index_oligo, data_oligo] : decode_duplex)
+            if (is_droplet(index_oligo.data()))
+                droplets.add(index_oligo.data(), data_oligo.data());
+        std::erase_if(decode_duplex, [](const auto& duplex) { return is_droplet(duplex.first.data()); });
+        FountainDecoder* fountain = droplets.finish();
+        if (!fountain)
+            return;
+
+        const size_t peeled = fountain->recovered();
+        fountain->solve();
+        for (size_t i = 0; i < fountain->segments(); ++i)
+            if (fountain->is_known(i))
+                decode_duplex.emplace_back(Oligo(MAX_BP, i), Oligo(MAX_BP, fountain->segment(i)));
+
+        std::cout << "Recovered " << fountain->recovered() << " of " << fountain->segments() << " segments from "
+                  << fountain->received() << " droplets (" << fountain->recovered() - peeled << " by elimination)" << std::endl;
+    }
+
+    /**
+     * @brief Recover lost data oligos from the outer code, correct damaged ones, and drop the parity oligos.
+     */
+    void recover_missing() {
+        std::optional<OuterStats> stats = recover_outer(decode_duplex, outer_data_rows, outer_parity_rows);
+        if (!stats)
+            return;
+        std::cout << "Recovered " << stats->recovered << " and corrected " << stats->corrected << " oligos with the outer code";
+        if (stats->lost)
+            std::cout << " (" << stats->lost << " unrecoverable)";
+        std::cout << std::endl;
+    }
+
     //Uncomment the following lines when Criteria class is finished
     //Criteria get_criteria() const;
     //void set_criteria(const Criteria& new_criteria);
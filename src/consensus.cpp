@@ -0,0 +1,256 @@
+#include <array>
+#include <cstdint>
+#include <future>
+#include "consensus.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+constexpr std::size_t KMER = 10;            ///< k-mer length for minimizers.
+constexpr std::size_t WINDOW = 2;           ///< k-mers per minimizer window.
+constexpr std::size_t MAX_OWNERS = 16;      ///< Clusters remembered per minimizer.
+constexpr std::size_t MAX_CANDIDATES = 8;   ///< Clusters verified per read.
+constexpr int MAX_ROUNDS = 4;               ///< Consensus refinement passes.
+constexpr std::size_t DEL = 4;              ///< Vote slot for a deletion.
+
+int base_index(char c) {
+    std::optional<int> nt = char2nt(c);
+    return nt.value_or(-1);
+}
+
+// Mix a 2-bit packed k-mer so minimizers are not biased towards A-rich k-mers.
+std::uint32_t kmer_hash(std::uint32_t kmer) {
+    kmer ^= kmer >> 15;
+    kmer *= 0x2c1b3c6dU;
+    kmer ^= kmer >> 12;
+    return kmer;
+}
+
+// Distinct window minimizers of a read, skipping homopolymer k-mers.
+void minimizers(std::string_view read, std::vector<std::uint32_t>& hashes, std::vector<std::uint32_t>& out) {
+    constexpr std::uint32_t mask = (1U << (2 * KMER)) - 1;
+    constexpr std::uint32_t repeat = mask / 3;  // 0b0101... : one copy of each 2-bit symbol
+
+    hashes.clear();
+    std::uint32_t kmer = 0;
+    std::size_t valid = 0;
+    for (char c : read) {
+        int nt = base_index(c);
+        if (nt < 0) {
+            valid = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | nt) & mask;
+        if (++valid < KMER)
+            continue;
+        bool homopolymer = kmer == (kmer & 3) * repeat;
+        hashes.push_back(homopolymer ? UINT32_MAX : kmer_hash(kmer));
+    }
+
+    out.clear();
+    std::size_t windows = hashes.size() >= WINDOW ? hashes.size() - WINDOW + 1 : !hashes.empty();
+    for (std::size_t i = 0; i < windows; ++i) {
+        auto first = hashes.begin() + i;
+        std::uint32_t best = *std::min_element(first, first + std::min(WINDOW, hashes.size() - i));
+        if (best != UINT32_MAX)
+            out.push_back(best);
+    }
+    std::ranges::sort(out);
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+/**
+ * @brief Votes from aligning every read against the current consensus.
+ */
+struct Votes {
+    std::vector<std::array<std::uint32_t, 5>> base;     ///< A, C, G, T, deletion per consensus position.
+    std::vector<std::array<std::uint32_t, 4>> insert;   ///< Inserted A, C, G, T before each position.
+
+    void tally(std::string_view consensus, std::span<const std::string_view> reads, std::string& diff, AlignmentWorkspace& ws) {
+        base.assign(consensus.size(), {});
+        insert.assign(consensus.size() + 1, {});
+
+        for (std::string_view read : reads) {
+            Diff(consensus, read, diff, ws);
+            std::size_t i = 0, j = 0;
+            for (char op : diff) {
+                switch (op) {
+                    case '-':
+                    case 'R':
+                        if (int nt = base_index(read[j]); nt >= 0)
+                            ++base[i][nt];
+                        ++i;
+                        ++j;
+                        break;
+                    case 'D':
+                        ++base[i][DEL];
+                        ++i;
+                        break;
+                    case 'I':
+                        if (int nt = base_index(read[j]); nt >= 0)
+                            ++insert[i][nt];
+                        ++j;
+                        break;
+                }
+            }
+        }
+    }
+};
+
+// Index of the largest vote, keeping `prefer` on ties.
+template <std::size_t N>
+std::size_t argmax(const std::array<std::uint32_t, N>& v, std::size_t prefer) {
+    std::size_t best = prefer < N ? prefer : 0;
+    for (std::size_t i = 0; i < N; ++i)
+        if (v[i] > v[best])
+            best = i;
+    return best;
+}
+
+} // namespace
+
+std::vector<std::vector<std::size_t>> cluster_reads(std::span<const std::string_view> reads, int maxdist, AlignmentWorkspace& ws) {
+    std::vector<std::vector<std::size_t>> clusters;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> owners;
+    std::vector<std::uint32_t> hashes, mins;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> votes;  // (cluster, shared minimizers)
+
+    for (std::size_t r = 0; r < reads.size(); ++r) {
+        minimizers(reads[r], hashes, mins);
+
+        votes.clear();
+        for (std::uint32_t m : mins) {
+            auto it = owners.find(m);
+            if (it == owners.end())
+                continue;
+            for (std::uint32_t cid : it->second) {
+                auto v = std::ranges::find(votes, cid, &std::pair<std::uint32_t, std::uint32_t>::first);
+                if (v == votes.end())
+                    votes.emplace_back(cid, 1);
+                else
+                    ++v->second;
+            }
+        }
+        std::ranges::sort(votes, std::ranges::greater{}, &std::pair<std::uint32_t, std::uint32_t>::second);
+
+        // Join the closest of the best-voted clusters, if it is close enough
+        std::uint32_t assigned = UINT32_MAX;
+        int best = maxdist + 1;
+        for (std::size_t c = 0; c < std::min(votes.size(), MAX_CANDIDATES); ++c) {
+            std::uint32_t cid = votes[c].first;
+            if (int dist = levenshtein_distance(reads[r], reads[clusters[cid].front()], ws); dist < best) {
+                assigned = cid;
+                best = dist;
+            }
+        }
+
+        if (assigned == UINT32_MAX) {
+            assigned = static_cast<std::uint32_t>(clusters.size());
+            clusters.emplace_back();
+        }
+        clusters[assigned].push_back(r);
+
+        for (std::uint32_t m : mins) {
+            auto& list = owners[m];
+            if (list.size() < MAX_OWNERS && std::ranges::find(list, assigned) == list.end())
+                list.push_back(assigned);
+        }
+    }
+
+    return clusters;
+}
+
+std::string reconstruct(std::span<const std::string_view> reads, std::size_t length, AlignmentWorkspace& ws) {
+    if (reads.empty())
+        return std::string(length, nucleotideStr[0]);
+
+    // Seed with the read whose length is closest to the target
+    auto seed = std::ranges::min_element(reads, {}, [length](std::string_view r) {
+            return r.size() > length ? r.size() - length : length - r.size();
+            });
+    std::string consensus(*seed);
+    std::string next, diff;
+    Votes votes;
+
+    for (int round = 0; round < MAX_ROUNDS; ++round) {
+        votes.tally(consensus, reads, diff, ws);
+
+        next.clear();
+        for (std::size_t i = 0; i <= consensus.size(); ++i) {
+            std::size_t ins = argmax(votes.insert[i], 0);
+            if (2 * votes.insert[i][ins] > reads.size())
+                next += nucleotideStr[ins];
+
+            if (i == consensus.size())
+                break;
+
+            std::size_t best = argmax(votes.base[i], base_index(consensus[i]) >= 0 ? base_index(consensus[i]) : 0);
+            if (best != DEL)
+                next += nucleotideStr[best];
+        }
+
+        if (next == consensus)
+            break;
+        std::swap(consensus, next);
+    }
+
+    // Force the expected length, dropping the least supported positions or adding the best supported insertions
+    while (consensus.size() != length) {
+        votes.tally(consensus, reads, diff, ws);
+        if (consensus.size() > length) {
+            std::size_t weakest = 0;
+            std::uint32_t weakest_support = UINT32_MAX;
+            for (std::size_t i = 0; i < consensus.size(); ++i) {
+                int nt = base_index(consensus[i]);
+                std::uint32_t support = nt >= 0 ? votes.base[i][nt] : 0;
+                if (support < weakest_support) {
+                    weakest = i;
+                    weakest_support = support;
+                }
+            }
+            consensus.erase(weakest, 1);
+        } else {
+            std::size_t strongest = consensus.size();
+            std::size_t strongest_base = 0;
+            std::uint32_t strongest_support = 0;
+            for (std::size_t i = 0; i < votes.insert.size(); ++i) {
+                std::size_t b = argmax(votes.insert[i], 0);
+                if (votes.insert[i][b] > strongest_support) {
+                    strongest = i;
+                    strongest_base = b;
+                    strongest_support = votes.insert[i][b];
+                }
+            }
+            consensus.insert(consensus.begin() + strongest, nucleotideStr[strongest_base]);
+        }
+    }
+
+    return consensus;
+}
+
+std::vector<std::string> reconstruct_clusters(std::span<const std::string_view> reads,
+        const std::vector<std::vector<std::size_t>>& clusters, std::size_t length, ThreadPool& pool) {
+    std::vector<std::string> out(clusters.size());
+    std::size_t tasks = std::min(clusters.size(), pool.size() * 4);
+    std::vector<std::future<void>> pending;
+    pending.reserve(tasks);
+
+    for (std::size_t t = 0; t < tasks; ++t) {
+        std::size_t first = clusters.size() * t / tasks;
+        std::size_t last = clusters.size() * (t + 1) / tasks;
+        pending.push_back(pool.submit([&, first, last] {
+            AlignmentWorkspace& ws = thread_workspace();
+            std::vector<std::string_view> members;
+            for (std::size_t c = first; c < last; ++c) {
+                members.clear();
+                for (std::size_t idx : clusters[c])
+                    members.push_back(reads[idx]);
+                out[c] = reconstruct(members, length, ws);
+            }
+        }));
+    }
+    for (auto& p : pending)
+        p.get();
+
+    return out;
+}
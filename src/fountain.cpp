@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "fountain.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+/**
+ * @brief splitmix64: small, fast, and identical on every platform, unlike the std distributions.
+ */
+class SplitMix64 {
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t below(std::size_t bound) {
+        return static_cast<uint32_t>((static_cast<unsigned __int128>(next()) * bound) >> 64);
+    }
+
+private:
+    uint64_t state;
+};
+
+} // namespace
+
+DropletSampler::DropletSampler(std::size_t segments, double c, double delta) : count(std::max<std::size_t>(1, segments)) {
+    const double k = static_cast<double>(count);
+    const double r = c * std::log(k / delta) * std::sqrt(k);
+    const std::size_t spike = std::clamp<std::size_t>(static_cast<std::size_t>(std::llround(k / std::max(r, 1.0))), 1, count);
+
+    // Ideal soliton rho plus the robust part tau, which adds low degrees and a spike at K/R.
+    // Degrees past twice the spike are folded into the last one: they carry about R/(2K)
+    // of the mass, and a short table keeps the lookup in cache.
+    const std::size_t max_degree = std::min(count, std::max<std::size_t>(2 * spike, 64));
+    cdf.resize(max_degree);
+    double total = 0;
+    for (std::size_t d = 1; d <= count; ++d) {
+        double weight = (d == 1) ? 1 / k : 1 / (static_cast<double>(d) * (d - 1));
+        if (d < spike)
+            weight += r / (d * k);
+        else if (d == spike)
+            weight += std::max(0.0, r * std::log(r / delta) / k);
+        total += weight;
+        cdf[std::min(d, max_degree) - 1] = total;
+    }
+    for (auto& p : cdf)
+        p /= total;
+    cdf.back() = 1;
+}
+
+void DropletSampler::choose(uint32_t seed, std::vector<uint32_t>& out) const {
+    SplitMix64 rng(seed);
+    const double u = static_cast<double>(rng.next() >> 11) * 0x1.0p-53;
+    const std::size_t degree = std::min<std::size_t>(count, std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin() + 1);
+
+    // Draw until there are degree distinct segments
+    out.clear();
+    while (out.size() < degree) {
+        while (out.size() < degree)
+            out.push_back(rng.below(count));
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+}
+
+FountainEncoder::FountainEncoder(std::span<const uint64_t> segments) : data(segments), sampler(segments.size()) {}
+
+uint64_t FountainEncoder::droplet(uint32_t seed) const {
+    std::vector<uint32_t> chosen;
+    sampler.choose(seed, chosen);
+    uint64_t payload = 0;
+    for (uint32_t s : chosen)
+        payload ^= data[s];
+    return payload;
+}
+
+void FountainEncoder::droplets(uint32_t first, std::span<uint64_t> out, ThreadPool& pool) const {
+    pool.parallel_for(out.size(), [&](std::size_t begin, std::size_t end) {
+        std::vector<uint32_t> chosen;
+        for (std::size_t i = begin; i < end; ++i) {
+            sampler.choose(first + static_cast<uint32_t>(i), chosen);
+            uint64_t payload = 0;
+            for (uint32_t s : chosen)
+                payload ^= data[s];
+            out[i] = payload;
+        }
+    });
+}
+
+FountainDecoder::FountainDecoder(std::size_t segments)
+    : sampler(segments), values(segments, 0), known(segments, false), holders(segments) {}
+
+bool FountainDecoder::add(uint32_t seed, uint64_t payload) {
+    if (done())
+        return true;
+
+    // Known segments come straight out of the payload; the rest are what the droplet still holds
+    sampler.choose(seed, chosen);
+    const uint32_t droplet = static_cast<uint32_t>(seeds.size());
+    uint32_t left = 0, xor_of = 0;
+    for (uint32_t s : chosen) {
+        if (known[s]) {
+            payload ^= values[s];
+        } else {
+            left++;
+            xor_of ^= s;
+        }
+    }
+    seeds.push_back(seed);
+    payloads.push_back(payload);
+    unknowns.push_back(left);
+    index_xor.push_back(xor_of);
+
+    if (left == 1) {
+        resolve(xor_of, payload);
+    } else if (left > 1) {
+        for (uint32_t s : chosen)
+            if (!known[s])
+                holders[s].push_back(droplet);
+    }
+    return done();
+}
+
+void FountainDecoder::resolve(uint32_t segment, uint64_t value) {
+    ready.emplace_back(segment, value);
+    while (!ready.empty()) {
+        auto [s, v] = ready.back();
+        ready.pop_back();
+        if (known[s])
+            continue;
+        known[s] = true;
+        values[s] = v;
+        found++;
+
+        // Every droplet holding s loses it; those left with one unknown reveal it
+        for (uint32_t d : holders[s]) {
+            payloads[d] ^= v;
+            index_xor[d] ^= s;
+            if (--unknowns[d] == 1)
+                ready.emplace_back(index_xor[d], payloads[d]);
+        }
+        std::vector<uint32_t>().swap(holders[s]);
+    }
+}
+
+bool FountainDecoder::solve(std::size_t max_unknowns) {
+    if (done())
+        return true;
+
+    // Columns are the unknown segments, rows the droplets that still hold some
+    std::vector<uint32_t> columns;
+    std::vector<int64_t> column_of(values.size(), -1);
+    for (std::size_t s = 0; s < values.size(); ++s) {
+        if (!known[s]) {
+            column_of[s] = static_cast<int64_t>(columns.size());
+            columns.push_back(static_cast<uint32_t>(s));
+        }
+    }
+    if (columns.size() > max_unknowns)
+        return false;
+
+    const std::size_t words = (columns.size() + 63) / 64;
+    std::vector<uint64_t> matrix;
+    std::vector<uint64_t> rhs;
+    for (std::size_t d = 0; d < seeds.size(); ++d) {
+        if (unknowns[d] < 2)
+            continue;
+        sampler.choose(seeds[d], chosen);
+        matrix.resize(matrix.size() + words, 0);
+        uint64_t* row = matrix.data() + matrix.size() - words;
+        for (uint32_t s : chosen)
+            if (!known[s])
+                row[column_of[s] / 64] |= 1ULL << (column_of[s] % 64);
+        rhs.push_back(payloads[d]);
+    }
+
+    // Gauss-Jordan elimination over GF(2): rows are bit sets, payloads ride along
+    const std::size_t rows = rhs.size();
+    std::vector<std::size_t> pivot_row(columns.size(), rows);
+    std::size_t rank = 0;
+    for (std::size_t col = 0; col < columns.size() && rank < rows; ++col) {
+        const std::size_t w = col / 64;
+        const uint64_t bit = 1ULL << (col % 64);
+        std::size_t pivot = rank;
+        while (pivot < rows && !(matrix[pivot * words + w] & bit))
+            pivot++;
+        if (pivot == rows)
+            continue;
+        if (pivot != rank) {
+            std::swap_ranges(matrix.begin() + pivot * words, matrix.begin() + (pivot + 1) * words, matrix.begin() + rank * words);
+            std::swap(rhs[pivot], rhs[rank]);
+        }
+        const uint64_t* p = matrix.data() + rank * words;
+        for (std::size_t r = 0; r < rows; ++r) {
+            uint64_t* row = matrix.data() + r * words;
+            if (r != rank && (row[w] & bit)) {
+                for (std::size_t i = w; i < words; ++i)
+                    row[i] ^= p[i];
+                rhs[r] ^= rhs[rank];
+            }
+        }
+        pivot_row[col] = rank++;
+    }
+
+    // A pivot row with no other column set determines its segment
+    for (std::size_t col = 0; col < columns.size(); ++col) {
+        const std::size_t r = pivot_row[col];
+        if (r == rows)
+            continue;
+        std::size_t bits = 0;
+        for (std::size_t i = 0; i < words; ++i)
+            bits += std::popcount(matrix[r * words + i]);
+        if (bits == 1)
+            resolve(columns[col], rhs[r]);
+    }
+    return done();
+}
@@ -1,4 +1,14 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include "io.hpp"
+#include "thread_pool.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 std::ifstream open_file(const char* filename, std::streampos& file_size) {
     std::ifstream file(filename, std::ios::binary);
@@ -13,65 +23,968 @@ void process_regular_file(const std::vector<char>& buffer) {
     std::cout << "Regular file content:\n" << buffer.data() << std::endl;
 }
 
-#ifdef ZLIB_FOUND
-void process_gzipped_file(const std::vector<char>& buffer) {
-    z_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    stream.avail_in = 0;
-    stream.next_in = Z_NULL;
+void process_file(const char* filename) {
+    std::unique_ptr<ByteSource> source = open_source(filename);
+
+    if (!source || !source->is_open()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    // A plain file is labelled and ends with a newline; inflated content is written as is
+    const bool compressed = detect_compression(filename) != nullptr;
+    if (!compressed)
+        std::cout << "Regular file content:\n";
+    std::vector<char> buffer(IO_BUFFER_SIZE);
+    while (std::size_t got = source->read(buffer.data(), buffer.size()))
+        std::cout.write(buffer.data(), got);
+    if (!compressed)
+        std::cout << std::endl;
+}
 
+bool is_fastq(const std::string& filename) {
+    std::filesystem::path path(filename);
+    const auto ext = path.extension();
+    if (ext == ".gz" || ext == ".bgz" || ext == ".zst" || ext == ".xz")
+        path = path.stem();
+    return path.extension() == ".fastq" || path.extension() == ".fq";
+}
+
+std::size_t ByteSource::read_full(char* dst, std::size_t n) {
+    std::size_t total = 0;
+    while (total < n) {
+        std::size_t got = read(dst + total, n - total);
+        if (got == 0)
+            break;
+        total += got;
+    }
+    return total;
+}
+
+FileSource::FileSource(const std::string& filename) : file(filename, std::ios::binary) {}
+
+std::size_t FileSource::read(char* dst, std::size_t n) {
+    file.read(dst, static_cast<std::streamsize>(n));
+    return static_cast<std::size_t>(file.gcount());
+}
+
+#ifdef ZLIB_FOUND
+GzipSource::GzipSource(const std::string& filename, std::size_t buffer_size)
+    : file(filename, std::ios::binary), in(buffer_size) {
+    if (!file)
+        return;
     if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
         std::cerr << "Error initializing zlib for decompression." << std::endl;
         return;
     }
+    opened = ready = true;
+}
 
-    std::vector<char> decompressed_buffer;
-    decompressed_buffer.resize(1024);  // Initial size
+GzipSource::~GzipSource() {
+    if (ready)
+        inflateEnd(&stream);
+}
+
+std::size_t GzipSource::read(char* dst, std::size_t n) {
+    if (!ready)
+        return 0;
 
-    do {
-        stream.avail_out = decompressed_buffer.size();
-        stream.next_out = reinterpret_cast<Bytef*>(decompressed_buffer.data());
+    stream.next_out = reinterpret_cast<Bytef*>(dst);
+    stream.avail_out = static_cast<uInt>(n);
+
+    while (stream.avail_out > 0) {
+        if (stream.avail_in == 0) {
+            file.read(in.data(), static_cast<std::streamsize>(in.size()));
+            stream.next_in = reinterpret_cast<Bytef*>(in.data());
+            stream.avail_in = static_cast<uInt>(file.gcount());
+            if (stream.avail_in == 0) {
+                if (in_member)
+                    std::cerr << "Error in zlib decompression: unexpected end of input" << std::endl;
+                ready = in_member = false;
+                inflateEnd(&stream);
+                break;
+            }
+        }
 
+        in_member = true;
         int ret = inflate(&stream, Z_NO_FLUSH);
-        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+        if (ret == Z_STREAM_END) {
+            // Another gzip member may follow
+            in_member = false;
+            inflateReset(&stream);
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
             std::cerr << "Error in zlib decompression: " << ret << std::endl;
+            ready = false;
+            inflateEnd(&stream);
             break;
         }
+    }
 
-        // Output the decompressed data
-        std::cout.write(decompressed_buffer.data(), decompressed_buffer.size() - stream.avail_out);
+    return n - stream.avail_out;
+}
+#endif
 
-        // Resize the buffer if more space is needed
-        if (stream.avail_out == 0)
-            decompressed_buffer.resize(decompressed_buffer.size() * 2);
+namespace {
 
-    } while (stream.avail_out == 0);
+/**
+ * @brief Outcome of reading one gzip member header.
+ */
+enum class BlockStatus { Ok, End, Malformed };
 
-    inflateEnd(&stream);
+std::uint32_t load_le(const char* p, int bytes) {
+    std::uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i)
+        v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
 }
-#else
-void process_gzipped_file(const std::vector<char>& buffer) {
-    std::cerr << "Error: zlib library not linked. Cannot process gzipped file." << std::endl;
+
+/**
+ * Reads one BGZF block (a whole gzip member) into raw. The member must set FEXTRA and
+ * carry a "BC" subfield holding the block size minus one; header_size receives the
+ * offset of the deflate data.
+ */
+BlockStatus read_bgzf_block(std::istream& in, std::vector<char>& raw, std::size_t& header_size) {
+    char header[12];
+    in.read(header, sizeof(header));
+    if (in.gcount() == 0)
+        return BlockStatus::End;
+    if (in.gcount() != sizeof(header) || static_cast<unsigned char>(header[0]) != 0x1f
+            || static_cast<unsigned char>(header[1]) != 0x8b || header[2] != 8 || !(header[3] & 4))
+        return BlockStatus::Malformed;
+
+    std::uint32_t xlen = load_le(header + 10, 2);
+    std::vector<char> extra(xlen);
+    if (!in.read(extra.data(), xlen))
+        return BlockStatus::Malformed;
+
+    std::uint32_t block_size = 0;
+    for (std::size_t i = 0; i + 4 <= xlen;) {
+        std::uint32_t slen = load_le(extra.data() + i + 2, 2);
+        if (extra[i] == 'B' && extra[i + 1] == 'C' && slen == 2 && i + 6 <= xlen)
+            block_size = load_le(extra.data() + i + 4, 2) + 1;
+        i += 4 + slen;
+    }
+
+    header_size = sizeof(header) + xlen;
+    if (block_size < header_size + 8)
+        return BlockStatus::Malformed;
+
+    raw.resize(block_size);
+    std::memcpy(raw.data(), header, sizeof(header));
+    std::memcpy(raw.data() + sizeof(header), extra.data(), xlen);
+    if (!in.read(raw.data() + header_size, block_size - header_size))
+        return BlockStatus::Malformed;
+
+    return BlockStatus::Ok;
+}
+
+#ifdef ZLIB_FOUND
+/**
+ * @brief Largest uncompressed size of a BGZF block.
+ */
+const std::uint32_t BGZF_MAX_BLOCK = 1 << 16;
+
+// Raw-inflates one BGZF block and checks it against the CRC32 and ISIZE trailer.
+std::vector<char> inflate_bgzf_block(const std::vector<char>& raw, std::size_t header_size) {
+    // One inflate state per worker thread, reset between blocks
+    thread_local struct Inflater {
+        z_stream stream{};
+        bool ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        ~Inflater() { if (ok) inflateEnd(&stream); }
+    } inflater;
+    if (!inflater.ok)
+        throw std::runtime_error("error initializing zlib for decompression");
+
+    const char* trailer = raw.data() + raw.size() - 8;
+    std::uint32_t crc = load_le(trailer, 4);
+    std::uint32_t isize = load_le(trailer + 4, 4);
+    if (isize > BGZF_MAX_BLOCK)
+        throw std::runtime_error("BGZF block larger than 64 KiB");
+
+    // One spare byte so that empty blocks (such as the EOF marker) still have room to finish
+    std::vector<char> out(isize + 1);
+    z_stream& stream = inflater.stream;
+    inflateReset(&stream);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data() + header_size));
+    stream.avail_in = static_cast<uInt>(raw.size() - header_size - 8);
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = isize + 1;
+
+    if (inflate(&stream, Z_FINISH) != Z_STREAM_END || stream.avail_out != 1)
+        throw std::runtime_error("corrupt BGZF block");
+    out.pop_back();
+    if (crc32(0, reinterpret_cast<const Bytef*>(out.data()), isize) != crc)
+        throw std::runtime_error("BGZF block CRC mismatch");
+
+    return out;
 }
 #endif
 
-void process_file(const char* filename) {
-    std::streampos file_size;
-    std::ifstream file = open_file(filename, file_size);
+} // namespace
 
-    if (!file) {
-        std::cerr << "Error opening file: " << filename << std::endl;
+bool is_bgzf(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<char> raw;
+    std::size_t header_size;
+    return file && read_bgzf_block(file, raw, header_size) == BlockStatus::Ok;
+}
+
+#ifdef ZLIB_FOUND
+BgzfSource::BgzfSource(const std::string& filename, std::size_t threads)
+    : file(filename, std::ios::binary), own_pool(threads ? std::make_unique<ThreadPool>(threads) : nullptr),
+      pool(own_pool ? own_pool.get() : &ThreadPool::shared()), max_pending(4 * pool->size()), opened(file.is_open()) {}
+
+BgzfSource::~BgzfSource() = default;
+
+bool BgzfSource::submit_next_block() {
+    std::vector<char> raw;
+    std::size_t header_size;
+
+    switch (read_bgzf_block(file, raw, header_size)) {
+        case BlockStatus::End:
+            return false;
+        case BlockStatus::Malformed:
+            std::cerr << "Error in BGZF decompression: malformed block header" << std::endl;
+            failed = true;
+            return false;
+        case BlockStatus::Ok:
+            break;
+    }
+
+    pending.push_back(pool->submit([raw = std::move(raw), header_size] {
+        return inflate_bgzf_block(raw, header_size);
+    }));
+    return true;
+}
+
+std::size_t BgzfSource::read(char* dst, std::size_t n) {
+    while (offset == current.size()) {
+        // Keep the workers busy with the blocks that follow
+        while (!failed && pending.size() < max_pending && submit_next_block());
+        if (pending.empty())
+            return 0;
+
+        try {
+            current = pending.front().get();
+        } catch (const std::exception& e) {
+            std::cerr << "Error in BGZF decompression: " << e.what() << std::endl;
+            failed = true;
+            pending.clear();
+            return 0;
+        }
+        pending.pop_front();
+        offset = 0;
+    }
+
+    std::size_t count = std::min(n, current.size() - offset);
+    std::memcpy(dst, current.data() + offset, count);
+    offset += count;
+    return count;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+ZstdSource::ZstdSource(const std::string& filename, std::size_t buffer_size)
+    : file(filename, std::ios::binary), in(buffer_size) {
+    if (!file)
+        return;
+    stream = ZSTD_createDStream();
+    if (!stream || ZSTD_isError(ZSTD_initDStream(stream))) {
+        std::cerr << "Error initializing zstd for decompression." << std::endl;
         return;
     }
+    input = { in.data(), 0, 0 };
+    opened = ready = true;
+}
+
+ZstdSource::~ZstdSource() {
+    if (stream)
+        ZSTD_freeDStream(stream);
+}
 
-    std::vector<char> buffer(file_size);
-    file.read(buffer.data(), file_size);
+std::size_t ZstdSource::read(char* dst, std::size_t n) {
+    if (!ready)
+        return 0;
+
+    ZSTD_outBuffer output = { dst, n, 0 };
+    while (output.pos < output.size) {
+        if (input.pos == input.size) {
+            file.read(in.data(), static_cast<std::streamsize>(in.size()));
+            input = { in.data(), static_cast<std::size_t>(file.gcount()), 0 };
+            if (input.size == 0) {
+                if (in_frame)
+                    std::cerr << "Error in zstd decompression: unexpected end of input" << std::endl;
+                ready = false;
+                break;
+            }
+        }
+
+        // A return of 0 marks the end of a frame; another may follow
+        std::size_t ret = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(ret)) {
+            std::cerr << "Error in zstd decompression: " << ZSTD_getErrorName(ret) << std::endl;
+            ready = false;
+            break;
+        }
+        in_frame = (ret != 0);
+    }
+
+    return output.pos;
+}
+#endif
+
+#ifdef HAVE_LZMA
+XzSource::XzSource(const std::string& filename, std::size_t buffer_size)
+    : file(filename, std::ios::binary), in(buffer_size) {
+    if (!file)
+        return;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        std::cerr << "Error initializing liblzma for decompression." << std::endl;
+        return;
+    }
+    opened = ready = true;
+}
 
-    if (std::filesystem::path(filename).extension() == ".gz")
-        process_gzipped_file(buffer);
+XzSource::~XzSource() {
+    lzma_end(&stream);
+}
+
+std::size_t XzSource::read(char* dst, std::size_t n) {
+    if (!ready)
+        return 0;
+
+    stream.next_out = reinterpret_cast<std::uint8_t*>(dst);
+    stream.avail_out = n;
+    lzma_action action = file ? LZMA_RUN : LZMA_FINISH;
+
+    while (stream.avail_out > 0) {
+        if (stream.avail_in == 0 && action == LZMA_RUN) {
+            file.read(in.data(), static_cast<std::streamsize>(in.size()));
+            stream.next_in = reinterpret_cast<const std::uint8_t*>(in.data());
+            stream.avail_in = static_cast<std::size_t>(file.gcount());
+            // With LZMA_CONCATENATED the decoder only ends once told the input is over
+            if (!file)
+                action = LZMA_FINISH;
+        }
+
+        lzma_ret ret = lzma_code(&stream, action);
+        if (ret == LZMA_STREAM_END) {
+            ready = false;
+            break;
+        }
+        if (ret == LZMA_BUF_ERROR) {
+            std::cerr << "Error in xz decompression: unexpected end of input" << std::endl;
+            ready = false;
+            break;
+        }
+        if (ret != LZMA_OK) {
+            std::cerr << "Error in xz decompression: " << ret << std::endl;
+            ready = false;
+            break;
+        }
+    }
+
+    return n - stream.avail_out;
+}
+#endif
+
+AsyncSource::AsyncSource(std::unique_ptr<ByteSource> inner, std::size_t block_size, std::size_t depth)
+    : inner(std::move(inner)), ring(depth) {
+    for (auto& block : ring)
+        block.data.resize(block_size);
+    if (this->inner->is_open())
+        worker = std::thread([this] { produce(); });
     else
-        process_regular_file(buffer);
+        done = true;
+}
+
+AsyncSource::~AsyncSource() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void AsyncSource::produce() {
+    for (std::size_t tail = 0;; tail = (tail + 1) % ring.size()) {
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this] { return stopping || filled < ring.size(); });
+            if (stopping)
+                return;
+        }
+
+        // The tail block is not visible to the consumer until filled is bumped
+        Block& block = ring[tail];
+        block.size = inner->read_full(block.data.data(), block.data.size());
+
+        {
+            std::lock_guard lock(mutex);
+            if (block.size > 0)
+                filled++;
+            if (block.size < block.data.size())
+                done = true;
+        }
+        cv.notify_all();
+        if (block.size < block.data.size())
+            return;
+    }
+}
+
+std::size_t AsyncSource::read(char* dst, std::size_t n) {
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [this] { return filled > 0 || done; });
+    if (filled == 0)
+        return 0;
+    lock.unlock();
+
+    Block& block = ring[head];
+    std::size_t count = std::min(n, block.size - offset);
+    std::memcpy(dst, block.data.data() + offset, count);
+    offset += count;
+
+    if (offset == block.size) {
+        offset = 0;
+        head = (head + 1) % ring.size();
+        lock.lock();
+        filled--;
+        lock.unlock();
+        cv.notify_all();
+    }
+    return count;
 }
 
+#ifdef HAVE_LIBURING
+UringSource::UringSource(const std::string& filename, std::size_t block_size, std::size_t depth) : ring(depth) {
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || io_uring_queue_init(static_cast<unsigned>(depth), &uring, 0) != 0) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    file_size = static_cast<std::uint64_t>(st.st_size);
+    opened = true;
+
+    for (auto& block : ring) {
+        block.data.resize(block_size);
+        queue(block);
+    }
+    io_uring_submit(&uring);
+}
+
+UringSource::~UringSource() {
+    if (!opened)
+        return;
+    while (in_flight > 0 && wait_one());
+    io_uring_queue_exit(&uring);
+    ::close(fd);
+}
+
+bool UringSource::queue(Block& block) {
+    if (next_position >= file_size)
+        return false;
+    io_uring_sqe* sqe = io_uring_get_sqe(&uring);
+    if (!sqe)
+        return false;
+
+    block.position = next_position;
+    block.size = static_cast<std::size_t>(std::min<std::uint64_t>(block.data.size(), file_size - next_position));
+    block.queued = true;
+    block.ready = false;
+    next_position += block.size;
+
+    io_uring_prep_read(sqe, fd, block.data.data(), static_cast<unsigned>(block.size), block.position);
+    io_uring_sqe_set_data(sqe, &block);
+    in_flight++;
+    return true;
+}
+
+bool UringSource::wait_one() {
+    io_uring_cqe* cqe;
+    if (io_uring_wait_cqe(&uring, &cqe) != 0)
+        return false;
+    Block& block = *static_cast<Block*>(io_uring_cqe_get_data(cqe));
+    int res = cqe->res;
+    io_uring_cqe_seen(&uring, cqe);
+    in_flight--;
+
+    if (res < 0) {
+        std::cerr << "Error reading file: " << std::strerror(-res) << std::endl;
+        failed = true;
+        block.queued = false;
+        return true;
+    }
+    // Finish a short read synchronously; the blocks that follow are already queued
+    std::size_t got = static_cast<std::size_t>(res);
+    while (got < block.size) {
+        ssize_t more = pread(fd, block.data.data() + got, block.size - got, block.position + got);
+        if (more <= 0)
+            break;
+        got += static_cast<std::size_t>(more);
+    }
+    block.size = got;
+    block.queued = false;
+    block.ready = true;
+    return true;
+}
+
+std::size_t UringSource::read(char* dst, std::size_t n) {
+    Block& block = ring[head];
+    while (!failed && block.queued && !block.ready)
+        if (!wait_one())
+            failed = true;
+    if (failed || !block.ready)
+        return 0;
+
+    std::size_t count = std::min(n, block.size - offset);
+    std::memcpy(dst, block.data.data() + offset, count);
+    offset += count;
+
+    if (offset == block.size) {
+        // Requeue the block behind the others
+        offset = 0;
+        block.ready = false;
+        head = (head + 1) % ring.size();
+        if (queue(block))
+            io_uring_submit(&uring);
+    }
+    return count;
+}
+#endif
+
+std::unique_ptr<ByteSource> open_file_source(const std::string& filename) {
+#ifdef HAVE_LIBURING
+    // io_uring may be unavailable at run time (old kernels, sandboxes)
+    auto uring_source = std::make_unique<UringSource>(filename);
+    if (uring_source->is_open())
+        return uring_source;
+#endif
+    return std::make_unique<AsyncSource>(std::make_unique<FileSource>(filename));
+}
+
+namespace {
+
+// Decodes a single-stream format on a thread of its own, ahead of the consumer.
+template <typename Source>
+std::unique_ptr<ByteSource> open_async(const std::string& filename) {
+    return std::make_unique<AsyncSource>(std::make_unique<Source>(filename));
+}
+
+#ifdef ZLIB_FOUND
+std::unique_ptr<ByteSource> open_gzip(const std::string& filename) {
+    if (is_bgzf(filename))
+        return std::make_unique<BgzfSource>(filename);
+    return open_async<GzipSource>(filename);
+}
+#endif
+
+} // namespace
+
+const std::vector<Decompressor>& decompressors() {
+    using namespace std::string_view_literals;
+    static const std::vector<Decompressor> registry = {
+#ifdef ZLIB_FOUND
+        { "gzip", "\x1f\x8b"sv, open_gzip },
+#else
+        { "gzip", "\x1f\x8b"sv, nullptr },
+#endif
+#ifdef HAVE_ZSTD
+        { "zstd", "\x28\xb5\x2f\xfd"sv, open_async<ZstdSource> },
+#else
+        { "zstd", "\x28\xb5\x2f\xfd"sv, nullptr },
+#endif
+        // Recognized so that it is refused rather than read as raw bases; no decoder yet
+        { "lz4", "\x04\x22\x4d\x18"sv, nullptr },
+#ifdef HAVE_LZMA
+        { "xz", "\xfd\x37\x7a\x58\x5a\x00"sv, open_async<XzSource> },
+#else
+        { "xz", "\xfd\x37\x7a\x58\x5a\x00"sv, nullptr },
+#endif
+    };
+    return registry;
+}
+
+const Decompressor* detect_compression(const std::string& filename) {
+    char head[8] = {};
+    std::ifstream file(filename, std::ios::binary);
+    file.read(head, sizeof(head));
+    std::string_view prefix(head, static_cast<std::size_t>(file.gcount()));
+
+    for (const auto& decompressor : decompressors())
+        if (prefix.starts_with(decompressor.magic))
+            return &decompressor;
+    return nullptr;
+}
+
+std::unique_ptr<ByteSource> open_source(const std::string& filename) {
+    const Decompressor* decompressor = detect_compression(filename);
+    if (!decompressor)
+        return open_file_source(filename);
+
+    if (!decompressor->open) {
+        std::cerr << "Error: " << decompressor->name << " support not built. Cannot process " << filename << std::endl;
+        return nullptr;
+    }
+    return decompressor->open(filename);
+}
+
+FileSink::FileSink(const std::string& filename) : file(filename, std::ios::binary | std::ios::trunc) {}
+
+bool FileSink::write(const char* src, std::size_t n) {
+    file.write(src, static_cast<std::streamsize>(n));
+    return static_cast<bool>(file);
+}
+
+bool FileSink::close() {
+    if (!file.is_open())
+        return false;
+    file.close();
+    return static_cast<bool>(file);
+}
+
+namespace {
+
+// Reserves disk space for a file of known size; only a hint, so failures are ignored.
+bool preallocate(int fd, std::uint64_t size) {
+    return size > 0 && posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+}
+
+} // namespace
+
+OutputWriter::OutputWriter(const std::string& filename, std::uint64_t expected_size, bool direct,
+                           std::size_t buffer_size, std::size_t buffers)
+    : buffers(std::max<std::size_t>(buffers, 1)),
+      buffer_size((std::max<std::size_t>(buffer_size, 1) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT) {
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (direct) {
+        fd = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+        direct_io = (fd >= 0);
+    }
+    // Some file systems (tmpfs, network mounts) reject O_DIRECT
+    if (fd < 0)
+        fd = ::open(filename.c_str(), flags, 0644);
+    if (fd < 0)
+        return;
+
+    for (auto& buffer : this->buffers) {
+        buffer.reset(static_cast<char*>(std::aligned_alloc(ALIGNMENT, this->buffer_size)));
+        if (!buffer) {
+            std::cerr << "Error allocating output buffers for: " << filename << std::endl;
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+    }
+    preallocated = preallocate(fd, expected_size);
+}
+
+OutputWriter::~OutputWriter() {
+    close();
+}
+
+bool OutputWriter::write_vectors(struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t put = ::writev(fd, iov, count);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0) {
+            std::cerr << "Error writing file: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        written += static_cast<std::uint64_t>(put);
+
+        // Skip what was written; a short write resumes mid-buffer
+        for (auto left = static_cast<std::size_t>(put); left > 0;) {
+            std::size_t step = std::min(left, iov->iov_len);
+            iov->iov_base = static_cast<char*>(iov->iov_base) + step;
+            iov->iov_len -= step;
+            left -= step;
+            if (iov->iov_len == 0) {
+                ++iov;
+                --count;
+            }
+        }
+        while (count > 0 && iov->iov_len == 0) {
+            ++iov;
+            --count;
+        }
+    }
+    return true;
+}
+
+bool OutputWriter::flush(std::size_t tail) {
+    // Full buffers before current, then tail bytes of the current buffer
+    std::vector<struct iovec> iov(current + 1);
+    for (std::size_t i = 0; i < current; ++i)
+        iov[i] = { buffers[i].get(), buffer_size };
+    iov[current] = { buffers[current].get(), tail };
+    current = used = 0;
+
+    if (direct_io && tail % ALIGNMENT != 0) {
+        // O_DIRECT needs aligned lengths: write the aligned part, then the rest through the cache
+        std::size_t aligned = tail / ALIGNMENT * ALIGNMENT;
+        struct iovec rest = { static_cast<char*>(iov.back().iov_base) + aligned, tail - aligned };
+        iov.back().iov_len = aligned;
+        if (!write_vectors(iov.data(), static_cast<int>(iov.size())))
+            return false;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        direct_io = false;
+        return write_vectors(&rest, 1);
+    }
+    return write_vectors(iov.data(), static_cast<int>(iov.size()));
+}
+
+bool OutputWriter::write(const char* src, std::size_t n) {
+    if (fd < 0 || failed)
+        return false;
+
+    while (n > 0) {
+        std::size_t count = std::min(n, buffer_size - used);
+        std::memcpy(buffers[current].get() + used, src, count);
+        used += count;
+        src += count;
+        n -= count;
+
+        if (used == buffer_size) {
+            used = 0;
+            // Gather every buffer into one writev once they are all full
+            if (++current == buffers.size()) {
+                current--;
+                if (!flush(buffer_size)) {
+                    failed = true;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool OutputWriter::close() {
+    if (fd < 0)
+        return false;
+
+    if (!failed && (current > 0 || used > 0))
+        failed = !flush(used);
+    // Drop the preallocated space past the data
+    if (preallocated && ftruncate(fd, static_cast<off_t>(written)) != 0)
+        failed = true;
+    failed |= (::close(fd) != 0);
+    fd = -1;
+    return !failed;
+}
+
+AsyncSink::AsyncSink(std::unique_ptr<ByteSink> inner, std::size_t block_size, std::size_t depth)
+    : inner(std::move(inner)), ring(depth) {
+    for (auto& block : ring)
+        block.data.resize(block_size);
+    if (this->inner->is_open())
+        worker = std::thread([this] { consume(); });
+    else
+        failed = true;
+}
+
+AsyncSink::~AsyncSink() {
+    close();
+}
+
+void AsyncSink::consume() {
+    for (;;) {
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this] { return closing || filled > 0; });
+            if (filled == 0)
+                return;
+        }
+
+        // The head block belongs to this thread until filled is dropped
+        Block& block = ring[head];
+        bool ok = inner->write(block.data.data(), block.size);
+        block.size = 0;
+
+        {
+            std::lock_guard lock(mutex);
+            failed |= !ok;
+            head = (head + 1) % ring.size();
+            filled--;
+        }
+        cv.notify_all();
+    }
+}
+
+bool AsyncSink::hand_off() {
+    std::unique_lock lock(mutex);
+    filled++;
+    cv.notify_all();
+    tail = (tail + 1) % ring.size();
+    // The next tail block is free once fewer than all blocks are waiting
+    cv.wait(lock, [this] { return filled < ring.size(); });
+    return !failed;
+}
+
+bool AsyncSink::write(const char* src, std::size_t n) {
+    if (closed || !worker.joinable())
+        return false;
+
+    while (n > 0) {
+        Block& block = ring[tail];
+        std::size_t count = std::min(n, block.data.size() - block.size);
+        std::memcpy(block.data.data() + block.size, src, count);
+        block.size += count;
+        src += count;
+        n -= count;
+        if (block.size == block.data.size() && !hand_off())
+            return false;
+    }
+    return true;
+}
+
+bool AsyncSink::close() {
+    if (closed)
+        return !failed;
+    closed = true;
+
+    if (worker.joinable()) {
+        {
+            std::lock_guard lock(mutex);
+            if (ring[tail].size > 0)
+                filled++;
+            closing = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+    bool ok = inner->close();
+    return ok && !failed;
+}
+
+#ifdef HAVE_LIBURING
+UringSink::UringSink(const std::string& filename, std::uint64_t expected_size, std::size_t block_size, std::size_t depth)
+    : ring(depth) {
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    preallocated = preallocate(fd, expected_size);
+    if (io_uring_queue_init(static_cast<unsigned>(depth), &uring, 0) != 0) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    for (auto& block : ring)
+        block.data.resize(block_size);
+    opened = true;
+}
+
+UringSink::~UringSink() {
+    close();
+}
+
+bool UringSink::queue(Block& block) {
+    io_uring_sqe* sqe = io_uring_get_sqe(&uring);
+    if (!sqe)
+        return false;
+
+    block.position = next_position;
+    block.queued = true;
+    next_position += block.size;
+
+    io_uring_prep_write(sqe, fd, block.data.data(), static_cast<unsigned>(block.size), block.position);
+    io_uring_sqe_set_data(sqe, &block);
+    in_flight++;
+    return io_uring_submit(&uring) >= 0;
+}
+
+bool UringSink::wait_one() {
+    io_uring_cqe* cqe;
+    if (io_uring_wait_cqe(&uring, &cqe) != 0)
+        return false;
+    Block& block = *static_cast<Block*>(io_uring_cqe_get_data(cqe));
+    int res = cqe->res;
+    io_uring_cqe_seen(&uring, cqe);
+    in_flight--;
+
+    if (res < 0) {
+        std::cerr << "Error writing file: " << std::strerror(-res) << std::endl;
+        failed = true;
+    } else {
+        // Finish a short write synchronously
+        std::size_t put = static_cast<std::size_t>(res);
+        while (put < block.size) {
+            ssize_t more = pwrite(fd, block.data.data() + put, block.size - put, block.position + put);
+            if (more <= 0) {
+                failed = true;
+                break;
+            }
+            put += static_cast<std::size_t>(more);
+        }
+    }
+    block.size = 0;
+    block.queued = false;
+    return true;
+}
+
+bool UringSink::write(const char* src, std::size_t n) {
+    if (!opened || failed)
+        return false;
+
+    while (n > 0) {
+        Block& block = ring[tail];
+        while (block.queued)
+            if (!wait_one())
+                failed = true;
+        if (failed)
+            return false;
+
+        std::size_t count = std::min(n, block.data.size() - block.size);
+        std::memcpy(block.data.data() + block.size, src, count);
+        block.size += count;
+        src += count;
+        n -= count;
+        if (block.size == block.data.size()) {
+            if (!queue(block)) {
+                failed = true;
+                return false;
+            }
+            tail = (tail + 1) % ring.size();
+        }
+    }
+    return true;
+}
+
+bool UringSink::close() {
+    if (!opened)
+        return false;
+    opened = false;
+
+    if (!failed && ring[tail].size > 0 && !queue(ring[tail]))
+        failed = true;
+    while (in_flight > 0 && wait_one());
+    io_uring_queue_exit(&uring);
+    if (preallocated && ftruncate(fd, static_cast<off_t>(next_position)) != 0)
+        failed = true;
+    failed |= (::close(fd) != 0);
+    return !failed;
+}
+#endif
+
+std::unique_ptr<ByteSink> open_sink(const std::string& filename, std::uint64_t expected_size, bool direct) {
+    return std::make_unique<OutputWriter>(filename, expected_size, direct);
+}
+
+std::unique_ptr<ByteSink> open_async_sink(const std::string& filename, std::uint64_t expected_size, bool direct) {
+#ifdef HAVE_LIBURING
+    // io_uring may be unavailable at run time (old kernels, sandboxes)
+    if (!direct) {
+        auto uring_sink = std::make_unique<UringSink>(filename, expected_size);
+        if (uring_sink->is_open())
+            return uring_sink;
+    }
+#endif
+    return std::make_unique<AsyncSink>(open_sink(filename, expected_size, direct));
+}
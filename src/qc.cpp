@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <iomanip>
+#include "qc.hpp"
+#include "utils.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Maps a byte to its Nucleotide value, or 4 for anything else.
+constexpr std::array<std::uint8_t, 256> make_base_index() {
+    std::array<std::uint8_t, 256> table{};
+    table.fill(4);
+    constexpr std::string_view bases = "ACGT";
+    for (std::size_t i = 0; i < bases.size(); ++i)
+        table[static_cast<std::uint8_t>(bases[i])] = static_cast<std::uint8_t>(i);
+    return table;
+}
+
+constexpr std::array<std::uint8_t, 256> base_index = make_base_index();
+
+#if defined(__SSE2__)
+// Horizontal sum of sixteen byte counters.
+std::uint64_t hsum_epu8(__m128i v) {
+    __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si32(sums)) + _mm_extract_epi16(sums, 4);
+}
+#endif
+
+template <typename Hist>
+void bump(Hist& hist, std::size_t idx) {
+    if (hist.size() <= idx)
+        hist.resize(idx + 1);
+    ++hist[idx];
+}
+
+template <typename Hist>
+void merge_hist(Hist& into, const Hist& from) {
+    if (into.size() < from.size())
+        into.resize(from.size());
+    for (std::size_t i = 0; i < from.size(); ++i) {
+        if constexpr (std::is_integral_v<typename Hist::value_type>) {
+            into[i] += from[i];
+        } else {
+            for (std::size_t j = 0; j < from[i].size(); ++j)
+                into[i][j] += from[i][j];
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * Compares sixteen bytes at a time against each nucleotide and accumulates the
+ * matches in byte-wide counters, which are flushed before they can overflow.
+ */
+void count_nucleotides(std::string_view seq, std::array<std::uint64_t, 4>& counts) {
+    const char* p = seq.data();
+    std::size_t n = seq.size();
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i a = _mm_set1_epi8('A');
+    const __m128i c = _mm_set1_epi8('C');
+    const __m128i g = _mm_set1_epi8('G');
+    const __m128i t = _mm_set1_epi8('T');
+
+    while (n - i >= 16) {
+        __m128i ca = _mm_setzero_si128(), cc = ca, cg = ca, ct = ca;
+        std::size_t blocks = std::min<std::size_t>((n - i) / 16, 255);
+
+        for (std::size_t b = 0; b < blocks; ++b, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            ca = _mm_sub_epi8(ca, _mm_cmpeq_epi8(v, a));
+            cc = _mm_sub_epi8(cc, _mm_cmpeq_epi8(v, c));
+            cg = _mm_sub_epi8(cg, _mm_cmpeq_epi8(v, g));
+            ct = _mm_sub_epi8(ct, _mm_cmpeq_epi8(v, t));
+        }
+
+        counts[0] += hsum_epu8(ca);
+        counts[1] += hsum_epu8(cc);
+        counts[2] += hsum_epu8(cg);
+        counts[3] += hsum_epu8(ct);
+    }
+#endif
+
+    for (; i < n; ++i)
+        if (std::uint8_t idx = base_index[static_cast<std::uint8_t>(p[i])]; idx < 4)
+            ++counts[idx];
+}
+
+void QCStats::add(std::string_view seq) {
+    ++read_count;
+
+    std::array<std::uint64_t, 4> acgt{};
+    count_nucleotides(seq, acgt);
+    std::uint64_t known = 0;
+    for (std::size_t i = 0; i < acgt.size(); ++i) {
+        base_counts[i] += acgt[i];
+        known += acgt[i];
+    }
+    other_bases += seq.size() - known;
+
+    if (position_counts.size() < seq.size())
+        position_counts.resize(seq.size());
+    for (std::size_t i = 0; i < seq.size(); ++i)
+        ++position_counts[i][base_index[static_cast<std::uint8_t>(seq[i])]];
+
+    bump(homopolymer_hist, calculateMaxHomopolymerLen(seq));
+    bump(length_hist, seq.size());
+}
+
+void QCStats::merge(const QCStats& other) {
+    read_count += other.read_count;
+    for (std::size_t i = 0; i < base_counts.size(); ++i)
+        base_counts[i] += other.base_counts[i];
+    other_bases += other.other_bases;
+
+    merge_hist(position_counts, other.position_counts);
+    merge_hist(homopolymer_hist, other.homopolymer_hist);
+    merge_hist(length_hist, other.length_hist);
+}
+
+double QCStats::gc_content() const {
+    std::uint64_t total = base_counts[0] + base_counts[1] + base_counts[2] + base_counts[3];
+    if (total == 0) return 0.0;
+
+    return static_cast<double>(base_counts[static_cast<int>(Nucleotide::C)] + base_counts[static_cast<int>(Nucleotide::G)]) / total;
+}
+
+void QCStats::print(std::ostream& os) const {
+    os << "Reads: " << read_count << std::endl;
+    for (std::size_t i = 0; i < base_counts.size(); ++i)
+        os << nucleotideStr[i] << ": " << base_counts[i] << std::endl;
+    os << "Other: " << other_bases << std::endl;
+    os << "GC Content: " << std::fixed << std::setprecision(2) << gc_content() * 100 << "%" << std::endl;
+
+    os << "\nRead length distribution:\n";
+    for (std::size_t len = 0; len < length_hist.size(); ++len)
+        if (length_hist[len])
+            os << len << '\t' << length_hist[len] << '\n';
+
+    os << "\nMax homopolymer length distribution:\n";
+    for (std::size_t len = 0; len < homopolymer_hist.size(); ++len)
+        if (homopolymer_hist[len])
+            os << len << '\t' << homopolymer_hist[len] << '\n';
+
+    os << "\nPer-position base composition:\npos\tA\tC\tG\tT\tOther\n";
+    for (std::size_t pos = 0; pos < position_counts.size(); ++pos) {
+        os << pos;
+        for (auto count : position_counts[pos])
+            os << '\t' << count;
+        os << '\n';
+    }
+    os.flush();
+}
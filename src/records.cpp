@@ -0,0 +1,254 @@
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "records.hpp"
+
+RecordReader::RecordReader(std::vector<std::string> filenames, RecordFormat format, std::size_t batch_size, bool use_mmap)
+    : filenames(std::move(filenames)), format(format), batch_size(std::max<std::size_t>(batch_size, 1)), use_mmap(use_mmap) {
+    opened = !this->filenames.empty();
+    for (const auto& filename : this->filenames) {
+        if (!std::ifstream(filename, std::ios::binary)) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            opened = false;
+        }
+    }
+}
+
+RecordReader::~RecordReader() {
+    close_lane();
+}
+
+bool RecordReader::open_lane() {
+    const std::string& filename = filenames[lane];
+    begin = end = 0;
+    eof = false;
+
+    // Uncompressed regular files are parsed straight from a private mapping, which
+    // stays writable so multi-line FASTA can be joined in place
+    if (use_mmap && !detect_compression(filename)) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+                mapped = static_cast<char*>(p);
+                mapped_size = static_cast<std::size_t>(st.st_size);
+                data = mapped;
+                end = mapped_size;
+                eof = true;
+            }
+        }
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    if (!mapped) {
+        source = open_source(filename);
+        if (!source || !source->is_open()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            opened = false;
+            return false;
+        }
+        if (buffer.empty())
+            buffer.resize(IO_BUFFER_SIZE);
+        data = buffer.data();
+        fill();
+    }
+
+    lane_format = format;
+    if (format == RecordFormat::Auto) {
+        std::size_t i = begin;
+        for (;;) {
+            while (i < end && std::isspace(static_cast<unsigned char>(data[i])))
+                i++;
+            if (i < end || eof)
+                break;
+            fill();
+        }
+        lane_format = (i == end) ? RecordFormat::Raw
+                    : (data[i] == '@') ? RecordFormat::Fastq
+                    : (data[i] == '>') ? RecordFormat::Fasta
+                    : RecordFormat::Raw;
+    }
+
+    lane_open = true;
+    return true;
+}
+
+void RecordReader::close_lane() {
+    if (mapped)
+        munmap(mapped, mapped_size);
+    mapped = nullptr;
+    mapped_size = 0;
+    source.reset();
+    lane_open = false;
+}
+
+bool RecordReader::fill() {
+    if (eof)
+        return false;
+
+    // Compact the unparsed tail to the front, growing only if it fills the buffer
+    std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (end == buffer.size())
+        buffer.resize(buffer.size() * 2);
+    data = buffer.data();
+
+    std::size_t got = source->read(buffer.data() + end, buffer.size() - end);
+    eof = (got == 0);
+    end += got;
+    return got > 0;
+}
+
+bool RecordReader::find_line(std::size_t from, std::size_t& stop) const {
+    if (from >= end)
+        return false;
+    if (const void* nl = std::memchr(data + from, '\n', end - from)) {
+        stop = static_cast<std::size_t>(static_cast<const char*>(nl) - data);
+        return true;
+    }
+    // Last line without a terminator
+    stop = end;
+    return eof;
+}
+
+std::string_view RecordReader::line_view(std::size_t from, std::size_t stop) const {
+    std::string_view line(data + from, stop - from);
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return line;
+}
+
+RecordReader::ParseResult RecordReader::parse_raw(Record& record) {
+    for (;;) {
+        std::size_t stop;
+        if (!find_line(begin, stop))
+            return eof ? ParseResult::Done : ParseResult::NeedMore;
+
+        std::string_view line = line_view(begin, stop);
+        begin = after(stop);
+        if (!line.empty()) {
+            record = { line, {} };
+            return ParseResult::Ok;
+        }
+    }
+}
+
+RecordReader::ParseResult RecordReader::parse_fasta(Record& record) {
+    for (;;) {
+        std::size_t header_stop;
+        if (!find_line(begin, header_stop))
+            return eof ? ParseResult::Done : ParseResult::NeedMore;
+        if (data[begin] != '>') {
+            // Blank lines, or text before the first header
+            begin = after(header_stop);
+            continue;
+        }
+
+        // The record runs until the next header line or the end of input
+        const std::size_t seq_begin = after(header_stop);
+        std::size_t record_end = seq_begin;
+        while (record_end < end && data[record_end] != '>') {
+            std::size_t stop;
+            if (!find_line(record_end, stop))
+                return ParseResult::NeedMore;
+            record_end = after(stop);
+        }
+        if (record_end == end && !eof)
+            return ParseResult::NeedMore;
+
+        // Join the sequence lines in place over the line breaks
+        std::size_t joined = seq_begin;
+        for (std::size_t pos = seq_begin; pos < record_end;) {
+            std::size_t stop = record_end;
+            find_line(pos, stop);
+            std::string_view line = line_view(pos, std::min(stop, record_end));
+            std::memmove(data + joined, line.data(), line.size());
+            joined += line.size();
+            pos = after(stop);
+        }
+
+        record = { std::string_view(data + seq_begin, joined - seq_begin), {} };
+        begin = record_end;
+        return ParseResult::Ok;
+    }
+}
+
+RecordReader::ParseResult RecordReader::parse_fastq(Record& record) {
+    for (;;) {
+        std::size_t header_stop;
+        if (!find_line(begin, header_stop))
+            return eof ? ParseResult::Done : ParseResult::NeedMore;
+        if (data[begin] != '@') {
+            // Blank lines, or junk between records
+            begin = after(header_stop);
+            continue;
+        }
+
+        std::size_t seq_stop, plus_stop, qual_stop;
+        const std::size_t seq_begin = after(header_stop);
+        if (!find_line(seq_begin, seq_stop) || !find_line(after(seq_stop), plus_stop)
+                || !find_line(after(plus_stop), qual_stop)) {
+            if (!eof)
+                return ParseResult::NeedMore;
+            std::cerr << "Error: truncated FASTQ record at end of " << current_file() << std::endl;
+            begin = end;
+            return ParseResult::Done;
+        }
+
+        record = { line_view(seq_begin, seq_stop), line_view(after(plus_stop), qual_stop) };
+        begin = after(qual_stop);
+        return ParseResult::Ok;
+    }
+}
+
+RecordReader::ParseResult RecordReader::parse(Record& record) {
+    switch (lane_format) {
+        case RecordFormat::Fasta:
+            return parse_fasta(record);
+        case RecordFormat::Fastq:
+            return parse_fastq(record);
+        default:
+            return parse_raw(record);
+    }
+}
+
+bool RecordReader::next_batch(std::vector<Record>& batch) {
+    batch.clear();
+    if (!opened)
+        return false;
+
+    while (lane < filenames.size()) {
+        if (!lane_open && !open_lane())
+            return false;
+
+        for (;;) {
+            Record record;
+            ParseResult result = parse(record);
+            if (result == ParseResult::Ok) {
+                batch.push_back(record);
+                if (batch.size() == batch_size)
+                    return true;
+            } else if (result == ParseResult::NeedMore) {
+                // Loading more moves the buffer, so hand out what is already parsed first
+                if (!batch.empty())
+                    return true;
+                fill();
+            } else {
+                break;
+            }
+        }
+
+        if (!batch.empty())
+            return true;
+        close_lane();
+        lane++;
+    }
+    return false;
+}
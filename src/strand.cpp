@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "strand.hpp"
+#include "thread_pool.hpp"
+#include "../utils/myRS/myRSmodule.cpp"
+
+namespace {
+
+/**
+ * @brief Get the Reed-Solomon code shared by every outer-code group.
+ * @return RS over GF(2^8).
+ */
+const ReedSolomon<uint8_t>& outer_code() {
+    static const ReedSolomon<uint8_t> rs(8);
+    return rs;
+}
+
+/**
+ * @brief Get the Reed-Solomon code shared by every inner-code codeword.
+ * @return RS over GF(2^8), built on first use.
+ */
+const ReedSolomon<uint8_t>& inner_code() {
+    static const ReedSolomon<uint8_t> rs(8);
+    return rs;
+}
+
+/**
+ * @brief Check the fields packed in a parity index against the outer-code settings.
+ * @param index The parity index.
+ * @param data_rows Data rows per outer-code group.
+ * @param parity_rows Parity rows per outer-code group.
+ * @return The number of data oligos in the group it names, or 0 if a field is out of range.
+ */
+size_t parity_group_blocks(uint64_t index, size_t data_rows, size_t parity_rows) {
+    const size_t blocks = (index >> 16) & 0xffff;
+    const size_t row = (index >> 8) & 0xff;
+    const size_t column = index & 0xff;
+    if (blocks == 0 || blocks > data_rows * OUTER_COLUMNS || row >= parity_rows)
+        return 0;
+    return column < OuterGroup(0, blocks, data_rows).columns ? blocks : 0;
+}
+
+/**
+ * @brief Parity oligos read of one outer-code group.
+ */
+struct GroupParity {
+    std::unordered_map<uint64_t, uint64_t> words;  ///< Data block of each parity index.
+    std::map<size_t, size_t> shapes;               ///< Votes for each number of data oligos in the group.
+
+    /**
+     * @brief Get the number of data oligos most parity indices agree on.
+     * @return The group's size.
+     */
+    size_t shape() const {
+        return std::max_element(shapes.begin(), shapes.end(), [](const auto& a, const auto& b) { return a.second < b.second; })->first;
+    }
+};
+
+/**
+ * @brief Gather the parity oligos of each outer-code group.
+ *
+ * A substituted base can leave any field of a parity index out of range, so those are
+ * dropped. Substituted group numbers make groups of a few parity oligos each, while a
+ * real group keeps at least half of its parity_rows * columns oligos unless the loss is
+ * heavy, so sparser groups are dropped too, as are partial groups other than the last.
+ * @param duplexes Index and data oligos as read.
+ * @param data_rows Data rows per outer-code group.
+ * @param parity_rows Parity rows per outer-code group.
+ * @return The parity of each group, by group number.
+ */
+std::map<uint64_t, GroupParity> parity_groups(std::span<const std::pair<Oligo, Oligo>> duplexes, size_t data_rows,
+                                              size_t parity_rows) {
+    std::map<uint64_t, GroupParity> groups;
+    for (const auto& [index_oligo, data_oligo] : duplexes) {
+        if (!(index_oligo.data() & PARITY_FLAG))
+            continue;
+        const size_t shape = parity_group_blocks(index_oligo.data(), data_rows, parity_rows);
+        if (shape == 0)
+            continue;
+        GroupParity& group = groups[(index_oligo.data() & ~PARITY_FLAG) >> 32];
+        group.words.emplace(index_oligo.data(), data_oligo.data());
+        group.shapes[shape]++;
+    }
+
+    std::erase_if(groups, [&](const auto& group) {
+        const OuterGroup layout(group.first, group.second.shape(), data_rows);
+        return 2 * group.second.words.size() < parity_rows * layout.columns;
+    });
+    if (!groups.empty()) {
+        const uint64_t last = groups.rbegin()->first;
+        std::erase_if(groups, [&](const auto& group) {
+            return group.first != last && group.second.shape() < data_rows * OUTER_COLUMNS;
+        });
+    }
+    return groups;
+}
+
+/**
+ * @brief Find where the data ends from the shape of the last group kept.
+ *
+ * Only the last group is partial, so a partial one ends the data. A full one may be
+ * followed by a group whose parity was too sparse to keep, whose data still counts.
+ * @param groups Parity of each group kept, by group number.
+ * @param data_rows Data rows per outer-code group.
+ * @return One past the last data index the groups allow, and whether the data ends there.
+ */
+std::pair<size_t, bool> data_extent(const std::map<uint64_t, GroupParity>& groups, size_t data_rows) {
+    if (groups.empty())
+        return {0, false};
+    const OuterGroup last(groups.rbegin()->first, groups.rbegin()->second.shape(), data_rows);
+    const size_t full = data_rows * OUTER_COLUMNS;
+    if (last.blocks < full)
+        return {last.first + last.blocks, true};
+    return {last.first + 2 * full, false};
+}
+
+} // namespace
+
+std::vector<uint64_t> outer_group_parity(const OuterGroup& group, std::vector<uint64_t> rows, size_t parity_rows) {
+    rows.resize(group.rows * group.columns, 0);
+    std::vector<uint64_t> words(parity_rows * group.columns);
+    outer_code().encoder(static_cast<int>(parity_rows)).parity_columns(reinterpret_cast<const uint8_t*>(rows.data()), group.rows,
+            group.columns * sizeof(uint64_t), reinterpret_cast<uint8_t*>(words.data()));
+    return words;
+}
+
+std::vector<std::pair<Oligo, Oligo>> outer_group_duplexes(size_t group, const std::vector<uint64_t>& blocks, size_t tail_bp,
+                                                          size_t data_rows, size_t parity_rows) {
+    const OuterGroup layout(group, blocks.size(), data_rows);
+    std::vector<std::pair<Oligo, Oligo>> duplexes;
+    duplexes.reserve(blocks.size() + parity_rows * layout.columns);
+    for (size_t i = 0; i < blocks.size(); ++i)
+        duplexes.emplace_back(Oligo(MAX_BP, layout.first + i), Oligo(MAX_BP, blocks[i]));
+    if (tail_bp > 0 && !duplexes.empty())
+        duplexes.back().second = Oligo(tail_bp, blocks.back());
+
+    if (parity_rows > 0 && !blocks.empty()) {
+        std::vector<uint64_t> words = outer_group_parity(layout, blocks, parity_rows);
+        for (size_t j = 0; j < parity_rows; ++j)
+            for (size_t c = 0; c < layout.columns; ++c)
+                duplexes.emplace_back(Oligo(MAX_BP, layout.parity_index(group, j, c)), Oligo(MAX_BP, words[j * layout.columns + c]));
+    }
+    return duplexes;
+}
+
+std::vector<Oligo> inner_parity_batch(size_t count, const std::function<std::pair<Oligo, Oligo>(size_t)>& duplex, size_t nsym,
+                                      ThreadPool& pool) {
+    const size_t n = INNER_MESSAGE_BYTES + nsym;
+    std::vector<uint8_t> symbols(count * n);
+    std::vector<std::span<uint8_t>> codewords(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto [index_oligo, data_oligo] = duplex(i);
+        inner_message(index_oligo, data_oligo, symbols.data() + i * n);
+        codewords[i] = std::span<uint8_t>(symbols.data() + i * n, n);
+    }
+    inner_code().encode_batch(codewords, static_cast<int>(nsym), pool);
+
+    std::vector<Oligo> parity;
+    parity.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        parity.push_back(parity_oligo(symbols.data() + i * n + INNER_MESSAGE_BYTES, nsym));
+    return parity;
+}
+
+void split_strands(std::span<const std::string_view> strands, size_t nsym, ThreadPool& pool,
+                   std::vector<std::pair<Oligo, Oligo>>& out, InnerStats& stats) {
+    out.clear();
+    out.reserve(strands.size());
+    if (nsym == 0) {
+        for (std::string_view seq : strands)
+            out.emplace_back(Oligo(seq.substr(0, MAX_BP)), Oligo(seq.substr(MAX_BP, MAX_BP)));
+        return;
+    }
+
+    const size_t n = INNER_MESSAGE_BYTES + nsym;
+    std::vector<uint8_t> symbols(strands.size() * n);
+    std::vector<std::span<uint8_t>> codewords(strands.size());
+    for (size_t i = 0; i < strands.size(); ++i) {
+        uint8_t* codeword = symbols.data() + i * n;
+        inner_message(Oligo(strands[i].substr(0, MAX_BP)), Oligo(strands[i].substr(MAX_BP, MAX_BP)), codeword);
+        parity_bytes(Oligo(strands[i].substr(DUPLEX_BP)), codeword + INNER_MESSAGE_BYTES);
+        codewords[i] = std::span<uint8_t>(codeword, n);
+    }
+    std::vector<DecodeStatus> status = inner_code().decode_batch(codewords, static_cast<int>(nsym), {}, pool);
+
+    for (size_t i = 0; i < strands.size(); ++i) {
+        if (!status[i].ok) {
+            stats.rejected++;
+            continue;
+        }
+        stats.corrected += status[i].corrected > 0;
+        uint64_t index_block = 0, data_block = 0;
+        std::memcpy(&index_block, codewords[i].data(), sizeof(uint64_t));
+        std::memcpy(&data_block, codewords[i].data() + sizeof(uint64_t), sizeof(uint64_t));
+        out.emplace_back(Oligo(MAX_BP, index_block), Oligo(MAX_BP, data_block));
+    }
+}
+
+std::optional<OuterStats> recover_outer(std::vector<std::pair<Oligo, Oligo>>& decode_duplex, size_t outer_data_rows,
+                                        size_t outer_parity_rows) {
+    std::map<uint64_t, GroupParity> groups = parity_groups(decode_duplex, outer_data_rows, outer_parity_rows);
+    std::erase_if(decode_duplex, [](const auto& duplex) { return duplex.first.data() & PARITY_FLAG; });
+    if (groups.empty() || outer_parity_rows == 0)
+        return std::nullopt;
+
+    std::unordered_map<uint64_t, size_t> blocks;  // data index -> first entry in decode_duplex
+    for (size_t e = 0; e < decode_duplex.size(); ++e)
+        blocks.emplace(decode_duplex[e].first.data(), e);
+
+    const ReedSolomon<uint8_t>& rs = outer_code();
+    const int nsym = static_cast<int>(outer_parity_rows);
+
+    // A damaged column: its data words as read and its eight byte codewords in the batch
+    struct DamagedColumn {
+        OuterGroup group;
+        size_t column;
+        std::vector<uint64_t> stored;
+        std::vector<bool> missing;
+        std::vector<unsigned int> erasures;
+        size_t first;
+    };
+    std::vector<DamagedColumn> damaged;
+    std::vector<uint8_t> symbols;
+    std::vector<std::pair<size_t, size_t>> extents;  // offset and length of each codeword in symbols
+
+    for (const auto& [g, votes] : groups) {
+        const auto& parity = votes.words;
+        OuterGroup group(g, votes.shape(), outer_data_rows);
+        const size_t n = group.rows + outer_parity_rows;
+        const size_t width = group.columns * sizeof(uint64_t);
+
+        // The group as the encoder saw it: data rows, then parity rows, zeros where oligos are missing
+        std::vector<uint64_t> matrix(n * group.columns, 0);
+        std::vector<bool> missing(n * group.columns, false);
+        for (size_t i = 0; i < group.blocks; ++i) {
+            auto it = blocks.find(group.first + i);
+            if (it != blocks.end())
+                matrix[i] = decode_duplex[it->second].second.data();
+            else
+                missing[i] = true;
+        }
+        for (size_t j = 0; j < outer_parity_rows; ++j) {
+            for (size_t c = 0; c < group.columns; ++c) {
+                auto it = parity.find(group.parity_index(g, j, c));
+                size_t cell = (group.rows + j) * group.columns + c;
+                if (it != parity.end())
+                    matrix[cell] = it->second;
+                else
+                    missing[cell] = true;
+            }
+        }
+
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(matrix.data());
+        std::vector<uint8_t> synd(nsym * width);
+        bool clean = rs.syndromes_columns(bytes, n, width, synd.data(), nsym);
+        if (clean && std::find(missing.begin(), missing.end(), true) == missing.end())
+            continue;
+
+        for (size_t c = 0; c < group.columns; ++c) {
+            DamagedColumn column{group, c, {}, {}, {}, extents.size()};
+            for (size_t r = 0; r < n; ++r)
+                if (missing[r * group.columns + c])
+                    column.erasures.push_back(static_cast<unsigned int>(r));
+            bool bad = !column.erasures.empty();
+            for (size_t i = 0; !bad && i < outer_parity_rows * width; i += width)
+                for (size_t b = 0; b < sizeof(uint64_t); ++b)
+                    bad |= synd[i + c * sizeof(uint64_t) + b] != 0;
+            if (!bad)
+                continue;
+
+            for (size_t r = 0; r < group.rows; ++r) {
+                column.stored.push_back(matrix[r * group.columns + c]);
+                column.missing.push_back(missing[r * group.columns + c]);
+            }
+            // Eight byte columns per oligo column, each its own codeword
+            for (size_t b = 0; b < sizeof(uint64_t); ++b) {
+                extents.emplace_back(symbols.size(), n);
+                for (size_t r = 0; r < n; ++r)
+                    symbols.push_back(bytes[r * width + c * sizeof(uint64_t) + b]);
+            }
+            damaged.push_back(std::move(column));
+        }
+    }
+
+    // Every damaged codeword of every group is decoded in one parallel batch
+    std::vector<std::span<uint8_t>> codewords;
+    std::vector<std::span<const unsigned int>> erasures;
+    for (const auto& [offset, length] : extents)
+        codewords.emplace_back(symbols.data() + offset, length);
+    for (const auto& column : damaged)
+        erasures.insert(erasures.end(), sizeof(uint64_t), column.erasures);
+    ThreadPool& pool = ThreadPool::shared();
+    std::vector<DecodeStatus> status = rs.decode_batch(codewords, nsym, erasures, pool);
+
+    OuterStats stats;
+    for (const auto& column : damaged) {
+        const OuterGroup& group = column.group;
+        bool ok = column.erasures.size() <= outer_parity_rows;
+        std::vector<uint64_t> words(group.rows, 0);
+        for (size_t b = 0; ok && b < sizeof(uint64_t); ++b) {
+            ok = status[column.first + b].ok;
+            const uint8_t* decoded = codewords[column.first + b].data();
+            for (size_t r = 0; ok && r < group.rows; ++r) {
+                // Padding past the end of the data is known to be zero
+                if (r * group.columns + column.column >= group.blocks && decoded[r] != 0)
+                    ok = false;
+                words[r] |= static_cast<uint64_t>(decoded[r]) << (8 * b);
+            }
+        }
+
+        if (!ok) {
+            stats.lost += std::count(column.missing.begin(), column.missing.end(), true);
+            continue;
+        }
+        for (size_t r = 0; r < group.rows; ++r) {
+            size_t i = r * group.columns + column.column;
+            if (i >= group.blocks)
+                continue;
+            if (column.missing[r]) {
+                decode_duplex.emplace_back(Oligo(MAX_BP, group.first + i), Oligo(MAX_BP, words[r]));
+                stats.recovered++;
+            } else if (column.stored[r] != words[r]) {
+                Oligo& stored = decode_duplex[blocks[group.first + i]].second;
+                stored = Oligo(stored.bp(), words[r]);
+                stats.corrected++;
+            }
+        }
+    }
+
+    // A substituted index names a block past any group or one read already; the first read of
+    // each index is the one the outer code checked
+    const size_t data_blocks = data_extent(groups, outer_data_rows).first;
+    std::unordered_set<uint64_t> seen;
+    std::erase_if(decode_duplex, [&](const auto& duplex) {
+        return duplex.first.data() >= data_blocks || !seen.insert(duplex.first.data()).second;
+    });
+    return stats;
+}
+
+size_t outer_data_blocks(std::span<const std::pair<Oligo, Oligo>> duplexes, size_t outer_data_rows, size_t outer_parity_rows) {
+    const auto [blocks, exact] = data_extent(parity_groups(duplexes, outer_data_rows, outer_parity_rows), outer_data_rows);
+    return exact ? blocks : 0;
+}
+
+std::optional<std::pair<Oligo, Oligo>> split_tail(std::string_view strand, size_t nsym) {
+    const size_t length = DUPLEX_BP + 4 * nsym;
+    if (strand.size() >= length || strand.size() + MAX_BP <= length || (length - strand.size()) % 4)
+        return std::nullopt;
+    const size_t data_bp = MAX_BP - (length - strand.size());
+    Oligo index(strand.substr(0, MAX_BP)), data(strand.substr(MAX_BP, data_bp));
+    if (nsym > 0 && !inner_decode(index, data, Oligo(strand.substr(MAX_BP + data_bp))))
+        return std::nullopt;
+    if (data.data() >> (2 * data_bp))
+        return std::nullopt;  // the inner code filled bytes the bases do not hold
+    return std::make_pair(index, data);
+}
+
+std::optional<std::pair<Oligo, Oligo>> find_tail(std::span<const std::pair<Oligo, Oligo>> tails, uint64_t last) {
+    std::map<std::pair<size_t, uint64_t>, size_t> votes;  // bases and block -> reads
+    for (const auto& [index_oligo, data_oligo] : tails)
+        if (index_oligo.data() == last)
+            votes[{data_oligo.bp(), data_oligo.data()}]++;
+    if (votes.empty())
+        return std::nullopt;
+    const auto best = std::max_element(votes.begin(), votes.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    return std::make_pair(Oligo(MAX_BP, last), Oligo(best->first.first, best->first.second));
+}
+
+void inner_message(const Oligo& index, const Oligo& data, uint8_t* out) {
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        out[i] = static_cast<uint8_t>(index.data() >> (8 * i));
+        out[sizeof(uint64_t) + i] = static_cast<uint8_t>(data.data() >> (8 * i));
+    }
+}
+
+Oligo parity_oligo(const uint8_t* parity, size_t nsym) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < nsym; ++i)
+        value = (value << 8) | parity[i];
+    return Oligo(4 * nsym, value);
+}
+
+void parity_bytes(const Oligo& parity, uint8_t* out) {
+    const size_t nsym = parity.bp() / 4;
+    for (size_t i = 0; i < nsym; ++i)
+        out[i] = static_cast<uint8_t>(parity.data() >> (8 * (nsym - 1 - i)));
+}
+
+Oligo inner_encode(const Oligo& index, const Oligo& data, size_t nsym) {
+    std::array<uint8_t, INNER_MESSAGE_BYTES + MAX_INNER_PARITY> codeword{};
+    nsym = std::clamp<size_t>(nsym, 1, MAX_INNER_PARITY);
+    inner_message(index, data, codeword.data());
+    inner_code().encode(std::span<const uint8_t>(codeword.data(), INNER_MESSAGE_BYTES),
+                        std::span<uint8_t>(codeword.data() + INNER_MESSAGE_BYTES, nsym), static_cast<int>(nsym));
+    return parity_oligo(codeword.data() + INNER_MESSAGE_BYTES, nsym);
+}
+
+bool inner_decode(Oligo& index, Oligo& data, const Oligo& parity, unsigned int* corrected) {
+    const size_t nsym = parity.bp() / 4;
+    if (nsym == 0 || nsym > MAX_INNER_PARITY)
+        return false;
+    std::array<uint8_t, INNER_MESSAGE_BYTES + MAX_INNER_PARITY> codeword{};
+    inner_message(index, data, codeword.data());
+    parity_bytes(parity, codeword.data() + INNER_MESSAGE_BYTES);
+    if (!inner_code().decode(codeword.data(), nullptr, codeword.data(), INNER_MESSAGE_BYTES, static_cast<int>(nsym), {},
+                             false, corrected))
+        return false;
+
+    uint64_t index_block = 0, data_block = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        index_block |= static_cast<uint64_t>(codeword[i]) << (8 * i);
+        data_block |= static_cast<uint64_t>(codeword[sizeof(uint64_t) + i]) << (8 * i);
+    }
+    index = Oligo(index.bp(), index_block);
+    data = Oligo(data.bp(), data_block);
+    return true;
+}
+
+bool DropletCollector::add(uint64_t index, uint64_t payload) {
+    const size_t segments = (index >> 32) & MAX_SEGMENTS;
+    if (segments == 0 || segments > max_segments)
+        return done();  // damaged index
+    if (fountain) {
+        if (segments == fountain->segments())
+            fountain->add(static_cast<uint32_t>(index), payload);
+        return done();
+    }
+
+    held.emplace_back(index, payload);
+    ++voters;
+    const size_t count = ++votes[segments];
+    if (count >= DROPLET_QUORUM && 2 * count > voters)
+        start(segments);
+    return done();
+}
+
+FountainDecoder* DropletCollector::finish() {
+    if (!fountain && !votes.empty()) {
+        const auto best = std::max_element(votes.begin(), votes.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+        if (best->second >= 2 && 2 * best->second > voters)
+            start(best->first);
+    }
+    return fountain ? &*fountain : nullptr;
+}
+
+void DropletCollector::start(size_t segments) {
+    fountain.emplace(segments);
+    for (const auto& [index, payload] : held)
+        if (((index >> 32) & MAX_SEGMENTS) == segments)
+            fountain->add(static_cast<uint32_t>(index), payload);
+    held = {};
+    votes.clear();
+}
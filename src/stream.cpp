@@ -0,0 +1,274 @@
+#include <array>
+#include <cstring>
+#include <iostream>
+#include "consensus.hpp"
+#include "stream.hpp"
+#include "strand.hpp"
+
+static_assert(StreamOptions{}.outer_data_rows == OUTER_DATA_ROWS && StreamOptions{}.outer_parity_rows == OUTER_PARITY_ROWS,
+              "Stream defaults must match Codec");
+
+namespace {
+
+/**
+ * @brief Check stream code settings, with the limits Codec's setters apply.
+ * @param options The settings.
+ * @return False, after printing why, if they cannot be used.
+ */
+bool valid_options(const StreamOptions& options) {
+    if (options.outer_data_rows == 0 || options.outer_data_rows + options.outer_parity_rows >= 256) {
+        std::cerr << "Outer code must have 1 to 255 rows in total" << std::endl;
+        return false;
+    }
+    if (options.inner_parity_bytes > MAX_INNER_PARITY) {
+        std::cerr << "Inner code can have at most " << MAX_INNER_PARITY << " parity bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the index and data blocks of duplexes.
+ * @param duplexes Index and data oligos.
+ * @return Index and data block of each.
+ */
+std::vector<std::pair<uint64_t, uint64_t>> blocks_of(const std::vector<std::pair<Oligo, Oligo>>& duplexes) {
+    std::vector<std::pair<uint64_t, uint64_t>> out;
+    out.reserve(duplexes.size());
+    for (const auto& [index_oligo, data_oligo] : duplexes)
+        out.emplace_back(index_oligo.data(), data_oligo.data());
+    return out;
+}
+
+} // namespace
+
+Encoder::Encoder(StrandSink& sink, StreamOptions options, ThreadPool& pool)
+    : sink(sink), options(options), pool(pool), ok(valid_options(options)) {
+    blocks.reserve(options.outer_data_rows * OUTER_COLUMNS);
+}
+
+bool Encoder::push(std::span<const std::byte> bytes) {
+    if (!ok || finished)
+        return false;
+    pushed += bytes.size();
+    const size_t group_blocks = options.outer_data_rows * OUTER_COLUMNS;
+
+    // Complete the block the last push left partial
+    if (pending_size > 0) {
+        const size_t take = std::min(bytes.size(), sizeof(uint64_t) - pending_size);
+        std::memcpy(reinterpret_cast<std::byte*>(&pending) + pending_size, bytes.data(), take);
+        pending_size += take;
+        bytes = bytes.subspan(take);
+        if (pending_size < sizeof(uint64_t))
+            return true;
+        blocks.push_back(pending);
+        pending = 0;
+        pending_size = 0;
+        if (blocks.size() == group_blocks && !flush_group())
+            return false;
+    }
+
+    // Whole blocks are copied straight in, a group at a time
+    while (bytes.size() >= sizeof(uint64_t)) {
+        const size_t count = std::min(group_blocks - blocks.size(), bytes.size() / sizeof(uint64_t));
+        const size_t old = blocks.size();
+        blocks.resize(old + count);
+        std::memcpy(blocks.data() + old, bytes.data(), count * sizeof(uint64_t));
+        bytes = bytes.subspan(count * sizeof(uint64_t));
+        if (blocks.size() == group_blocks && !flush_group())
+            return false;
+    }
+
+    std::memcpy(&pending, bytes.data(), bytes.size());
+    pending_size = bytes.size();
+    return true;
+}
+
+bool Encoder::finish() {
+    if (finished)
+        return false;
+    finished = true;
+    if (!ok)
+        return false;
+
+    // Like Codec::encode(), the last data oligo only carries the bases its bytes need
+    if (pending_size > 0) {
+        blocks.push_back(pending);
+        tail_bp = pending_size * 4;
+    }
+    return flush_group();
+}
+
+bool Encoder::flush_group() {
+    if (blocks.empty())
+        return true;
+    if (group >= (1ULL << 31)) {
+        std::cerr << "Stream too long for the outer code" << std::endl;
+        return ok = false;
+    }
+
+    std::vector<std::pair<Oligo, Oligo>> duplexes =
+        outer_group_duplexes(group, blocks, tail_bp, options.outer_data_rows, options.outer_parity_rows);
+
+    std::vector<Oligo> inner;
+    if (options.inner_parity_bytes > 0)
+        inner = inner_parity_batch(duplexes.size(), [&](size_t i) { return duplexes[i]; }, options.inner_parity_bytes, pool);
+
+    std::vector<std::string> strands;
+    strands.reserve(duplexes.size());
+    for (size_t i = 0; i < duplexes.size(); ++i) {
+        strands.push_back(duplexes[i].first.seq() + duplexes[i].second.seq());
+        if (i < inner.size())
+            strands.back() += inner[i].seq();
+    }
+
+    blocks.clear();
+    group++;
+    written += strands.size();
+    if (!sink.write(strands))
+        ok = false;
+    return ok;
+}
+
+Decoder::Decoder(BlockSink& sink, StreamOptions options, ThreadPool& pool)
+    : sink(sink), options(options), pool(pool), ok(valid_options(options)) {}
+
+bool Decoder::push(std::span<const Record> records) {
+    if (!ok || finished)
+        return false;
+
+    const size_t length = DUPLEX_BP + 4 * options.inner_parity_bytes;
+    std::vector<std::string_view> strands;
+    strands.reserve(records.size());
+    for (const auto& record : records) {
+        std::string_view seq = record.seq;
+        if (seq.size() == length) {
+            strands.push_back(seq);
+            continue;
+        }
+        if (auto tail = split_tail(seq, options.inner_parity_bytes))
+            tails.push_back(*tail);
+        if (seq.size() + MAX_INDEL >= length && seq.size() <= length + MAX_INDEL) {
+            noisy.append(seq);
+            noisy_ends.push_back(noisy.size());
+        }
+    }
+
+    std::vector<std::pair<Oligo, Oligo>> duplexes;
+    InnerStats stats;
+    split_strands(strands, options.inner_parity_bytes, pool, duplexes, stats);
+    inner_rejected += stats.rejected;
+    return add(blocks_of(duplexes));
+}
+
+bool Decoder::add(std::span<const std::pair<uint64_t, uint64_t>> duplexes) {
+    for (const auto& [index, block] : duplexes) {
+        if (is_droplet(index))
+            droplets.add(index, block);
+        else if (index & PARITY_FLAG)
+            parity.emplace_back(index, block);
+        else if (data_length && index * sizeof(uint64_t) >= *data_length)
+            continue;  // substituted index
+        else if (data.emplace(index, block).second && !emit(index, block))
+            return false;
+    }
+    return ok;
+}
+
+bool Decoder::emit(uint64_t index, uint64_t block) {
+    std::array<std::byte, sizeof(uint64_t)> bytes;
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<std::byte>(block >> (8 * i));
+    const uint64_t offset = index * sizeof(uint64_t);
+    size_t size = bytes.size();
+    if (data_length)
+        size = offset < *data_length ? std::min<uint64_t>(size, *data_length - offset) : 0;
+    if (size > 0 && !sink.write(offset, std::span(bytes).first(size)))
+        ok = false;
+    return ok;
+}
+
+void Decoder::add_tail() {
+    // With the length known the partial last block is known too; otherwise its index is the
+    // last one the parity oligos describe or, without them, the one after the last block read
+    uint64_t last = 0;
+    if (data_length) {
+        if (*data_length % sizeof(uint64_t) == 0)
+            return;
+        last = *data_length / sizeof(uint64_t);
+    } else {
+        for (const auto& [index, block] : data)
+            last = std::max<uint64_t>(last, index + 1);
+        std::vector<std::pair<Oligo, Oligo>> duplexes;
+        for (const auto& [index, block] : parity)
+            duplexes.emplace_back(Oligo(MAX_BP, index), Oligo(MAX_BP, block));
+        if (const size_t blocks = outer_data_blocks(duplexes, options.outer_data_rows, options.outer_parity_rows))
+            last = blocks - 1;
+    }
+    if (data.count(last))
+        return;
+
+    auto tail = find_tail(tails, last);
+    if (!tail || (data_length && tail->second.bp() / 4 != *data_length % sizeof(uint64_t)))
+        return;
+    if (!data_length)
+        data_length = last * sizeof(uint64_t) + tail->second.bp() / 4;
+    data.emplace(last, tail->second.data());
+    emit(last, tail->second.data());
+}
+
+bool Decoder::finish() {
+    if (finished)
+        return false;
+    finished = true;
+    if (!ok)
+        return false;
+
+    // The partial last block is placed before reads with indels can claim its index
+    add_tail();
+    if (!ok)
+        return false;
+
+    // Reads with indels are clustered and reconstructed into strands, which fill indices not read intact
+    if (!noisy_ends.empty() && !droplets.done()) {
+        std::vector<std::string_view> reads;
+        reads.reserve(noisy_ends.size());
+        for (size_t i = 0, start = 0; i < noisy_ends.size(); start = noisy_ends[i++])
+            reads.push_back(std::string_view(noisy).substr(start, noisy_ends[i] - start));
+        auto clusters = cluster_reads(reads, CLUSTER_MAXDIST, thread_workspace());
+        std::vector<std::string> strands = reconstruct_clusters(reads, clusters, DUPLEX_BP + 4 * options.inner_parity_bytes, pool);
+        std::vector<std::string_view> views(strands.begin(), strands.end());
+        std::vector<std::pair<Oligo, Oligo>> duplexes;
+        InnerStats stats;
+        split_strands(views, options.inner_parity_bytes, pool, duplexes, stats);
+        if (!add(blocks_of(duplexes)))
+            return false;
+    }
+
+    if (FountainDecoder* fountain = droplets.finish()) {
+        fountain->solve();
+        for (size_t i = 0; i < fountain->segments(); ++i)
+            if (fountain->is_known(i) && data.emplace(i, fountain->segment(i)).second && !emit(i, fountain->segment(i)))
+                return false;
+    }
+
+    // The outer code fills lost blocks and corrects damaged ones, which are sent again
+    if (!parity.empty() && options.outer_parity_rows > 0) {
+        std::vector<std::pair<Oligo, Oligo>> duplexes;
+        duplexes.reserve(data.size() + parity.size());
+        for (const auto& [index, block] : data)
+            duplexes.emplace_back(Oligo(MAX_BP, index), Oligo(MAX_BP, block));
+        for (const auto& [index, block] : parity)
+            duplexes.emplace_back(Oligo(MAX_BP, index), Oligo(MAX_BP, block));
+        recover_outer(duplexes, options.outer_data_rows, options.outer_parity_rows);
+        for (const auto& [index_oligo, data_oligo] : duplexes) {
+            auto [it, added] = data.try_emplace(index_oligo.data(), data_oligo.data());
+            if (!added && it->second == data_oligo.data())
+                continue;
+            it->second = data_oligo.data();
+            if (!emit(index_oligo.data(), data_oligo.data()))
+                return false;
+        }
+    }
+    return ok;
+}
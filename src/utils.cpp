@@ -1,3 +1,4 @@
+#include <cstdint>
 #include "utils.hpp"
 
 
@@ -53,7 +54,7 @@ double calculateGCContent(const std::string& sequence) {
 }
 
 // Using iterators instead of a range-based for loop.
-int calculateMaxHomopolymerLen(const std::string& sequence) {
+int calculateMaxHomopolymerLen(std::string_view sequence) {
     int maxhp = 0;
     int n = 1;
 
@@ -92,60 +93,75 @@ std::string revcom(const std::string& dna) {
     return oligo;
 }
 
-/**
- * Using initializer lists for std::vector and range-based for loops introduced in C++20. Also leveraging some
- * newly introduced algorithm functions from the library like std::ranges::views::iota and std::ranges::for_each.
- */
-int levenshtein_distance(const std::string& str1, const std::string& str2) {
-    int len1 = str1.length();
-    int len2 = str2.length();
+AlignmentWorkspace::AlignmentWorkspace(std::size_t bytes)
+    : block(new std::byte[bytes]), block_size(bytes) {}
 
-    std::vector<std::vector<int>> matrix(len1 + 1, std::vector<int>(len2 + 1));
+void* AlignmentWorkspace::allocate(std::size_t bytes, std::size_t align) {
+    std::size_t offset = (used + align - 1) & ~(align - 1);
+    if (offset + bytes <= block_size) {
+        used = offset + bytes;
+        return block.get() + offset;
+    }
 
-    std::ranges::for_each(std::ranges::views::iota(0, len1 + 1), [&](int i) {
-            std::ranges::for_each(std::ranges::views::iota(0, len2 + 1), [&](int j) {
-                    matrix[i][j] = (i == 0) ? j : ((j == 0) ? i : 0);
-                    });
-            });
+    // Spill: keep earlier spans valid and remember how much we would have needed
+    spill.emplace_back(new std::byte[bytes + align]);
+    spilled += bytes + align;
+    std::size_t misalign = reinterpret_cast<std::uintptr_t>(spill.back().get()) & (align - 1);
+    return spill.back().get() + (misalign ? align - misalign : 0);
+}
 
-    std::ranges::for_each(std::ranges::views::iota(1, len1 + 1), [&](int i) {
-            std::ranges::for_each(std::ranges::views::iota(1, len2 + 1), [&](int j) {
-                    int cost = (str1[i - 1] != str2[j - 1]);
-                    matrix[i][j] = std::min({ matrix[i - 1][j] + 1, matrix[i][j - 1] + 1, matrix[i - 1][j - 1] + cost });
-                    });
-            });
+void AlignmentWorkspace::reset() {
+    if (!spill.empty()) {
+        block_size += spilled;
+        block.reset(new std::byte[block_size]);
+        spill.clear();
+        spilled = 0;
+    }
+    used = 0;
+}
 
-    return matrix[len1][len2];
+AlignmentWorkspace& thread_workspace() {
+    thread_local AlignmentWorkspace ws;
+    return ws;
+}
+
+int levenshtein_distance(const std::string& str1, const std::string& str2) {
+    return levenshtein_distance(str1, str2, thread_workspace());
 }
 
 /**
- *Employing range-based for loops, introducing std::transform, and utilizing lambda expressions.
- *Used for transforming and updating operations on sequences.
+ * Only the previous row of the DP matrix is needed, so two rows are carved out of the
+ * workspace instead of allocating the full (len1 + 1) x (len2 + 1) matrix.
  */
-bool Match(const std::string& p, const std::string& q, int maxdist) {
-    std::vector<std::vector<int>> dp(p.size() + 1, std::vector<int>(q.size() + 1, 0));
-
-    // Initialize the dynamic programming matrix:
-    for (size_t i = 0; i <= p.size(); ++i) {
-        for (size_t j = 0; j <= q.size(); ++j) {
-            if (i == 0)
-                dp[i][j] = j;
-            else if (j == 0)
-                dp[i][j] = i;
-            else
-                dp[i][j] = 0;
-        }
-    }
+int levenshtein_distance(std::string_view str1, std::string_view str2, AlignmentWorkspace& ws) {
+    int len1 = str1.length();
+    int len2 = str2.length();
 
-    //Fill in the dynamic programming matrix:
-    for (size_t i = 1; i <= p.size(); ++i) {
-        for (size_t j = 1; j <= q.size(); ++j) {
-            int cost = (p[i - 1] == q[j - 1]) ? 0 : 1;
-            dp[i][j] = std::min({ dp[i - 1][j] + 1, dp[i][j - 1] + 1, dp[i - 1][j - 1] + cost });
+    ws.reset();
+    std::span<int> prev = ws.alloc<int>(len2 + 1);
+    std::span<int> curr = ws.alloc<int>(len2 + 1);
+
+    std::iota(prev.begin(), prev.end(), 0);
+
+    for (int i = 1; i <= len1; ++i) {
+        curr[0] = i;
+        for (int j = 1; j <= len2; ++j) {
+            int cost = (str1[i - 1] != str2[j - 1]);
+            curr[j] = std::min({ prev[j] + 1, curr[j - 1] + 1, prev[j - 1] + cost });
         }
+        std::swap(prev, curr);
     }
 
-    return dp[p.size()][q.size()] <= maxdist;
+    return prev[len2];
+}
+
+bool Match(const std::string& p, const std::string& q, int maxdist) {
+    return Match(p, q, maxdist, thread_workspace());
+}
+
+// Same recurrence as levenshtein_distance, compared against maxdist.
+bool Match(std::string_view p, std::string_view q, int maxdist, AlignmentWorkspace& ws) {
+    return levenshtein_distance(p, q, ws) <= maxdist;
 }
 
 /**
@@ -167,29 +183,33 @@ void update_distances(int& fj1, int& lj1, int cbMismatch, int& mdist, int& mn, i
     mdist = std::min({ mdist, ln }); 
 }
 
-// Utilizing std::min_element function to find the minimum distance, combined with some algorithm functions for a more concise code.
 bool Find(const std::string& s, const std::string& subseq, int maxdist, int& pos, int& length) {
+    return Find(s, subseq, maxdist, pos, length, thread_workspace());
+}
+
+// Utilizing std::min_element function to find the minimum distance; only the last DP row is kept.
+bool Find(std::string_view s, std::string_view subseq, int maxdist, int& pos, int& length, AlignmentWorkspace& ws) {
     int slen = s.length();
     int sslen = subseq.length();
 
-    std::vector<std::vector<int>> distances(sslen + 1, std::vector<int>(slen + 1, 0));
-
-    for (int n = 1; n <= sslen; ++n)
-        distances[n][0] = n;
+    ws.reset();
+    std::span<int> prev = ws.alloc<int>(slen + 1);
+    std::span<int> curr = ws.alloc<int>(slen + 1);
 
-    for (int m = 1; m <= slen; ++m)
-        distances[0][m] = m;
+    std::iota(prev.begin(), prev.end(), 0);
 
     for (int n = 1; n <= sslen; ++n) {
+        curr[0] = n;
         for (int m = 1; m <= slen; ++m) {
             int cbMismatch = (subseq[n - 1] != s[m - 1]) ? 1 : 0;
-            distances[n][m] = std::min({ distances[n - 1][m] + 1, distances[n][m - 1] + 1, distances[n - 1][m - 1] + cbMismatch });
+            curr[m] = std::min({ prev[m] + 1, curr[m - 1] + 1, prev[m - 1] + cbMismatch });
         }
+        std::swap(prev, curr);
     }
 
-    auto minDistanceIter = std::min_element(distances[sslen].begin(), distances[sslen].end());
+    auto minDistanceIter = std::min_element(prev.begin(), prev.end());
     int minDistance = *minDistanceIter;
-    int end = static_cast<int>(std::distance(distances[sslen].begin(), minDistanceIter));
+    int end = static_cast<int>(std::distance(prev.begin(), minDistanceIter));
 
     if (minDistance > maxdist) {
         pos = -1;
@@ -238,74 +258,81 @@ std::pair<int, int> FindSuffix(const std::string& s, const std::string& suffix,
     }
 }
 
+std::pair<int, std::string> Diff(const std::string& from, const std::string& to) {
+    std::string diff;
+    int dist = Diff(from, to, diff, thread_workspace());
+    return { dist, diff };
+}
+
 /**
- *Using 'using' to alias types for improved clarity and readability.
- *The return value remains unchanged, still returning a std::pair<int, std::string>,
- *which includes the minimum edit distance and the string describing the edit operations.
+ * Costs only need the previous row, so they live in two rolling rows; the backtrack
+ * matrix stores one action character per cell. Both come from the workspace, and the
+ * edit script is written backwards into `diff` and reversed once at the end.
  */
-using Matrix = std::vector<std::vector<int>>;
-using ActionMatrix = std::vector<std::vector<std::string>>;
-std::pair<int, std::string> Diff(const std::string& from, const std::string& to) {
+int Diff(std::string_view from, std::string_view to, std::string& diff, AlignmentWorkspace& ws) {
     int m = from.size();
     int n = to.size();
 
-    // Initialize matrices
-    Matrix v(m + 1, std::vector<int>(n + 1));
-    ActionMatrix b(m + 1, std::vector<std::string>(n + 1, ""));
-    // Initialize base cases
-    for (int i = 1; i <= n; ++i) {
-        v[0][i] = i;
-        b[0][i] = "I";
-    }
+    ws.reset();
+    std::span<int> prev = ws.alloc<int>(n + 1);
+    std::span<int> curr = ws.alloc<int>(n + 1);
+    std::span<char> b = ws.alloc<char>(static_cast<std::size_t>(m + 1) * (n + 1));
+    auto action = [&](int i, int j) -> char& { return b[static_cast<std::size_t>(i) * (n + 1) + j]; };
 
-    for (int i = 1; i <= m; ++i) {
-        v[i][0] = i;
-        b[i][0] = "D";
+    // Initialize base cases
+    action(0, 0) = '\0';
+    for (int j = 0; j <= n; ++j) {
+        prev[j] = j;
+        if (j > 0)
+            action(0, j) = 'I';
     }
 
     // Dynamic programming to compute minimum edit distance
     for (int i = 1; i <= m; ++i) {
+        curr[0] = i;
+        action(i, 0) = 'D';
         for (int j = 1; j <= n; ++j) {
-            int deletionCost = v[i - 1][j] + 1;
-            int insertionCost = v[i][j - 1] + 1;
-            int substitutionCost = v[i - 1][j - 1];
+            int deletionCost = prev[j] + 1;
+            int insertionCost = curr[j - 1] + 1;
+            int substitutionCost = prev[j - 1];
 
             if (from[i - 1] != to[j - 1])
                 substitutionCost++;
 
             int mincost = std::min({ insertionCost, deletionCost, substitutionCost });
 
-            v[i][j] = mincost;
+            curr[j] = mincost;
 
             if (mincost == deletionCost)
-                b[i][j] = "D";
+                action(i, j) = 'D';
             else if (mincost == insertionCost)
-                b[i][j] = "I";
+                action(i, j) = 'I';
             else
-                b[i][j] = (substitutionCost == mincost) ? "R" : "-";
+                action(i, j) = 'R';
         }
+        std::swap(prev, curr);
     }
 
     // Backtrack to get the edit actions
-    std::string diff = "";
+    diff.clear();
     for (int i = m, j = n; i > 0 || j > 0;) {
-        switch (b[i][j][0]) {
+        switch (action(i, j)) {
             case 'D':
-                diff = "D" + diff;
+                diff += 'D';
                 i--;
                 break;
             case 'R':
-                diff = (from[i - 1] != to[j - 1]) ? "R" + diff : "-" + diff;
+                diff += (from[i - 1] != to[j - 1]) ? 'R' : '-';
                 i--;
                 j--;
                 break;
             case 'I':
-                diff = "I" + diff;
+                diff += 'I';
                 j--;
                 break;
         }
     }
+    std::ranges::reverse(diff);
 
-    return { v[m][n], diff };
+    return prev[n];
 }
-
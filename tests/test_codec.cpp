@@ -0,0 +1,157 @@
+#include <random>
+#include <iostream>
+#include "../src/codec.cpp"
+#include "test_dir.hpp"
+
+std::mt19937 generator(2024);
+
+std::string read_file(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Encode a file, drop a fraction of the encoded oligos, substitute a base between first_base
+// and last_base (the payload by default) of another fraction, decode the rest and compare
+bool test_outer_code(const std::string& name, size_t size, double loss, double substitution, bool expect_recovery,
+                     double fountain = 0, size_t inner = 0, size_t first_base = MAX_BP, size_t last_base = DUPLEX_BP - 1) {
+    std::string content(size, '\0');
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& c : content)
+        c = static_cast<char>(byte(generator));
+    std::ofstream(name, std::ios::binary) << content;
+
+    {
+        Codec codec(name);
+        if (fountain > 0)
+            codec.set_fountain(fountain);
+        codec.set_inner_code(inner);
+        codec.encode();
+        codec.write_duplex();
+    }
+
+    std::istringstream lines(read_file(name + ".encode"));
+    std::vector<std::string> kept;
+    std::bernoulli_distribution drop(loss), substitute(substitution);
+    std::uniform_int_distribution<size_t> position(first_base, last_base);
+    for (std::string line; std::getline(lines, line);) {
+        if (drop(generator))
+            continue;
+        if (substitute(generator)) {
+            // The strand of the partial last block is shorter than the others
+            const size_t at = position(generator);
+            if (at < line.size())
+                line[at] = (line[at] == 'A') ? 'C' : 'A';
+        }
+        kept.push_back(line);
+    }
+    std::shuffle(kept.begin(), kept.end(), generator);
+    {
+        std::ofstream out(name + ".lossy", std::ios::binary);
+        for (const auto& line : kept)
+            out << line << '\n';
+    }
+
+    {
+        Codec codec(name + ".lossy");
+        codec.set_inner_code(inner);
+        codec.decode();
+    }
+
+    bool passed = (read_file(name + ".lossy.decode") == content) == expect_recovery;
+    std::cout << "Test " << name << " (" << loss * 100 << "% lost, " << substitution * 100 << "% substituted): " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// Most parity oligos of a last group one column wide are lost: that group is left as read,
+// and every data oligo read, of it or past it, is still decoded
+bool test_sparse_last_group() {
+    const std::string name = "outer_sparse.bin";
+    const size_t full = OUTER_DATA_ROWS * OUTER_COLUMNS;
+    std::string content(8 * (full + 100) + 5, '\0');
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& c : content)
+        c = static_cast<char>(byte(generator));
+    std::ofstream(name, std::ios::binary) << content;
+    {
+        Codec codec(name);
+        codec.encode();
+        codec.write_duplex();
+    }
+
+    std::istringstream lines(read_file(name + ".encode"));
+    std::bernoulli_distribution drop_parity(0.9), drop_data(0.05);
+    {
+        std::ofstream out(name + ".lossy", std::ios::binary);
+        for (std::string line; std::getline(lines, line);) {
+            const uint64_t index = Oligo(std::string_view(line).substr(0, MAX_BP)).data();
+            const bool last_group = ((index & ~PARITY_FLAG) >> 32) == 1;
+            if ((index & PARITY_FLAG) ? last_group && drop_parity(generator) : index < full && drop_data(generator))
+                continue;
+            out << line << '\n';
+        }
+    }
+    {
+        Codec codec(name + ".lossy");
+        codec.decode();
+    }
+
+    bool passed = read_file(name + ".lossy.decode") == content;
+    std::cout << "Test " << name << " (90% of the last group's parity lost): " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// Droplets with a damaged segment count, read before any intact one, hold no majority
+// even when one wrong count gathers a quorum, so the decoder starts with the true count
+bool test_droplet_quorum() {
+    const size_t segments = 1000;
+    std::uniform_int_distribution<uint64_t> word;
+    auto droplet = [&](size_t count, uint64_t seed) { return (static_cast<uint64_t>(count) << 32) | seed; };
+
+    DropletCollector droplets(segments * 2);
+    for (size_t i = 0; i < 2 * DROPLET_QUORUM; ++i)
+        droplets.add(droplet(segments + 1 + i, i), word(generator));  // each damaged differently
+    for (size_t i = 0; i < DROPLET_QUORUM; ++i)
+        droplets.add(droplet(segments / 2, i), word(generator));      // all damaged alike
+    for (size_t i = 0; i < 4 * DROPLET_QUORUM; ++i)
+        droplets.add(droplet(segments, i), word(generator));
+
+    FountainDecoder* fountain = droplets.finish();
+    bool passed = fountain && fountain->segments() == segments;
+    std::cout << "Test droplet quorum with damaged counts first: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+int main() {
+    // Everything the tests write goes to a scratch directory that is removed at the end
+    TestDir dir("test_codec");
+    bool ok = true;
+    ok &= test_outer_code("outer_small.bin", 8 * 100, 0.1, 0.0, true);
+    ok &= test_outer_code("outer_groups.bin", 8 * 40000, 0.05, 0.0, true);
+    ok &= test_outer_code("outer_clean.bin", 8 * 20000, 0.0, 0.0, true);
+    ok &= test_outer_code("outer_substituted.bin", 8 * 20000, 0.02, 0.02, true);
+    // Far past the parity budget, the lost oligos stay lost
+    ok &= test_outer_code("outer_heavy.bin", 8 * 20000, 0.3, 0.0, false);
+
+    // Fountain mode: any set of enough droplets decodes, whichever ones are lost
+    ok &= test_outer_code("fountain_small.bin", 8 * 100, 0.1, 0.0, true, 0.5);
+    ok &= test_outer_code("fountain_clean.bin", 8 * 20000, 0.0, 0.0, true, 0.25);
+    ok &= test_outer_code("fountain_lossy.bin", 8 * 20000, 0.12, 0.0, true, 0.25);
+    ok &= test_outer_code("fountain_heavy.bin", 8 * 20000, 0.4, 0.0, false, 0.25);
+    // Droplets whose segment count was substituted are outvoted, whichever one is read first
+    ok &= test_outer_code("fountain_count.bin", 8 * 20000, 0.05, 0.05, true, 0.25, 0, 1, 15);
+
+    // Inner code: substitutions are corrected in each read, far past what the outer code alone could fix
+    ok &= test_outer_code("inner_substituted.bin", 8 * 20000, 0.02, 0.5, true, 0, 4);
+    ok &= test_outer_code("inner_fountain.bin", 8 * 20000, 0.1, 0.5, true, 0.25, 4);
+
+    // Substituted indices, flags included, are read as noise or corrected, never as data
+    ok &= test_outer_code("outer_index.bin", 8 * 20000, 0.02, 0.02, true, 0, 0, 0, MAX_BP - 1);
+    ok &= test_outer_code("outer_flags.bin", 8 * 20000, 0.02, 0.02, true, 0, 0, 0, 1);
+
+    // The partial last block decodes to its own length, corrected by either code
+    ok &= test_outer_code("outer_tail.bin", 8 * 1000 + 5, 0.0, 0.2, true);
+    ok &= test_outer_code("inner_tail.bin", 8 * 1000 + 3, 0.0, 0.5, true, 0, 4);
+    ok &= test_sparse_last_group();
+    ok &= test_droplet_quorum();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include <random>
+#include <iostream>
+#include "consensus.hpp"
+#include "thread_pool.hpp"
+
+const size_t STRAND_LEN = 64;
+
+std::mt19937 generator(2025);
+
+std::string random_strand(size_t length) {
+    std::uniform_int_distribution<int> distribution(0, 3);
+    std::string result;
+    for (size_t i = 0; i < length; i++)
+        result += nt2string(distribution(generator));
+    return result;
+}
+
+// Copy a strand with independent substitution, insertion and deletion errors at the given rate each.
+std::string noisy_copy(const std::string& strand, double rate) {
+    std::uniform_real_distribution<double> p(0.0, 1.0);
+    std::uniform_int_distribution<int> nt(0, 3);
+    std::string read;
+    for (char c : strand) {
+        if (p(generator) < rate)
+            read += nt2string(nt(generator));
+        if (p(generator) < rate)
+            continue;
+        read += (p(generator) < rate) ? nt2string(nt(generator))[0] : c;
+    }
+    return read;
+}
+
+bool test_reconstruct(int copies, double rate, int trials, double min_success) {
+    AlignmentWorkspace ws;
+    int recovered = 0;
+    for (int t = 0; t < trials; t++) {
+        std::string strand = random_strand(STRAND_LEN);
+        std::vector<std::string> reads;
+        for (int c = 0; c < copies; c++)
+            reads.push_back(noisy_copy(strand, rate));
+        std::vector<std::string_view> views(reads.begin(), reads.end());
+        recovered += reconstruct(views, STRAND_LEN, ws) == strand;
+    }
+    double success = static_cast<double>(recovered) / trials;
+    std::cout << "reconstruct copies=" << copies << " rate=" << rate << ": " << success << std::endl;
+    return success >= min_success;
+}
+
+bool test_cluster_and_reconstruct(int strands, int copies, double rate, double min_success) {
+    std::vector<std::string> originals, reads;
+    for (int s = 0; s < strands; s++) {
+        originals.push_back(random_strand(STRAND_LEN));
+        for (int c = 0; c < copies; c++)
+            reads.push_back(noisy_copy(originals.back(), rate));
+    }
+    std::shuffle(reads.begin(), reads.end(), generator);
+    std::vector<std::string_view> views(reads.begin(), reads.end());
+
+    auto clusters = cluster_reads(views, 12, thread_workspace());
+    ThreadPool pool;
+    auto results = reconstruct_clusters(views, clusters, STRAND_LEN, pool);
+
+    std::sort(originals.begin(), originals.end());
+    int recovered = 0;
+    for (const auto& r : results)
+        recovered += std::binary_search(originals.begin(), originals.end(), r);
+    double success = static_cast<double>(recovered) / strands;
+    std::cout << "cluster_and_reconstruct strands=" << strands << " clusters=" << clusters.size()
+              << ": " << success << std::endl;
+    return success >= min_success;
+}
+
+template <typename Func>
+void run_test(const std::string& test, const Func& func) {
+    bool passed = func();
+    std::cout << test << (passed ? " successful!" : " failed :(") << std::endl;
+}
+
+int main() {
+    run_test("noiseless", [] { return test_reconstruct(1, 0.0, 20, 1.0); });
+    run_test("indel_5x", [] { return test_reconstruct(5, 0.02, 200, 0.9); });
+    run_test("indel_10x", [] { return test_reconstruct(10, 0.03, 200, 0.9); });
+    run_test("cluster", [] { return test_cluster_and_reconstruct(2000, 8, 0.02, 0.9); });
+    return 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file test_dir.hpp
+ * @brief Scratch directory for tests that write files.
+ */
+#ifndef TEST_DIR_HPP
+#define TEST_DIR_HPP
+
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+/**
+ * @brief Moves a test into a fresh directory under the system temporary directory,
+ * and removes it with everything the test wrote when the test ends.
+ */
+class TestDir {
+public:
+    /**
+     * @brief Create the directory and make it the working directory.
+     * @param name Name of the test; the process id is added so runs do not collide.
+     */
+    explicit TestDir(const std::string& name)
+        : previous(std::filesystem::current_path()),
+          path(std::filesystem::temp_directory_path() / (name + "." + std::to_string(getpid()))) {
+        std::filesystem::create_directories(path);
+        std::filesystem::current_path(path);
+    }
+
+    /**
+     * @brief Go back to the previous working directory and remove the scratch directory.
+     */
+    ~TestDir() {
+        std::error_code error;
+        std::filesystem::current_path(previous, error);
+        std::filesystem::remove_all(path, error);
+    }
+
+    TestDir(const TestDir&) = delete;
+    TestDir& operator=(const TestDir&) = delete;
+
+private:
+    std::filesystem::path previous; ///< Working directory before the test.
+    std::filesystem::path path;     ///< The scratch directory.
+};
+
+#endif // TEST_DIR_HPP
@@ -0,0 +1,394 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <iostream>
+#include "../utils/myRS/myRSmodule.cpp"
+
+std::mt19937 generator(12345);
+
+// Count heap allocations so the decoder can be checked to make none
+std::atomic<size_t> allocations{0};
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Every table product must match shift-and-add multiplication
+template <typename T>
+bool test_mult(unsigned int power) {
+    GaloisField<T> gf(power);
+    std::uniform_int_distribution<unsigned int> element(0, gf.size() - 1);
+    // Small fields are checked exhaustively, large ones on random pairs
+    bool exhaustive = power <= 8;
+    unsigned int rows = exhaustive ? gf.size() : 100000;
+    for (unsigned int a = 0; a < rows; ++a) {
+        T x = static_cast<T>(exhaustive ? a : element(generator));
+        for (unsigned int j = 0; j < (exhaustive ? gf.size() : 1u); ++j) {
+            T y = static_cast<T>(exhaustive ? j : element(generator));
+            if (gf.mult(x, y) != gf.multNoLUT(x, y))
+                return false;
+            if (y != 0 && gf.mult(gf.div(x, y), y) != x)
+                return false;
+            if (x != 0 && (gf.mult(x, gf.inv(x)) != 1 || gf.mult(gf.sqrt(x), gf.sqrt(x)) != x))
+                return false;
+        }
+    }
+    return true;
+}
+
+// The tables are generated at compile time and shared by every field of the same power
+static_assert(gf_tables::tables<8>.pow[8] == 0x1d && gf_tables::tables<8>.log[2] == 1);
+
+bool test_shared_tables() {
+    GaloisField<uint8_t> a(8);
+    GaloisField<uint16_t> b(8);
+    ReedSolomon<uint8_t> rs(8);
+    return a.powTable == b.powTable && a.logTable == rs.gf.logTable;
+}
+
+// The region kernels must agree with element-wise multiplication for every constant
+bool test_region(gf256::Kernel kernel) {
+    GaloisField<uint8_t> gf(8);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (size_t n : {0, 1, 15, 16, 31, 32, 33, 100, 1027}) {
+        std::vector<uint8_t> src(n), dst(n), expected(n);
+        for (auto& b : src)
+            b = static_cast<uint8_t>(byte(generator));
+        for (unsigned int c = 0; c < 256; ++c) {
+            for (auto& b : dst)
+                b = static_cast<uint8_t>(byte(generator));
+            for (size_t i = 0; i < n; ++i)
+                expected[i] = dst[i] ^ gf.mult(static_cast<uint8_t>(c), src[i]);
+            std::vector<uint8_t> table(256);
+            for (unsigned int x = 0; x < 256; ++x)
+                table[x] = gf.mult(static_cast<uint8_t>(c), static_cast<uint8_t>(x));
+            gf256::mul_region(dst.data(), src.data(), table.data(), n, true, kernel);
+            if (dst != expected)
+                return false;
+            gf256::mul_region(dst.data(), src.data(), table.data(), n, false, kernel);
+            for (size_t i = 0; i < n; ++i)
+                if (dst[i] != gf.mult(static_cast<uint8_t>(c), src[i]))
+                    return false;
+        }
+    }
+    return true;
+}
+
+// A systematic codeword keeps the message, has roots at alpha^0 .. alpha^(nsym-1),
+// and its parity matches long division by the generator
+template <typename T>
+bool test_encode(unsigned int power, size_t length, int nsym) {
+    ReedSolomon<T> rs(power);
+    std::uniform_int_distribution<unsigned int> element(0, rs.gf.size() - 1);
+    for (int trial = 0; trial < 20; ++trial) {
+        std::vector<T> data(length);
+        for (auto& d : data)
+            d = static_cast<T>(trial == 0 ? 0 : element(generator));
+        std::vector<T> codeword(data);
+        if (!rs.encode(codeword, nsym) || codeword.size() != length + nsym)
+            return false;
+        if (!std::equal(data.begin(), data.end(), codeword.begin()))
+            return false;
+        Poly<T> poly(codeword.begin(), codeword.end());
+        for (int i = 0; i < nsym; ++i)
+            if (poly.Eval(rs.gf.powTable[i], rs.gf) != 0)
+                return false;
+
+        Poly<T> msg(data.begin(), data.end()), quotient, remainder;
+        msg.Pad(0, nsym);
+        Poly_Div(quotient, remainder, msg, rs.encoder(nsym).polynomial(), rs.gf);
+        if (!std::equal(remainder.coef.begin(), remainder.coef.end(), codeword.begin() + length))
+            return false;
+    }
+    // Encoders are built once per nsym
+    return &rs.encoder(nsym) == &rs.encoder(nsym);
+}
+
+// Column-wise parity must match encoding each column on its own
+bool test_parity_columns(size_t rows, size_t width, int nsym) {
+    ReedSolomon<uint8_t> rs(8);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> data(rows * width), parity(nsym * width);
+    for (auto& d : data)
+        d = static_cast<uint8_t>(byte(generator));
+    rs.encoder(nsym).parity_columns(data.data(), rows, width, parity.data());
+
+    for (size_t w = 0; w < width; ++w) {
+        std::vector<uint8_t> column;
+        for (size_t r = 0; r < rows; ++r)
+            column.push_back(data[r * width + w]);
+        rs.encode(column, nsym);
+        for (int j = 0; j < nsym; ++j)
+            if (column[rows + j] != parity[j * width + w])
+                return false;
+    }
+    return true;
+}
+
+// One-pass and column-wise syndromes must match evaluating the codeword at each root
+template <typename T>
+bool test_syndromes(unsigned int power, size_t length, int nsym, size_t width) {
+    ReedSolomon<T> rs(power);
+    std::uniform_int_distribution<unsigned int> element(0, rs.gf.size() - 1);
+    const size_t n = length + nsym;
+    std::vector<T> matrix(n * width), columns(nsym * width);
+    for (auto& m : matrix)
+        m = static_cast<T>(element(generator));
+    bool clean = rs.syndromes_columns(matrix.data(), n, width, columns.data(), nsym);
+    if (clean)
+        return false;
+
+    for (size_t w = 0; w < width; ++w) {
+        std::vector<T> codeword(n), synd(nsym);
+        for (size_t r = 0; r < n; ++r)
+            codeword[r] = matrix[r * width + w];
+        rs.syndromes(codeword, synd);
+        Poly<T> poly(codeword.begin(), codeword.end());
+        for (int i = 0; i < nsym; ++i)
+            if (synd[i] != poly.Eval(rs.gf.powTable[i], rs.gf) || synd[i] != columns[i * width + w])
+                return false;
+
+        // An encoded codeword is clean
+        codeword.resize(length);
+        rs.encode(codeword, nsym);
+        if (!rs.syndromes(codeword, synd))
+            return false;
+    }
+    return true;
+}
+
+// Chien search must find exactly the roots a locator was built from
+template <typename T>
+bool test_chien(unsigned int power, int n, int degree) {
+    GaloisField<T> gf(power);
+    for (int trial = 0; trial < 20; ++trial) {
+        std::vector<unsigned int> exponents(n);
+        for (int i = 0; i < n; ++i)
+            exponents[i] = i;
+        std::shuffle(exponents.begin(), exponents.end(), generator);
+        exponents.resize(degree);
+
+        // Product of (x - alpha^e), scaled so the constant term is not 1
+        Poly<T> poly(1, 3), factor(2, 1);
+        for (unsigned int e : exponents) {
+            factor[1] = gf.powTable[e];
+            poly.Mult(factor, gf);
+        }
+
+        std::vector<unsigned int> roots;
+        Poly_ChienSearch(roots, poly, n, gf);
+        std::sort(exponents.begin(), exponents.end());
+        if (roots != exponents)
+            return false;
+    }
+    return true;
+}
+
+// Corrupt a codeword with errors and erasures within the 2e + f <= nsym bound and decode it
+template <typename T>
+bool test_decode(unsigned int power, size_t length, int nsym, int errors, int erasures) {
+    ReedSolomon<T> rs(power);
+    std::uniform_int_distribution<unsigned int> element(1, rs.gf.size() - 1);
+    const size_t n = length + nsym;
+    for (int trial = 0; trial < 50; ++trial) {
+        std::vector<T> codeword(length);
+        for (auto& d : codeword)
+            d = static_cast<T>(element(generator));
+        rs.encode(codeword, nsym);
+        std::vector<T> received(codeword);
+
+        std::vector<unsigned int> positions(n);
+        for (size_t i = 0; i < n; ++i)
+            positions[i] = static_cast<unsigned int>(i);
+        std::shuffle(positions.begin(), positions.end(), generator);
+        std::vector<unsigned int> erasePos(positions.begin(), positions.begin() + erasures);
+        for (int i = 0; i < erasures + errors; ++i)
+            received[positions[i]] ^= static_cast<T>(element(generator));
+
+        std::vector<T> whole(n), message(length);
+        if (!rs.decode(whole.data(), message.data(), received.data(), length, nsym, erasePos, false))
+            return false;
+        if (whole != codeword || !std::equal(message.begin(), message.end(), codeword.begin()))
+            return false;
+    }
+    return true;
+}
+
+// Decoding damaged codewords in place must not touch the heap
+bool test_decode_allocations(int nsym, int errors, int erasures) {
+    ReedSolomon<uint8_t> rs(8);
+    std::uniform_int_distribution<unsigned int> element(1, 255);
+    const size_t length = 255 - 1 - nsym, n = length + nsym;
+    std::vector<uint8_t> codeword(length);
+    for (auto& d : codeword)
+        d = static_cast<uint8_t>(element(generator));
+    rs.encode(codeword, nsym);
+
+    std::vector<uint8_t> received(n);
+    std::vector<unsigned int> positions(n);
+    for (size_t i = 0; i < n; ++i)
+        positions[i] = static_cast<unsigned int>(i);
+    for (int trial = 0; trial < 100; ++trial) {
+        std::shuffle(positions.begin(), positions.end(), generator);
+        received = codeword;
+        for (int i = 0; i < erasures + errors; ++i)
+            received[positions[i]] ^= static_cast<uint8_t>(element(generator));
+
+        size_t before = allocations;
+        bool ok = rs.decode(received.data(), nullptr, received.data(), length, nsym,
+                            std::span<const unsigned int>(positions.data(), erasures), false);
+        if (!ok || allocations != before || received != codeword)
+            return false;
+    }
+    return true;
+}
+
+// Batches report each codeword's outcome and the number of symbols it took to fix
+bool test_batch(size_t count) {
+    ReedSolomon<uint8_t> rs(8);
+    ThreadPool pool(4);
+    const int nsym = 16;
+    const size_t length = 100, n = length + nsym;
+    std::uniform_int_distribution<unsigned int> element(1, 255);
+
+    std::vector<uint8_t> symbols(count * n);
+    for (auto& s : symbols)
+        s = static_cast<uint8_t>(element(generator));
+    std::vector<std::span<uint8_t>> codewords;
+    for (size_t i = 0; i < count; ++i)
+        codewords.emplace_back(symbols.data() + i * n, n);
+    if (!rs.encode_batch(codewords, nsym, pool))
+        return false;
+    const std::vector<uint8_t> original(symbols);
+
+    // Codeword i gets i % 4 errors and i % 3 erasures; every seventh is beyond repair
+    std::vector<std::vector<unsigned int>> positions(count);
+    std::vector<std::span<const unsigned int>> erasures(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t errors = i % 7 == 6 ? nsym : i % 4;
+        for (size_t e = 0; e < i % 3; ++e)
+            positions[i].push_back(static_cast<unsigned int>(2 * e));
+        erasures[i] = positions[i];
+        for (size_t e = 0; e < i % 3 + errors; ++e)
+            codewords[i][2 * e] ^= 0x5a;
+    }
+
+    std::vector<DecodeStatus> status = rs.decode_batch(codewords, nsym, erasures, pool);
+    for (size_t i = 0; i < count; ++i) {
+        bool repaired = std::equal(codewords[i].begin(), codewords[i].end(), original.begin() + i * n);
+        if (i % 7 == 6) {
+            if (status[i].ok && !repaired)
+                return false;
+        } else if (!status[i].ok || !repaired || status[i].corrected != i % 3 + i % 4) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The erasure-only decoder must rebuild up to nsym erased symbols
+template <typename T>
+bool test_erasures(unsigned int power, size_t length, int nsym, int erasures) {
+    ReedSolomon<T> rs(power);
+    std::uniform_int_distribution<unsigned int> element(0, rs.gf.size() - 1);
+    const size_t n = length + nsym;
+    for (int trial = 0; trial < 50; ++trial) {
+        std::vector<T> codeword(length);
+        for (auto& d : codeword)
+            d = static_cast<T>(element(generator));
+        rs.encode(codeword, nsym);
+
+        std::vector<unsigned int> positions(n);
+        for (size_t i = 0; i < n; ++i)
+            positions[i] = static_cast<unsigned int>(i);
+        std::shuffle(positions.begin(), positions.end(), generator);
+        positions.resize(erasures);
+
+        std::vector<T> received(codeword);
+        for (unsigned int p : positions)
+            received[p] = static_cast<T>(element(generator));
+        if (!rs.decode_erasures(received, nsym, positions) || received != codeword)
+            return false;
+    }
+    // Too many erasures, or the same one twice, are refused
+    std::vector<T> codeword(n);
+    std::vector<unsigned int> twice{1, 1};
+    std::vector<unsigned int> many(nsym + 1);
+    for (int i = 0; i <= nsym; ++i)
+        many[i] = i;
+    return !rs.decode_erasures(codeword, nsym, twice) && !rs.decode_erasures(codeword, nsym, many);
+}
+
+int main() {
+    std::cout << "Kernel: " << static_cast<int>(gf256::best_kernel()) << std::endl;
+
+    bool ok = true;
+    auto check = [&ok](const char* name, bool result) {
+        std::cout << name << ": " << (result ? "OK" : "FAILED") << std::endl;
+        ok &= result;
+    };
+
+    check("GF(2^2) mult", test_mult<uint8_t>(2));
+    check("GF(2^4) mult", test_mult<uint8_t>(4));
+    check("GF(2^8) mult", test_mult<uint8_t>(8));
+    check("GF(2^8) mult (16-bit)", test_mult<uint16_t>(8));
+    check("GF(2^12) mult", test_mult<uint16_t>(12));
+    check("GF(2^16) mult", test_mult<uint16_t>(16));
+
+    check("Shared tables", test_shared_tables());
+
+    check("Scalar region", test_region(gf256::Kernel::Scalar));
+    if (gf256::best_kernel() >= gf256::Kernel::Ssse3)
+        check("SSSE3 region", test_region(gf256::Kernel::Ssse3));
+    if (gf256::best_kernel() >= gf256::Kernel::Avx2)
+        check("AVX2 region", test_region(gf256::Kernel::Avx2));
+
+    check("RS(255) encode", test_encode<uint8_t>(8, 223, 32));
+    check("RS(255) short encode", test_encode<uint8_t>(8, 10, 6));
+    check("RS(15) encode", test_encode<uint8_t>(4, 9, 4));
+    check("RS(4095) encode", test_encode<uint16_t>(12, 300, 10));
+    check("RS(65535) encode", test_encode<uint16_t>(16, 1000, 16));
+
+    check("RS(255) column parity", test_parity_columns(223, 100, 32));
+    check("RS(255) short column parity", test_parity_columns(3, 7, 5));
+
+    check("RS(255) syndromes", test_syndromes<uint8_t>(8, 223, 32, 40));
+    check("RS(15) syndromes", test_syndromes<uint8_t>(4, 9, 4, 17));
+    check("RS(4095) syndromes", test_syndromes<uint16_t>(12, 300, 20, 5));
+
+    check("GF(2^8) Chien search, 1 root", test_chien<uint8_t>(8, 255, 1));
+    check("GF(2^8) Chien search, 16 roots", test_chien<uint8_t>(8, 255, 16));
+    check("GF(2^4) Chien search, 7 roots", test_chien<uint8_t>(4, 15, 7));
+    check("GF(2^16) Chien search, 8 roots", test_chien<uint16_t>(16, 65535, 8));
+
+    check("RS(255) erasures, 1", test_erasures<uint8_t>(8, 223, 32, 1));
+    check("RS(255) erasures, 32", test_erasures<uint8_t>(8, 223, 32, 32));
+    check("RS(15) erasures, 4", test_erasures<uint8_t>(4, 11, 4, 4));
+    check("RS(65535) erasures, 300", test_erasures<uint16_t>(16, 2000, 300, 300));
+
+    check("RS(255) decode, clean", test_decode<uint8_t>(8, 223, 32, 0, 0));
+    check("RS(255) decode, 16 errors", test_decode<uint8_t>(8, 223, 32, 16, 0));
+    check("RS(255) decode, 32 erasures", test_decode<uint8_t>(8, 223, 32, 0, 32));
+    check("RS(255) decode, 10 errors + 12 erasures", test_decode<uint8_t>(8, 223, 32, 10, 12));
+    check("RS(15) decode, 2 errors", test_decode<uint8_t>(4, 11, 4, 2, 0));
+    check("RS(4095) decode, 5 errors + 6 erasures", test_decode<uint16_t>(12, 200, 16, 5, 6));
+    check("RS(65535) decode, 4 errors + 8 erasures", test_decode<uint16_t>(16, 1000, 16, 4, 8));
+    check("RS(255) decode, 64 parity, 20 errors + 20 erasures", test_decode<uint8_t>(8, 180, 64, 20, 20));
+    check("RS(65535) decode, 300 parity, 100 errors + 90 erasures", test_decode<uint16_t>(16, 1000, 300, 100, 90));
+
+    check("RS(255) batch, 1 codeword", test_batch(1));
+    check("RS(255) batch, 5000 codewords", test_batch(5000));
+
+    check("RS(255) decode allocations, 16 errors", test_decode_allocations(32, 16, 0));
+    check("RS(255) decode allocations, 10 errors + 12 erasures", test_decode_allocations(32, 10, 12));
+    check("RS(255) decode allocations, 64 parity", test_decode_allocations(64, 20, 20));
+
+    return ok ? 0 : 1;
+}
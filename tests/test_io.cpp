@@ -1,11 +1,60 @@
 #include "io.hpp"
+#include "test_dir.hpp"
 
 // Check if zlib is available
 #ifdef ZLIB_FOUND
 #include <zlib.h>
+
+// Write one BGZF block holding data, with a damaged CRC if asked; isize replaces the real size
+// in the trailer if not 0
+void write_bgzf_block(std::ofstream& out, const std::string& data, bool bad_crc = false, std::uint32_t isize = 0) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::vector<char> deflated(deflateBound(&stream, data.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(deflated.data());
+    stream.avail_out = static_cast<uInt>(deflated.size());
+    deflate(&stream, Z_FINISH);
+    deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    auto put_le = [&](std::uint32_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i)
+            out.put(static_cast<char>(v >> (8 * i)));
+    };
+    const char header[] = {'\x1f', '\x8b', 8, 4, 0, 0, 0, 0, 0, '\xff', 6, 0, 'B', 'C', 2, 0};
+    out.write(header, sizeof(header));
+    put_le(static_cast<std::uint32_t>(sizeof(header) + 2 + deflated.size() + 8 - 1), 2);
+    out.write(deflated.data(), deflated.size());
+    put_le(crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size())) ^ bad_crc, 4);
+    put_le(isize ? isize : static_cast<std::uint32_t>(data.size()), 4);
+}
+
+// Write data as BGZF blocks of 60000 bytes and an empty end block, damaging the second
+// block's trailer as asked, and read it back
+std::string bgzf_round_trip(const char* name, const std::string& data, bool bad_crc = false, std::uint32_t bad_isize = 0) {
+    {
+        std::ofstream out(name, std::ios::binary);
+        for (std::size_t at = 0; at < data.size(); at += 60000) {
+            const bool damaged = at == 60000;
+            write_bgzf_block(out, data.substr(at, 60000), damaged && bad_crc, damaged ? bad_isize : 0);
+        }
+        write_bgzf_block(out, "");
+    }
+    BgzfSource source(name, 2);
+    std::string read;
+    std::vector<char> buffer(1 << 14);
+    for (std::size_t n; (n = source.read(buffer.data(), buffer.size())) > 0;)
+        read.append(buffer.data(), n);
+    return read;
+}
 #endif
 
 int main() {
+    // Everything the tests write goes to a scratch directory that is removed at the end
+    TestDir dir("test_io");
+    bool ok = true;
     const char* regular_file = "regular.txt";
     const char* gzipped_file = "gzipped.gz";
 
@@ -26,6 +75,50 @@ int main() {
 
     std::cout << "Processing regular file:\n";
 
+    // Formats are told apart by their magic bytes, whatever the file is called
+    auto format_of = [](const char* name) {
+        const Decompressor* detected = detect_compression(name);
+        return std::string(detected ? detected->name : "raw");
+    };
+    bool detected = format_of(regular_file) == "raw";
+    #ifdef HAVE_LZMA
+    const char* xz_file = "compressed.dat";
+    {
+        const std::string text = "This is an xz file.";
+        std::vector<std::uint8_t> xz(text.size() + 128);
+        std::size_t xz_size = 0;
+        lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr, reinterpret_cast<const std::uint8_t*>(text.data()), text.size(),
+                                xz.data(), &xz_size, xz.size());
+        std::ofstream(xz_file, std::ios::binary).write(reinterpret_cast<const char*>(xz.data()), xz_size);
+        std::unique_ptr<ByteSource> source = open_source(xz_file);
+        char buffer[64];
+        detected &= format_of(xz_file) == "xz" && source && std::string(buffer, source->read_full(buffer, sizeof(buffer))) == text;
+    }
+    #endif
+    #ifdef HAVE_ZSTD
+    const char* zstd_file = "compressed.bin";
+    {
+        // Two frames, decoded back to back
+        const std::string text = "This is a zstd file.";
+        std::ofstream out(zstd_file, std::ios::binary);
+        for (int frame = 0; frame < 2; ++frame) {
+            std::vector<char> zstd(ZSTD_compressBound(text.size()));
+            const std::size_t zstd_size = ZSTD_compress(zstd.data(), zstd.size(), text.data(), text.size(), 3);
+            out.write(zstd.data(), static_cast<std::streamsize>(ZSTD_isError(zstd_size) ? 0 : zstd_size));
+        }
+        out.close();
+        std::unique_ptr<ByteSource> source = open_source(zstd_file);
+        char buffer[64];
+        detected &= format_of(zstd_file) == "zstd" && source
+                    && std::string(buffer, source->read_full(buffer, sizeof(buffer))) == text + text;
+    }
+    #endif
+    #ifdef ZLIB_FOUND
+    detected &= format_of(gzipped_file) == "gzip";
+    #endif
+    std::cout << "\nFormat detection " << (detected ? "successful." : "failed.") << std::endl;
+    ok &= detected;
+
     #ifdef ZLIB_FOUND
     std::cout << "\nProcessing gzipped file:\n";
     process_file(gzipped_file);
@@ -33,6 +126,81 @@ int main() {
     std::cout << "\nZlib not available. Skipped processing gzipped file.\n";
     #endif
 
-    return 0;
+    // Write past several buffers so writev gathers them, with a size that is not aligned
+    std::cout << "\nWriting through OutputWriter:\n";
+    const char* written_file = "written.txt";
+    const std::string line = "ACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGT\n";
+    const std::size_t lines = 100000;
+    for (bool direct : { false, true }) {
+        OutputWriter writer(written_file, line.size() * lines, direct, 1 << 16, 4);
+        for (std::size_t i = 0; i < lines; ++i)
+            writer.write(line);
+        bool closed = writer.close();
+
+        std::ifstream check(written_file, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(check)), std::istreambuf_iterator<char>());
+        bool same = closed && content.size() == line.size() * lines
+                    && content.compare(content.size() - line.size(), line.size(), line) == 0;
+        std::cout << (direct ? "O_DIRECT" : "buffered") << " write of " << content.size() << " bytes "
+                  << (same ? "successful." : "failed.") << std::endl;
+    }
+
+    // Async wrappers: a thread reads ahead or writes behind through a ring of small blocks,
+    // and the bytes arrive whole and in order whatever the sizes of the calls
+    std::cout << "\nReading and writing through async wrappers:\n";
+    const char* async_file = "async.bin";
+    std::string payload;
+    for (std::size_t i = 0; payload.size() < 300000; ++i)
+        payload += std::to_string(i * 7919 % 1000003) + ',';
+    {
+        AsyncSink sink(std::make_unique<OutputWriter>(async_file, payload.size()), 4096, 3);
+        for (std::size_t at = 0, n = 1; at < payload.size(); at += n, n = n % 9000 + 777)
+            sink.write(payload.data() + at, std::min(n, payload.size() - at));
+        ok &= sink.close();
+    }
+    std::string async_read;
+    {
+        AsyncSource source(std::make_unique<FileSource>(async_file), 4096, 3);
+        std::vector<char> buffer(1000);
+        for (std::size_t n; (n = source.read(buffer.data(), buffer.size())) > 0;)
+            async_read.append(buffer.data(), n);
+    }
+    bool async_same = async_read == payload;
+
+    // The same through the factories the codec uses, io_uring included when it is built in
+    {
+        std::unique_ptr<ByteSink> sink = open_async_sink(async_file, payload.size());
+        for (std::size_t at = 0, n = 1; at < payload.size(); at += n, n = n % 9000 + 777)
+            sink->write(payload.data() + at, std::min(n, payload.size() - at));
+        ok &= sink->close();
+    }
+    async_read.clear();
+    {
+        std::unique_ptr<ByteSource> source = open_file_source(async_file);
+        std::vector<char> buffer(1000);
+        for (std::size_t n; (n = source->read(buffer.data(), buffer.size())) > 0;)
+            async_read.append(buffer.data(), n);
+    }
+    async_same &= async_read == payload;
+    std::cout << "Async round trip of " << async_read.size() << " bytes " << (async_same ? "successful." : "failed.") << std::endl;
+    ok &= async_same;
+
+    #ifdef ZLIB_FOUND
+    // BGZF: blocks inflated in parallel come back in order; a damaged trailer stops the read
+    std::cout << "\nReading BGZF blocks:\n";
+    const char* bgzf_file = "blocked.gz";
+    std::string data;
+    for (std::size_t i = 0; data.size() < 250000; ++i)
+        data += std::to_string(i * i) + (i % 7 ? " " : "\n");
+    const bool round_trip = bgzf_round_trip(bgzf_file, data) == data && is_bgzf(bgzf_file);
+    const bool bad_crc = bgzf_round_trip(bgzf_file, data, true).size() < data.size();
+    const bool too_large = bgzf_round_trip(bgzf_file, data, false, 0xfffffff0).size() < data.size();
+    std::cout << "Multi-block round trip " << (round_trip ? "successful." : "failed.") << std::endl;
+    std::cout << "Block with a bad CRC " << (bad_crc ? "rejected." : "accepted.") << std::endl;
+    std::cout << "Block claiming more than 64 KiB " << (too_large ? "rejected." : "accepted.") << std::endl;
+    ok &= round_trip && bad_crc && too_large;
+    #endif
+
+    return ok ? 0 : 1;
 }
 
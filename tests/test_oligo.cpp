@@ -1,6 +1,6 @@
 #include <random>
 #include <iostream>
-#include "../src/oligo.cpp"
+#include "oligo.hpp"
 #include "utils.hpp"
 
 const int iternum = 5;
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include "../src/codec.cpp"
+#include "test_dir.hpp"
+
+std::mt19937 generator(2026);
+
+std::string read_file(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// One producer, one consumer: every item arrives once, in order, through a tiny queue
+bool test_spsc() {
+    SpscQueue<size_t> queue(4);
+    const size_t count = 100000;
+    std::thread producer([&] {
+        for (size_t i = 0; i < count; ++i)
+            queue.push(i);
+        queue.close();
+    });
+    bool in_order = true;
+    size_t expected = 0;
+    for (size_t item; queue.pop(item); ++expected)
+        in_order &= item == expected;
+    producer.join();
+
+    bool passed = in_order && expected == count && !queue.push(0);
+    std::cout << "Test SPSC queue: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// Several producers and consumers: every item arrives exactly once
+bool test_mpmc() {
+    MpmcQueue<size_t> queue(8);
+    const size_t producers = 4, consumers = 4, per_producer = 50000;
+    std::atomic<size_t> running{producers};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < per_producer; ++i)
+                queue.push(p * per_producer + i);
+            if (running.fetch_sub(1) == 1)
+                queue.close();
+        });
+    }
+    std::vector<std::vector<size_t>> seen(consumers);
+    for (size_t c = 0; c < consumers; ++c)
+        threads.emplace_back([&, c] {
+            for (size_t item; queue.pop(item);)
+                seen[c].push_back(item);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    std::vector<size_t> all;
+    for (const auto& items : seen)
+        all.insert(all.end(), items.begin(), items.end());
+    std::sort(all.begin(), all.end());
+    std::vector<size_t> expected(producers * per_producer);
+    std::iota(expected.begin(), expected.end(), 0);
+    bool passed = all == expected;
+    std::cout << "Test MPMC queue: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// A slow last stage blocks the fast first one instead of letting the queue grow
+bool test_backpressure() {
+    Pipeline pipeline;
+    auto& queue = pipeline.queue<SpscQueue<int>>(2);
+    std::atomic<size_t> max_ahead{0};
+    std::atomic<size_t> produced{0}, consumed{0};
+    pipeline.add_stage("fast", 1, [&](Pipeline::Stage& stage) {
+        for (int i = 0; i < 20; ++i) {
+            if (!stage.push(queue, i))
+                return;
+            produced++;
+            max_ahead = std::max(max_ahead.load(), produced.load() - consumed.load());
+            stage.processed(1);
+        }
+    }, [&] { queue.close(); });
+    pipeline.add_stage("slow", 1, [&](Pipeline::Stage& stage) {
+        for (int item; stage.pop(queue, item);) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            consumed++;
+            stage.processed(1);
+        }
+    });
+    bool ok = pipeline.run();
+    std::vector<StageStats> stats = pipeline.stats();
+
+    // The queue holds 2 and the consumer 1, so the producer is never more than 3 ahead
+    bool passed = ok && stats.size() == 2 && stats[0].items == 20 && stats[1].items == 20 && max_ahead <= 3 &&
+                  stats[0].blocked > stats[0].busy && stats[1].busy > stats[1].starved;
+    std::cout << "Test backpressure: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// A failing stage stops the others, however full their queues are
+bool test_cancel() {
+    Pipeline pipeline;
+    auto& queue = pipeline.queue<MpmcQueue<int>>(2);
+    pipeline.add_stage("endless", 2, [&](Pipeline::Stage& stage) {
+        for (int i = 0; stage.push(queue, i); ++i) {}
+    }, [&] { queue.close(); });
+    pipeline.add_stage("failing", 1, [&](Pipeline::Stage& stage) {
+        int item;
+        for (int i = 0; i < 10 && stage.pop(queue, item); ++i) {}
+        stage.fail();
+    });
+    bool passed = !pipeline.run();
+    std::cout << "Test cancel: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// The pipelined encode writes the strands of encode() and write_duplex(), which decode back
+bool test_encode(const std::string& name, size_t size, size_t inner, size_t parity_rows) {
+    std::string content(size, '\0');
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& c : content)
+        c = static_cast<char>(byte(generator));
+    std::ofstream(name, std::ios::binary) << content;
+
+    std::vector<std::string> expected;
+    {
+        Codec codec(name);
+        codec.set_outer_code(OUTER_DATA_ROWS, parity_rows);
+        codec.set_inner_code(inner);
+        codec.encode();
+        expected = codec.get_duplex_vec();
+    }
+    std::vector<StageStats> stats;
+    bool ok;
+    {
+        Codec codec(name);
+        codec.set_outer_code(OUTER_DATA_ROWS, parity_rows);
+        codec.set_inner_code(inner);
+        ok = codec.encode_pipelined(&stats);
+    }
+    std::string written = read_file(name + ".encode");
+    std::istringstream lines(written);
+    std::vector<std::string> strands;
+    for (std::string line; std::getline(lines, line);)
+        strands.push_back(line);
+    std::sort(expected.begin(), expected.end());
+    std::vector<std::string> sorted = strands;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Each stage saw every input byte
+    bool counted = !stats.empty();
+    for (const auto& stage : stats)
+        counted &= stage.bytes == size;
+
+    // Groups are written in order, whichever outer-code thread finished first
+    {
+        Codec codec(name);
+        codec.set_outer_code(OUTER_DATA_ROWS, parity_rows);
+        codec.set_inner_code(inner);
+        ok &= codec.encode_pipelined();
+    }
+    bool deterministic = read_file(name + ".encode") == written;
+
+    {
+        Codec codec(name + ".encode");
+        codec.set_outer_code(OUTER_DATA_ROWS, parity_rows);
+        codec.set_inner_code(inner);
+        codec.decode();
+    }
+    bool passed = ok && sorted == expected && counted && deterministic && read_file(name + ".encode.decode") == content;
+    std::cout << "Test pipelined encode " << name << ": " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+int main() {
+    // Everything the tests write goes to a scratch directory that is removed at the end
+    TestDir dir("test_pipeline");
+    bool ok = true;
+    ok &= test_spsc();
+    ok &= test_mpmc();
+    ok &= test_backpressure();
+    ok &= test_cancel();
+    ok &= test_encode("pipeline_small.bin", 8 * 100 + 3, 0, OUTER_PARITY_ROWS);
+    ok &= test_encode("pipeline_groups.bin", 8 * 50000 + 5, 0, OUTER_PARITY_ROWS);
+    ok &= test_encode("pipeline_inner.bin", 8 * 30000, 4, OUTER_PARITY_ROWS);
+    ok &= test_encode("pipeline_no_outer.bin", 8 * 2000, 0, 0);
+
+    // Fountain mode needs the whole file and is refused
+    std::ofstream("pipeline_fountain.bin", std::ios::binary) << std::string(64, 'x');
+    Codec fountain("pipeline_fountain.bin");
+    fountain.set_fountain();
+    bool refused = !fountain.encode_pipelined();
+    std::cout << "Test pipelined fountain refused: " << (refused ? "Passed" : "Failed") << std::endl;
+    ok &= refused;
+    return ok ? 0 : 1;
+}
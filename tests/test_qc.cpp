@@ -0,0 +1,87 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include "qc.hpp"
+#include "utils.hpp"
+
+std::mt19937 generator(2027);
+
+// Count A, C, G and T one byte at a time
+std::array<std::uint64_t, 4> scalar_counts(std::string_view seq) {
+    std::array<std::uint64_t, 4> counts{};
+    for (char c : seq) {
+        switch (c) {
+            case 'A': counts[0]++; break;
+            case 'C': counts[1]++; break;
+            case 'G': counts[2]++; break;
+            case 'T': counts[3]++; break;
+        }
+    }
+    return counts;
+}
+
+// The SIMD histogram matches the scalar count for every length and alignment, including
+// the tail past the last 16 bytes, bytes that are not bases, and runs long enough to
+// flush the byte counters
+bool test_count_nucleotides() {
+    const std::string alphabet = "ACGTACGTACGTNacgt-";
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::string buffer(100000 + 16, 'A');
+    for (auto& c : buffer)
+        c = alphabet[pick(generator)];
+
+    bool passed = true;
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t length : {0, 1, 7, 15, 16, 17, 31, 33, 100, 255, 4079, 4081, 100000}) {
+            std::string_view seq = std::string_view(buffer).substr(offset, length);
+            std::array<std::uint64_t, 4> counts{1, 2, 3, 4};
+            count_nucleotides(seq, counts);
+            std::array<std::uint64_t, 4> expected = scalar_counts(seq);
+            for (size_t b = 0; b < 4; ++b)
+                passed &= counts[b] == expected[b] + b + 1;  // added to, not overwritten
+        }
+    }
+
+    // A homopolymer longer than 255 * 16 bytes fills every byte counter
+    std::string run(5000, 'G');
+    std::array<std::uint64_t, 4> counts{};
+    count_nucleotides(run, counts);
+    passed &= counts[0] == 0 && counts[1] == 0 && counts[2] == run.size() && counts[3] == 0;
+
+    std::cout << "Test count_nucleotides: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// A view ends where it says, even when the run goes on in the string behind it
+bool test_homopolymer_view() {
+    const std::string reads = "ACGGGTTTTTTTT";
+    std::string_view first = std::string_view(reads).substr(0, 8);  // ACGGGTTT
+    bool passed = calculateMaxHomopolymerLen(first) == calculateMaxHomopolymerLen(std::string(first))
+                  && calculateMaxHomopolymerLen(first) == 3
+                  && calculateMaxHomopolymerLen(std::string_view(reads).substr(4)) == 8
+                  && calculateMaxHomopolymerLen(std::string_view()) == 0;
+    std::cout << "Test homopolymer length of a view: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+// Merged statistics are those of all the reads added to one
+bool test_merge() {
+    QCStats all, left, right;
+    const std::vector<std::string> reads = {"ACGTACGTGGCC", "AAAA", "GCGCNNGC", "TTTTTTTTTTTTTTTTTTTA"};
+    for (size_t i = 0; i < reads.size(); ++i) {
+        all.add(reads[i]);
+        (i % 2 ? right : left).add(reads[i]);
+    }
+    left.merge(right);
+    bool passed = left.reads() == all.reads() && left.gc_content() == all.gc_content() && all.reads() == reads.size();
+    std::cout << "Test QCStats merge: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+int main() {
+    bool ok = true;
+    ok &= test_count_nucleotides();
+    ok &= test_homopolymer_view();
+    ok &= test_merge();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <fstream>
+#include "records.hpp"
+#include "test_dir.hpp"
+
+// Read every record through a reader and join them as "seq/qual" lines.
+std::string read_all(const std::vector<std::string>& files, size_t batch_size, bool use_mmap) {
+    RecordReader reader(files, RecordFormat::Auto, batch_size, use_mmap);
+    std::string result;
+    std::vector<Record> batch;
+    while (reader.next_batch(batch))
+        for (const auto& record : batch)
+            result.append(record.seq).append("/").append(record.qual).append("\n");
+    return result;
+}
+
+bool test_format(const std::string& name, const std::string& content, const std::string& expected) {
+    std::ofstream(name, std::ios::binary) << content;
+
+    bool passed = true;
+    for (bool use_mmap : { true, false })
+        for (size_t batch_size : { 1, 2, 1000 })
+            passed &= (read_all({ name }, batch_size, use_mmap) == expected);
+
+    std::cout << "Test " << name << ": " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+bool test_lanes() {
+    std::ofstream("lane1.fastq", std::ios::binary) << "@r1\nACGT\n+\nIIII\n";
+    std::ofstream("lane2.fa", std::ios::binary) << ">r2\nTTTT\nGG\n";
+
+    bool passed = read_all({ "lane1.fastq", "lane2.fa" }, 16, true) == "ACGT/IIII\nTTTTGG/\n";
+    std::cout << "Test lanes: " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+bool test_large_stream() {
+    // Longer than the streaming buffer, so records straddle refills
+    std::string content, expected;
+    for (int i = 0; i < 100000; i++) {
+        std::string seq(20 + i % 50, "ACGT"[i % 4]);
+        content += "@read\n" + seq + "\n+\n" + std::string(seq.size(), 'I') + "\n";
+        expected += seq + "/" + std::string(seq.size(), 'I') + "\n";
+    }
+    return test_format("large.fastq", content, expected);
+}
+
+int main() {
+    // Everything the tests write goes to a scratch directory that is removed at the end
+    TestDir dir("test_records");
+    bool ok = true;
+    ok &= test_format("raw.txt", "ACGT\n\nTTGCA\r\nGG", "ACGT/\nTTGCA/\nGG/\n");
+    ok &= test_format("reads.fastq", "@r1\nACGT\n+\nIIII\n@r2\nTT\n+r2\n#I", "ACGT/IIII\nTT/#I\n");
+    ok &= test_format("reads.fa", ">r1 first\nACGT\nAC\r\n\n>r2\nTTT\n>r3\n", "ACGTAC/\nTTT/\n/\n");
+    ok &= test_lanes();
+    ok &= test_large_stream();
+    return ok ? 0 : 1;
+}
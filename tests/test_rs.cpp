@@ -1,19 +1,38 @@
 #include <iostream>
-#include "../src/oligo.cpp"
+#include <random>
+#include "strand.hpp"
 
-int main() {
-    // Example usage of the Oligo class
-    Oligo oligo1(10, 0b1101010101010101);  // Example oligo with 10 base pairs and data
-    Oligo oligo2(8, 0b1111000011110000);   // Another example oligo with 8 base pairs and data
+std::mt19937_64 generator(7);
 
-    // Test the encode function
-    std::cout << "Encoding oligo1:" << std::endl;
-    //oligo1.encode();
+// Substitute a base at each of the given positions of the index, data or parity oligo
+Oligo substitute(const Oligo& oligo, std::initializer_list<size_t> positions) {
+    uint64_t value = oligo.data();
+    for (size_t p : positions)
+        value ^= 1ULL << (2 * (oligo.bp() - 1 - p));
+    return Oligo(oligo.bp(), value);
+}
 
-    // Test the decode function
-    std::cout << "\nDecoding oligo2:" << std::endl;
-    //oligo2.decode();
+bool test_inner(const std::string& test, size_t nsym, std::initializer_list<size_t> index_subs,
+                std::initializer_list<size_t> data_subs, std::initializer_list<size_t> parity_subs, bool expect_recovery) {
+    const Oligo index(MAX_BP, generator()), data(MAX_BP, generator());
+    const Oligo parity = inner_encode(index, data, nsym);
 
-    return 0;
+    Oligo index_read = substitute(index, index_subs), data_read = substitute(data, data_subs);
+    bool ok = inner_decode(index_read, data_read, substitute(parity, parity_subs));
+    bool passed = (ok && index_read == index && data_read == data) == expect_recovery;
+    std::cout << "Test " << test << ": " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
 }
 
+int main() {
+    bool ok = true;
+    ok &= test_inner("clean", 4, {}, {}, {}, true);
+    ok &= test_inner("one data substitution", 4, {}, {5}, {}, true);
+    ok &= test_inner("index and data substitutions", 4, {0}, {31}, {}, true);
+    ok &= test_inner("parity substitution", 4, {}, {}, {2}, true);
+    ok &= test_inner("two bases in one byte", 2, {}, {8, 9}, {}, true);
+    ok &= test_inner("four substitutions, eight parity bytes", 8, {3}, {12, 20}, {30}, true);
+    // Three substituted bytes are past what four parity bytes can correct
+    ok &= test_inner("three substitutions, four parity bytes", 4, {1}, {10, 22}, {}, false);
+    return ok ? 0 : 1;
+}
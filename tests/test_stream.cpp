@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include "stream.hpp"
+
+std::mt19937 generator(2025);
+
+// Keeps every strand in memory
+class VectorSink : public StrandSink {
+public:
+    bool write(std::span<const std::string> batch) override {
+        strands.insert(strands.end(), batch.begin(), batch.end());
+        return true;
+    }
+    std::vector<std::string> strands;
+};
+
+// Writes the bytes at their offsets in a growing buffer
+class BufferSink : public BlockSink {
+public:
+    bool write(uint64_t offset, std::span<const std::byte> bytes) override {
+        if (offset + bytes.size() > buffer.size())
+            buffer.resize(offset + bytes.size());
+        std::memcpy(buffer.data() + offset, bytes.data(), bytes.size());
+        return true;
+    }
+    std::vector<std::byte> buffer;
+};
+
+// Encode in pieces of random size, lose and substitute strands, decode in batches and compare;
+// without the length, the decoder finds it from the strand of the partial last block
+bool test_stream(const std::string& test, size_t size, double loss, double substitution, StreamOptions options,
+                 bool give_length = true) {
+    std::vector<std::byte> content(size);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& b : content)
+        b = static_cast<std::byte>(byte(generator));
+
+    VectorSink strands;
+    Encoder encoder(strands, options);
+    std::uniform_int_distribution<size_t> piece(0, 100);
+    bool ok = true;
+    for (size_t at = 0; at < size;) {
+        size_t n = std::min(size - at, piece(generator));
+        ok &= encoder.push(std::span<const std::byte>(content).subspan(at, n));
+        at += n;
+    }
+    ok &= encoder.finish();
+    ok &= encoder.strands() == strands.strands.size();
+
+    std::vector<std::string> kept;
+    std::bernoulli_distribution drop(loss), substitute(substitution);
+    for (auto& strand : strands.strands) {
+        if (drop(generator))
+            continue;
+        if (substitute(generator)) {
+            char& base = strand[std::uniform_int_distribution<size_t>(0, strand.size() - 1)(generator)];
+            base = (base == 'A') ? 'C' : 'A';
+        }
+        kept.push_back(strand);
+    }
+    std::shuffle(kept.begin(), kept.end(), generator);
+
+    BufferSink bytes;
+    Decoder decoder(bytes, options);
+    if (give_length)
+        decoder.set_length(encoder.bytes());
+    std::vector<Record> batch;
+    for (size_t i = 0; i < kept.size(); ++i) {
+        batch.push_back({kept[i], {}});
+        if (batch.size() == 1000 || i + 1 == kept.size()) {
+            ok &= decoder.push(batch);
+            batch.clear();
+        }
+    }
+    ok &= decoder.finish();
+
+    bool passed = ok && bytes.buffer == content;
+    std::cout << "Test " << test << ": " << (passed ? "Passed" : "Failed") << std::endl;
+    return passed;
+}
+
+int main() {
+    bool ok = true;
+    ok &= test_stream("clean", 8 * 1000, 0.0, 0.0, {});
+    ok &= test_stream("partial last block", 8 * 1000 + 3, 0.0, 0.0, {});
+    ok &= test_stream("partial last block, length unknown", 8 * 1000 + 5, 0.02, 0.0, {}, false);
+    ok &= test_stream("partial last block, inner code", 8 * 1000 + 7, 0.0, 0.3, {223, 32, 4}, false);
+    ok &= test_stream("several groups, lossy", 8 * 40000 + 5, 0.05, 0.0, {});
+    ok &= test_stream("inner code, substituted", 8 * 20000, 0.02, 0.3, {223, 32, 4});
+    ok &= test_stream("no outer code", 8 * 500, 0.0, 0.0, {223, 0, 0});
+    ok &= test_stream("no outer code, partial last block", 8 * 500 + 6, 0.0, 0.0, {223, 0, 0}, false);
+
+    // Settings an RS code over GF(2^8) cannot have are refused
+    VectorSink strands;
+    Encoder invalid(strands, {250, 10, 0});
+    bool refused = !invalid.push(std::span<const std::byte>()) && !invalid.finish();
+    std::cout << "Test invalid settings: " << (refused ? "Passed" : "Failed") << std::endl;
+    ok &= refused;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <numeric>
+#include "thread_pool.hpp"
+
+// Every index of a parallel loop is visited exactly once
+bool test_parallel_for(ThreadPool& pool) {
+    std::vector<std::atomic<int>> visits(100003);
+    pool.parallel_for(visits.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            visits[i]++;
+    });
+    return std::all_of(visits.begin(), visits.end(), [](const auto& v) { return v == 1; });
+}
+
+// Tasks that run parallel loops of their own finish, even with every worker inside one
+bool test_nested(ThreadPool& pool) {
+    std::vector<std::future<size_t>> outer;
+    for (size_t t = 0; t < 4 * pool.size(); ++t) {
+        outer.push_back(pool.submit([&pool] {
+            std::atomic<size_t> sum{0};
+            pool.parallel_for(1000, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    sum += i;
+            });
+            return sum.load();
+        }));
+    }
+    bool ok = true;
+    for (auto& f : outer)
+        ok &= f.get() == 999 * 1000 / 2;
+    return ok;
+}
+
+// A task tree built on one worker's deque is spread over the others by stealing
+size_t fib(ThreadPool& pool, size_t n) {
+    if (n < 12)
+        return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    auto left = pool.submit([&pool, n] { return fib(pool, n - 1); });
+    size_t right = fib(pool, n - 2);
+    pool.wait(left);
+    return left.get() + right;
+}
+
+bool test_stealing(ThreadPool& pool) {
+    auto root = pool.submit([&pool] { return fib(pool, 24); });
+    bool ok = root.get() == 46368;
+    ThreadPoolStats stats = pool.stats();
+    std::cout << "  submitted " << stats.submitted << ", executed " << stats.executed << ", stolen " << stats.stolen
+              << ", max depth " << stats.max_depth << ", queued " << stats.queued << std::endl;
+    return ok && stats.queued == 0 && (pool.size() == 1 || stats.stolen > 0);
+}
+
+int main() {
+    bool ok = true;
+    ThreadPool pool(4);
+    ThreadPool pinned(2, true);
+    for (auto [name, result] : {std::pair{"parallel_for", test_parallel_for(pool)},
+                                {"parallel_for, pinned", test_parallel_for(pinned)},
+                                {"parallel_for, shared pool", test_parallel_for(ThreadPool::shared())},
+                                {"nested parallel_for", test_nested(pool)},
+                                {"work stealing", test_stealing(pool)}}) {
+        std::cout << "Test " << name << ": " << (result ? "Passed" : "Failed") << std::endl;
+        ok &= result;
+    }
+    return ok ? 0 : 1;
+}
@@ -11,6 +11,7 @@ void test_revcom(const std::vector<std::pair<std::string, std::string>>& test_ca
 void test_lev_distance(const std::vector<std::tuple<std::string, std::string, int>>& test_cases);
 void test_match_function(const std::vector<std::tuple<std::string, std::string, int, bool>>& test_cases);
 void test_find_function(const std::vector<std::tuple<std::string, std::string, int, int, int, bool>>& test_cases);
+void test_workspace_reuse(const std::vector<std::tuple<std::string, std::string, int>>& test_cases);
 
 int main()
 {
@@ -54,6 +55,7 @@ int main()
     test_lev_distance(lev_distance_test_cases);
     test_match_function(match_function_test_cases);
     test_find_function(find_function_test_cases);
+    test_workspace_reuse(lev_distance_test_cases);
 
     return 0;
 }
@@ -186,3 +188,35 @@ void test_find_function(const std::vector<std::tuple<std::string, std::string, i
     std::cout << "Total Find Function Tests Passed: " << testsPassed << " out of " << test_cases.size() << std::endl;
 }
 
+
+void test_workspace_reuse(const std::vector<std::tuple<std::string, std::string, int>>& test_cases) {
+    AlignmentWorkspace ws;
+    int testsPassed = 0;
+
+    // Warm up so the arena reaches its high-water mark
+    for (const auto& [str1, str2, expected] : test_cases)
+        Diff(str1, str2);
+    std::string diff;
+    for (const auto& [str1, str2, expected] : test_cases)
+        Diff(str1, str2, diff, ws);
+    ws.reset();
+    size_t capacity = ws.capacity();
+
+    for (size_t i = 0; i < test_cases.size(); ++i) {
+        const auto& [str1, str2, expected] = test_cases[i];
+
+        bool passed = levenshtein_distance(str1, str2, ws) == expected
+            && Diff(str1, str2, diff, ws) == expected
+            && diff == Diff(str1, str2).second
+            && ws.capacity() == capacity;
+
+        if (passed) {
+            std::cout << "Workspace Reuse Test " << (i + 1) << " Passed: " << diff << std::endl;
+            testsPassed++;
+        } else {
+            std::cerr << "Workspace Reuse Test " << (i + 1) << " Failed: capacity " << ws.capacity() << " != " << capacity << std::endl;
+        }
+    }
+
+    std::cout << "Total Workspace Reuse Tests Passed: " << testsPassed << " out of " << test_cases.size() << std::endl;
+}
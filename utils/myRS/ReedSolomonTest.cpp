@@ -18,11 +18,11 @@ using namespace std;
 void test()
 {
     int bits = 8, k = 16, nsym = 10;
-    vector<unsigned int> data1 = { 0x40, 0xd2, 0x75, 0x47, 0x76, 0x17, 0x32, 0x06, 0x27, 0x26, 0x96, 0xc6, 0xc6, 0x96, 0x70, 0xec };
-    Poly<unsigned int> msg(k, data1);
-    Poly<unsigned int> a(k + nsym, data1);
-    ReedSolomon<unsigned int> rs(bits);
-    rs.encode(a.coef, data1, k, nsym);
+    vector<uint16_t> data1 = { 0x40, 0xd2, 0x75, 0x47, 0x76, 0x17, 0x32, 0x06, 0x27, 0x26, 0x96, 0xc6, 0xc6, 0x96, 0x70, 0xec };
+    Poly<uint16_t> msg(data1.begin(), data1.end());
+    Poly<uint16_t> a(data1.begin(), data1.end());
+    ReedSolomon<uint16_t> rs(bits);
+    rs.encode(a.coef, nsym);
     cout << "Original message: " << endl;
     msg.print();
     cout << endl << "Encoded message: " << endl;
@@ -43,7 +43,7 @@ void test()
     cout << endl << "Corrupted message: " << endl;
     a.print();
     cout << endl;
-    bool success = rs.decode(a.coef, msg.coef, a.coef, k, nsym, &erasePos, true);
+    bool success = rs.decode(a.coef.data(), msg.coef.data(), a.coef.data(), k, nsym, erasePos, true);
     if (!success) {
         cout << "Decoding failed!" << endl;
     } else {
@@ -56,13 +56,13 @@ void test()
 
 bool test(int bits, int k, int nsym, int ncorr, bool print, bool* unmatch, int erasures)
 {
-    vector<unsigned int> originalData(k + nsym);
+    vector<uint16_t> originalData(k);
     for (int i = 0; i < k; i++)
         originalData[i] = rand() % (1 << bits);
-    Poly<unsigned int> msg(k, originalData);
-    Poly<unsigned int> a(k + nsym, originalData);
-    ReedSolomon<unsigned int> rs(bits);
-    rs.encode(a.coef, originalData, k, nsym);
+    Poly<uint16_t> msg(originalData.begin(), originalData.end());
+    Poly<uint16_t> a(originalData.begin(), originalData.end());
+    ReedSolomon<uint16_t> rs(bits);
+    rs.encode(a.coef, nsym);
     if (print) {
         cout << "Original message: " << endl;
         msg.print();
@@ -101,7 +101,7 @@ bool test(int bits, int k, int nsym, int ncorr, bool print, bool* unmatch, int e
             cout << (int)i << " ";
         cout << endl;
     }
-    bool success = rs.decode(a.coef, msg.coef, a.coef, k, nsym, erasures ? &erasePos : nullptr, print);
+    bool success = rs.decode(a.coef.data(), msg.coef.data(), a.coef.data(), k, nsym, erasePos, print);
     if (print) {
         if (!success) {
             cout << "Decoding failed!" << endl;
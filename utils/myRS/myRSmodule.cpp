@@ -1,14 +1,251 @@
+#ifndef MYRSMODULE_CPP
+#define MYRSMODULE_CPP
+
 #include <iostream>
 #include <iomanip>
 #include <vector>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <array>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include "primes.hpp"
+#include "../../include/thread_pool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 template <typename T>
 concept UnsignedInteger = std::is_unsigned_v<T> &&
                          (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
 
+/**
+ * @brief Region kernels for GF(2^8): multiply a whole buffer by one constant.
+ *
+ * The SIMD versions use the split-nibble method: c*x = c*(x & 0x0f) ^ c*(x & 0xf0),
+ * and each half is looked up 16 or 32 bytes at a time with pshufb from two
+ * 16-entry tables taken from the row of the full multiplication table for c.
+ */
+namespace gf256 {
+
+/**
+ * @brief Multiply a region by a constant with the full multiplication table.
+ * @param dst Destination; receives c*src, or c*src added (XORed) to it.
+ * @param src Source bytes.
+ * @param row Row of the multiplication table for c (256 entries).
+ * @param n Number of bytes.
+ * @param add XOR into dst instead of overwriting it.
+ */
+inline void mul_region_scalar(uint8_t* dst, const uint8_t* src, const uint8_t* row, size_t n, bool add) {
+    if (add)
+        for (size_t i = 0; i < n; ++i)
+            dst[i] ^= row[src[i]];
+    else
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = row[src[i]];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3")))
+inline void mul_region_ssse3(uint8_t* dst, const uint8_t* src, const uint8_t* row, size_t n, bool add) {
+    alignas(16) uint8_t lo[16], hi[16];
+    for (int i = 0; i < 16; ++i) {
+        lo[i] = row[i];
+        hi[i] = row[i << 4];
+    }
+    const __m128i table_lo = _mm_load_si128(reinterpret_cast<const __m128i*>(lo));
+    const __m128i table_hi = _mm_load_si128(reinterpret_cast<const __m128i*>(hi));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(table_lo, _mm_and_si128(x, mask)),
+                                        _mm_shuffle_epi8(table_hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+        if (add)
+            product = _mm_xor_si128(product, _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), product);
+    }
+    mul_region_scalar(dst + i, src + i, row, n - i, add);
+}
+
+__attribute__((target("avx2")))
+inline void mul_region_avx2(uint8_t* dst, const uint8_t* src, const uint8_t* row, size_t n, bool add) {
+    alignas(16) uint8_t lo[16], hi[16];
+    for (int i = 0; i < 16; ++i) {
+        lo[i] = row[i];
+        hi[i] = row[i << 4];
+    }
+    // pshufb works within 128-bit lanes, so both lanes get the same tables
+    const __m256i table_lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lo)));
+    const __m256i table_hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i product = _mm256_xor_si256(_mm256_shuffle_epi8(table_lo, _mm256_and_si256(x, mask)),
+                                           _mm256_shuffle_epi8(table_hi, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+        if (add)
+            product = _mm256_xor_si256(product, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), product);
+    }
+    mul_region_ssse3(dst + i, src + i, row, n - i, add);
+}
+#endif
+
+/**
+ * @brief Instruction sets the region kernels can use.
+ */
+enum class Kernel { Scalar, Ssse3, Avx2 };
+
+/**
+ * @brief Pick the fastest kernel the CPU supports, once.
+ * @return The kernel used by mul_region.
+ */
+inline Kernel best_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const Kernel kernel = __builtin_cpu_supports("avx2") ? Kernel::Avx2
+                               : __builtin_cpu_supports("ssse3") ? Kernel::Ssse3
+                               : Kernel::Scalar;
+    return kernel;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+/**
+ * @brief Multiply a region by a constant with the fastest available kernel.
+ * @param dst Destination; receives c*src, or c*src added (XORed) to it.
+ * @param src Source bytes.
+ * @param row Row of the multiplication table for c (256 entries).
+ * @param n Number of bytes.
+ * @param add XOR into dst instead of overwriting it.
+ * @param kernel Kernel to use.
+ */
+inline void mul_region(uint8_t* dst, const uint8_t* src, const uint8_t* row, size_t n, bool add, Kernel kernel = best_kernel()) {
+    // Short regions do not pay for building the nibble tables
+    if (n < 16)
+        kernel = Kernel::Scalar;
+    switch (kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+        case Kernel::Avx2:
+            mul_region_avx2(dst, src, row, n, add);
+            return;
+        case Kernel::Ssse3:
+            mul_region_ssse3(dst, src, row, n, add);
+            return;
+#endif
+        default:
+            mul_region_scalar(dst, src, row, n, add);
+    }
+}
+
+} // namespace gf256
+
+/**
+ * @brief Log and antilog tables for GF(2^2) to GF(2^16), generated at compile time.
+ *
+ * The tables live in read-only storage and every GaloisField of the same power
+ * points at the same copy, so creating a field costs nothing.
+ */
+namespace gf_tables {
+
+const unsigned int MIN_POWER = 2;   ///< Smallest field with tables.
+const unsigned int MAX_POWER = 16;  ///< Largest field with tables; elements fit in 16 bits.
+
+/**
+ * @brief Tables for one field.
+ * @tparam Power m for GF(2^m).
+ */
+template <unsigned int Power>
+struct FieldTables {
+    uint16_t pow[2 * ((1u << Power) - 1)];  ///< alpha^i, stored twice so log sums need no modulo.
+    uint16_t log[1u << Power];              ///< log_alpha(x); log[0] is unused.
+};
+
+/**
+ * @brief Generate the tables by stepping through the powers of alpha = x.
+ *
+ * Fails to compile if the polynomial in primes.hpp is not primitive.
+ * @tparam Power m for GF(2^m).
+ * @return The tables.
+ */
+template <unsigned int Power>
+constexpr FieldTables<Power> make_tables() {
+    const unsigned int size = 1u << Power;
+    FieldTables<Power> tables;
+    // Arrays are written front to back first: GCC evaluates that much faster than scattered stores
+    for (unsigned int i = 0; i < size; ++i)
+        tables.log[i] = 0;
+    unsigned int x = 1;
+    for (unsigned int i = 0; i < size - 1; ++i) {
+        if (i > 0 && x == 1)
+            throw "primes.hpp: polynomial is not primitive";
+        tables.pow[i] = static_cast<uint16_t>(x);
+        x <<= 1;
+        if (x & size)
+            x ^= primes[Power];
+    }
+    for (unsigned int i = 0; i < size - 1; ++i) {
+        tables.pow[i + size - 1] = tables.pow[i];
+        tables.log[tables.pow[i]] = static_cast<uint16_t>(i);
+    }
+    return tables;
+}
+
+/**
+ * @brief Shared tables for GF(2^Power).
+ */
+template <unsigned int Power>
+inline constexpr FieldTables<Power> tables = make_tables<Power>();
+
+/**
+ * @brief Untyped view of one field's tables.
+ */
+struct TableView {
+    const uint16_t* pow;  ///< Antilog table.
+    const uint16_t* log;  ///< Log table.
+};
+
+template <std::size_t... I>
+constexpr std::array<TableView, sizeof...(I)> make_views(std::index_sequence<I...>) {
+    return {TableView{tables<I + MIN_POWER>.pow, tables<I + MIN_POWER>.log}...};
+}
+
+/**
+ * @brief Views of every field's tables, indexed by power - MIN_POWER.
+ */
+inline constexpr auto views = make_views(std::make_index_sequence<MAX_POWER - MIN_POWER + 1>());
+
+/**
+ * @brief Full product table for GF(2^8), used by the byte region kernels.
+ * @return products[a * 256 + b] = a * b.
+ */
+constexpr std::array<uint8_t, 256 * 256> make_gf256_products() {
+    std::array<uint8_t, 256 * 256> products;
+    const auto& field = tables<8>;
+    for (unsigned int a = 0; a < 256; ++a)
+        for (unsigned int b = 0; b < 256; ++b)
+            products[a * 256 + b] = (a && b) ? static_cast<uint8_t>(field.pow[field.log[a] + field.log[b]]) : 0;
+    return products;
+}
+
+/**
+ * @brief Shared GF(2^8) product table.
+ */
+inline constexpr std::array<uint8_t, 256 * 256> gf256_products = make_gf256_products();
+
+} // namespace gf_tables
+
 /**
  * @brief Class representing a Galois Field of order 2^fieldPower.
  * @tparam T Type of elements in the Galois Field.
@@ -18,47 +255,63 @@ class GaloisField {
 
 private:
     const unsigned int fieldPower; ///< Power of the field (2^fieldPower).
-    const T characteristic;       ///< Characteristic of the field (2^fieldPower).
-    const T primitivePoly;        ///< Primitive polynomial for the field.
+    const unsigned int characteristic; ///< Number of elements in the field (2^fieldPower).
+    const unsigned int primitivePoly;  ///< Primitive polynomial for the field.
+    const uint8_t* mulTable;           ///< Full product table for GF(2^8), null for other fields.
 public:
-    std::vector<T> powTable; ///< Table for exponentiation.
-    std::vector<T> logTable; ///< Table for logarithms.
+    const uint16_t* powTable; ///< Table for exponentiation, doubled so log sums need no modulo.
+    const uint16_t* logTable; ///< Table for logarithms.
 
     /**
      * @brief Constructor for GaloisField.
-     * @param fieldPower The power of the field (2^fieldPower).
+     *
+     * The tables are the shared compile-time ones from gf_tables; nothing is allocated.
+     * @param fieldPower The power of the field (2^fieldPower), from 2 to 16.
      */
     GaloisField(unsigned int fieldPower)
         : fieldPower(fieldPower),
-        characteristic(static_cast<T>(1) << fieldPower),
-        primitivePoly(0),  // Replace with the actual primitive polynomial
-        powTable(characteristic),
-        logTable(characteristic) {
-            // Initialize powTable and logTable
-            T x = 1;
-            for (T i = 0; i < characteristic - 1; ++i) {
-                powTable[i] = x;
-                logTable[x] = i;
-                x = multNoLUT(x, 2);
-            }
+        characteristic(1u << fieldPower),
+        primitivePoly(primes[fieldPower]),
+        mulTable(fieldPower == 8 ? gf_tables::gf256_products.data() : nullptr) {
+            assert(fieldPower >= gf_tables::MIN_POWER && fieldPower <= gf_tables::MAX_POWER && fieldPower <= 8 * sizeof(T));
+            const gf_tables::TableView& tables = gf_tables::views[fieldPower - gf_tables::MIN_POWER];
+            powTable = tables.pow;
+            logTable = tables.log;
         }
     /**
      * @brief Destructor for GaloisField.
      */
     ~GaloisField() = default;
 
+    /**
+     * @brief Get the power of the field.
+     * @return m for GF(2^m).
+     */
+    unsigned int power() const { return fieldPower; }
+
+    /**
+     * @brief Get the number of elements in the field.
+     * @return 2^m for GF(2^m).
+     */
+    unsigned int size() const { return characteristic; }
+
     /**
      * @brief Multiply two elements in the Galois Field without using lookup tables.
+     *
+     * Shift-and-add multiplication, reducing by the primitive polynomial whenever
+     * the partial product overflows the field.
      * @param a First element.
      * @param b Second element.
      * @return Result of the multiplication.
      */
-    T multNoLUT(T a, T b) {
-        T result = 0;
+    unsigned int multNoLUT(unsigned int a, unsigned int b) const {
+        unsigned int result = 0;
         while (b > 0) {
             if (b & 1)
                 result ^= a;
-            a = multNoLUT(a, 2);
+            a <<= 1;
+            if (a & characteristic)
+                a ^= primitivePoly;
             b >>= 1;
         }
         return result;
@@ -70,11 +323,13 @@ public:
      * @param b Second element.
      * @return Result of the multiplication.
      */
-    T mult(T a, T b) {
+    T mult(T a, T b) const {
+        if (mulTable)
+            return mulTable[static_cast<unsigned int>(a) * 256 + b];
         if (a == 0 || b == 0)
             return 0;
 
-        return powTable[(logTable[a] + logTable[b]) % (characteristic - 1)];
+        return powTable[logTable[a] + logTable[b]];
     }
 
     /**
@@ -83,11 +338,11 @@ public:
      * @param b Denominator (non-zero).
      * @return Result of the division.
      */
-    T div(T a, T b) {
+    T div(T a, T b) const {
         assert(b != 0);
         if (a == 0)
             return 0;
-        return powTable[(logTable[a] + (characteristic - 1) - logTable[b]) % (characteristic - 1)];
+        return powTable[logTable[a] + (characteristic - 1) - logTable[b]];
     }
 
     /**
@@ -96,13 +351,13 @@ public:
      * @param power Exponent.
      * @return Result of the exponentiation.
      */
-    T pow(T x, T power) {
+    T pow(T x, T power) const {
         assert(x != 0 || power != 0);  // 0^0 is undefined
         if (x == 0)
             return 0;
         if (power == 0)
             return 1;
-        return powTable[(logTable[x] * power) % (characteristic - 1)];
+        return powTable[(static_cast<uint64_t>(logTable[x]) * power) % (characteristic - 1)];
     }
 
     /**
@@ -110,7 +365,7 @@ public:
      * @param x Element to invert (non-zero).
      * @return Multiplicative inverse of x.
      */
-    T inv(T x) {
+    T inv(T x) const {
         assert(x != 0);
         return powTable[(characteristic - 1) - logTable[x]];
     }
@@ -120,9 +375,82 @@ public:
      * @param x Element for which to compute the square root (non-zero).
      * @return Square root of x.
      */
-    T sqrt(T x) {
+    T sqrt(T x) const {
         assert(x != 0);
-        return powTable[(logTable[x] + ((characteristic - 1) - 1)) / 2];
+        // Squaring doubles the log modulo the odd group order, so halve it (adding the order if odd)
+        unsigned int l = logTable[x];
+        return powTable[(l % 2 == 0) ? l / 2 : (l + characteristic - 1) / 2];
+    }
+
+    /**
+     * @brief Get the row of the product table for one factor.
+     * @param c Constant factor.
+     * @return row[x] = c * x, or null if the field has no product table.
+     */
+    const uint8_t* mult_row(T c) const {
+        return mulTable ? mulTable + static_cast<size_t>(c) * 256 : nullptr;
+    }
+
+    /**
+     * @brief Add a region to another: dst[i] ^= src[i].
+     * @param dst Destination elements.
+     * @param src Source elements.
+     * @param n Number of elements.
+     */
+    void add_region(T* dst, const T* src, size_t n) const {
+        size_t i = 0;
+        for (const size_t word = sizeof(uint64_t) / sizeof(T); i + word <= n; i += word) {
+            uint64_t a, b;
+            std::memcpy(&a, dst + i, sizeof(a));
+            std::memcpy(&b, src + i, sizeof(b));
+            a ^= b;
+            std::memcpy(dst + i, &a, sizeof(a));
+        }
+        for (; i < n; ++i)
+            dst[i] ^= src[i];
+    }
+
+    /**
+     * @brief Multiply a region by a constant: dst[i] = c * src[i].
+     *
+     * In GF(2^8) with byte elements this runs the SIMD kernels.
+     * @param dst Destination elements.
+     * @param src Source elements.
+     * @param c Constant factor.
+     * @param n Number of elements.
+     */
+    void mul_region(T* dst, const T* src, T c, size_t n) const { region(dst, src, c, n, false); }
+
+    /**
+     * @brief Multiply a region by a constant and add it to another: dst[i] ^= c * src[i].
+     *
+     * In GF(2^8) with byte elements this runs the SIMD kernels.
+     * @param dst Destination elements.
+     * @param src Source elements.
+     * @param c Constant factor.
+     * @param n Number of elements.
+     */
+    void mul_add_region(T* dst, const T* src, T c, size_t n) const { region(dst, src, c, n, true); }
+
+private:
+    void region(T* dst, const T* src, T c, size_t n, bool add) const {
+        if constexpr (sizeof(T) == 1) {
+            if (mulTable) {
+                gf256::mul_region(reinterpret_cast<uint8_t*>(dst), reinterpret_cast<const uint8_t*>(src),
+                                  mulTable + static_cast<size_t>(c) * 256, n, add);
+                return;
+            }
+        }
+        if (c == 0) {
+            if (!add)
+                std::fill(dst, dst + n, T{0});
+            return;
+        }
+        const unsigned int lc = logTable[c];
+        for (size_t i = 0; i < n; ++i) {
+            T product = src[i] ? powTable[logTable[src[i]] + lc] : T{0};
+            dst[i] = add ? static_cast<T>(dst[i] ^ product) : product;
+        }
     }
 };
 
@@ -130,7 +458,7 @@ public:
 template <UnsignedInteger T>
 class Poly {
 public:
-    std::vector<T> coef;  ///< Vector of coefficients.
+    std::vector<T> coef;  ///< Vector of coefficients, highest degree first.
 
     /**
      * @brief Default constructor for a polynomial.
@@ -144,12 +472,27 @@ public:
      */
     Poly(int n, T initialValue = T{}) : coef(n, initialValue) {}
 
+    /**
+     * @brief Construct a polynomial from a range of coefficients.
+     * @param first Iterator to the highest-degree coefficient.
+     * @param last Iterator past the constant coefficient.
+     */
+    template <std::input_iterator It>
+    Poly(It first, It last) : coef(first, last) {}
+
     /**
      * @brief Copy constructor using the assignment operator.
      * @param other Another Poly object to copy from.
      */
     Poly(const Poly<T>& other) : coef(other.coef) {}
 
+    /**
+     * @brief Copy assignment.
+     * @param other Another Poly object to copy from.
+     * @return This polynomial.
+     */
+    Poly& operator=(const Poly<T>& other) = default;
+
     /**
      * @brief Get the size of the coefficient vector.
      * @return Size of the coefficient vector.
@@ -178,7 +521,7 @@ public:
         if (!coef.empty()) {
             std::cout << "[";
             for (const auto& c : coef) {
-                std::cout << std::hex << std::setw(3) << static_cast<T>(c);
+                std::cout << std::hex << std::setw(3) << static_cast<unsigned long>(c);
                 if (&c != &coef.back()) std::cout << ", ";
             }
             std::cout << "]" << std::dec << std::endl;
@@ -195,10 +538,10 @@ public:
      * @param other The polynomial to add.
      */
     void Add(const Poly<T>& other) {
-        int n = std::max(coef.size(), other.coef.size());
-        coef.resize(n);
-
-        std::transform(coef.rbegin(), coef.rend(), other.coef.rbegin(), coef.rbegin(), std::plus<T>());
+        // Align the constant terms; addition in GF(2^m) is XOR
+        if (other.coef.size() > coef.size())
+            coef.insert(coef.begin(), other.coef.size() - coef.size(), T{0});
+        std::transform(other.coef.rbegin(), other.coef.rend(), coef.rbegin(), coef.rbegin(), std::bit_xor<T>());
     }
 
     /**
@@ -207,8 +550,7 @@ public:
      * @param gf Galois Field.
      */
     void Scale(T scale, const GaloisField<T>& gf) {
-        for (auto& coef : this->coef)
-            coef = this->gf.mult(coef, scale);
+        gf.mul_region(coef.data(), coef.data(), scale, coef.size());
     }
 
     /**
@@ -217,36 +559,27 @@ public:
      * @param gf Galois Field.
      */
     void Mult(const Poly<T>& other, const GaloisField<T>& gf) {
-        int n = coef.size() + other.coef.size() - 1;
-        coef.resize(n, 0);
+        if (coef.empty() || other.coef.empty()) {
+            coef.clear();
+            return;
+        }
+        std::vector<T> product(coef.size() + other.coef.size() - 1, T{0});
 
-        for (int i = 0; i < coef.size(); ++i)
-            for (int j = 0; j < other.coef.size(); ++j)
-                coef[i + j] ^= gf.mult(coef[i], other.coef[j]);
+        // Each coefficient of this polynomial adds a scaled copy of the other one
+        for (size_t i = 0; i < coef.size(); ++i)
+            gf.mul_add_region(product.data() + i, other.coef.data(), coef[i], other.coef.size());
+        coef.swap(product);
     }
 
     /**
-     * @brief Divide this polynomial by another polynomial.
+     * @brief Divide this polynomial by another polynomial, keeping the quotient.
      * @param other The divisor polynomial.
      * @param gf Galois Field.
      */
     void Div(const Poly<T>& other, const GaloisField<T>& gf) {
-        int n = coef.size();
-        Poly<T> temp(*this);
-
-        T normalizer = other.coef[0];
-        for (int i = 0; i < n - other.coef.size() + 1; ++i) {
-            temp.coef[i] = gf.div(temp.coef[i], normalizer);
-
-            T coef = temp.coef[i];
-            if (coef != 0)
-                for (int j = 1; j < other.coef.size(); ++j)
-                    if (other.coef[j] != 0)
-                        temp.coef[i + j] ^= gf.mult(other.coef[j], coef);
-        }
-
-        int separator = n - other.coef.size() + 1;
-        coef.assign(temp.coef.begin(), temp.coef.begin() + separator);
+        Poly<T> quotient, remainder;
+        Poly_Div(quotient, remainder, *this, other, gf);
+        coef.swap(quotient.coef);
     }
 
     /**
@@ -256,6 +589,8 @@ public:
      * @return Result of the polynomial evaluation.
      */
     T Eval(T x, const GaloisField<T>& gf) const {
+        if (coef.empty())
+            return 0;
         T y = coef[0];
         for (auto it = std::next(coef.begin()); it != coef.end(); ++it)
             y = gf.mult(y, x) ^ *it;
@@ -267,8 +602,8 @@ public:
      * @param right Number of zeros to add on the right.
      */
     void Pad(int left, int right) {
-        coef.resize(coef.size() + left + right, 0);
-        std::rotate(coef.rbegin(), coef.rbegin() + right, coef.rend());
+        coef.insert(coef.begin(), left, T{0});
+        coef.insert(coef.end(), right, T{0});
     }
 
     /**
@@ -292,10 +627,156 @@ public:
 }; // end Poly
 
 
+/**
+ * @brief Polynomial with inline storage for at most MaxDeg + 1 coefficients.
+ *
+ * Same layout and operations as Poly, but nothing is allocated, so the decoder's
+ * temporaries can live on the stack. Exceeding the capacity is a programming error.
+ * @tparam T Type of coefficients in the polynomial.
+ * @tparam MaxDeg Largest degree the polynomial can hold.
+ */
+template <UnsignedInteger T, std::size_t MaxDeg>
+class FixedPoly {
+public:
+    /**
+     * @brief Default constructor for an empty polynomial.
+     */
+    FixedPoly() = default;
+
+    /**
+     * @brief Parameterized constructor for the FixedPoly class.
+     * @param n Number of coefficients.
+     * @param initialValue Initial value for coefficients.
+     */
+    FixedPoly(int n, T initialValue = T{}) : length(n) {
+        assert(length <= MaxDeg + 1);
+        std::fill(begin(), end(), initialValue);
+    }
+
+    /**
+     * @brief Copy constructor; copies only the coefficients in use.
+     * @param other Another FixedPoly object to copy from.
+     */
+    FixedPoly(const FixedPoly& other) : length(other.length) { std::copy(other.begin(), other.end(), begin()); }
+
+    /**
+     * @brief Copy assignment; copies only the coefficients in use.
+     * @param other Another FixedPoly object to copy from.
+     * @return This polynomial.
+     */
+    FixedPoly& operator=(const FixedPoly& other) {
+        length = other.length;
+        std::copy(other.begin(), other.end(), begin());
+        return *this;
+    }
+
+    /**
+     * @brief Get the number of coefficients.
+     * @return Number of coefficients in use.
+     */
+    size_t size() const { return length; }
+
+    /**
+     * @brief Subscript operator to access coefficients by index.
+     * @param index Index of the coefficient to access.
+     * @return Reference to the coefficient at the specified index.
+     */
+    T& operator[](size_t index) { return coef[index]; }
+
+    /**
+     * @brief Const subscript operator to access coefficients by index.
+     * @param index Index of the coefficient to access.
+     * @return Const reference to the coefficient at the specified index.
+     */
+    const T& operator[](size_t index) const { return coef[index]; }
+
+    T* begin() { return coef.data(); }
+    T* end() { return coef.data() + length; }
+    const T* begin() const { return coef.data(); }
+    const T* end() const { return coef.data() + length; }
+
+    /**
+     * @brief Append a coefficient at the constant end.
+     * @param value Coefficient to append.
+     */
+    void push_back(T value) {
+        assert(length <= MaxDeg);
+        coef[length++] = value;
+    }
+
+    /**
+     * @brief Reverse the coefficients of the polynomial.
+     */
+    void reverse() { std::reverse(begin(), end()); }
+
+    /**
+     * @brief Add two polynomials and store the result in this polynomial.
+     * @param other The polynomial to add.
+     */
+    void Add(const FixedPoly& other) {
+        if (other.length > length)
+            Pad(other.length - length, 0);
+        // Align the constant terms; addition in GF(2^m) is XOR
+        for (size_t i = 1; i <= other.length; ++i)
+            coef[length - i] ^= other.coef[other.length - i];
+    }
+
+    /**
+     * @brief Scale a polynomial by a constant factor.
+     * @param scale Constant factor.
+     * @param gf Galois Field.
+     */
+    void Scale(T scale, const GaloisField<T>& gf) { gf.mul_region(coef.data(), coef.data(), scale, length); }
+
+    /**
+     * @brief Evaluate the polynomial for a given value of x using a specified Galois Field.
+     * @param x Value for which the polynomial is evaluated.
+     * @param gf Galois Field.
+     * @return Result of the polynomial evaluation.
+     */
+    T Eval(T x, const GaloisField<T>& gf) const {
+        T y = 0;
+        for (T c : *this)
+            y = gf.mult(y, x) ^ c;
+        return y;
+    }
+
+    /**
+     * @brief Pad the polynomial with zeros on the left and right.
+     * @param left Number of zeros to add on the left.
+     * @param right Number of zeros to add on the right.
+     */
+    void Pad(int left, int right) {
+        assert(length + left + right <= MaxDeg + 1);
+        std::copy_backward(begin(), end(), end() + left);
+        std::fill(begin(), begin() + left, T{0});
+        length += left;
+        std::fill(end(), end() + right, T{0});
+        length += right;
+    }
+
+    /**
+     * @brief Trim the polynomial by removing leading and trailing coefficients.
+     * @param left Number of leading coefficients to remove.
+     * @param right Number of trailing coefficients to remove.
+     */
+    void Trim(int left, int right) {
+        std::copy(begin() + left, end() - right, begin());
+        length -= left + right;
+    }
+
+private:
+    std::array<T, MaxDeg + 1> coef;  ///< Coefficients, highest degree first; only the first length are in use.
+    size_t length = 0;               ///< Number of coefficients in use.
+}; // end FixedPoly
+
+
 /**
  * @brief Divide two polynomials with remainders!
+ *
+ * Synthetic division: each quotient coefficient subtracts a scaled copy of the
+ * divisor, which runs on the region kernels.
  * @tparam T Type of coefficients in the polynomial.
- * @param result Resultant polynomial after division.
  * @param quotient Quotient polynomial after division.
  * @param remainder Remainder polynomial after division.
  * @param a Numerator polynomial.
@@ -303,50 +784,90 @@ public:
  * @param gf Galois Field.
  */
 template <typename T>
-void Poly_Div(Poly<T>& result, Poly<T>& quotient, Poly<T>& remainder, const Poly<T>& a, const Poly<T>& b, const GaloisField<T>& gf) {
-    int n = a.size();
-    result.resize(n);
-
-    Poly<T> temp(a);
+void Poly_Div(Poly<T>& quotient, Poly<T>& remainder, const Poly<T>& a, const Poly<T>& b, const GaloisField<T>& gf) {
+    assert(!b.coef.empty() && b[0] != 0);
+    if (a.size() < b.size()) {
+        quotient = Poly<T>();
+        remainder = a;
+        return;
+    }
 
-    T normalizer = b[0];
-    for (int i = 0; i < n - b.size() + 1; ++i) {
-        temp[i] = gf.div(temp[i], normalizer);
+    std::vector<T> temp(a.coef);
+    const size_t separator = a.size() - b.size() + 1;
+    const T normalizer = b[0];
+    for (size_t i = 0; i < separator; ++i) {
+        if (normalizer != 1)
+            temp[i] = gf.div(temp[i], normalizer);
 
-        T coef = temp[i];
-        if (coef != 0)
-            for (int j = 1; j < b.size(); ++j)
-                if (b[j] != 0)
-                    temp[i + j] ^= gf.mult(b[j], coef);
+        if (temp[i] != 0)
+            gf.mul_add_region(temp.data() + i + 1, b.coef.data() + 1, temp[i], b.size() - 1);
     }
-    result = temp;
 
-    int separator = n - b.size() + 1;
-    quotient.assign(temp.begin(), temp.begin() + separator);
-    remainder.assign(temp.begin() + separator, temp.end());
-};
+    quotient = Poly<T>(temp.begin(), temp.begin() + separator);
+    remainder = Poly<T>(temp.begin() + separator, temp.end());
+}
 
 
 /**
  * @brief Perform Chien search on a polynomial.
+ *
+ * Incremental: term k of the polynomial at alpha^i is c_k * alpha^(i*k), so each
+ * term keeps the log of its current value and steps it by k per position, which
+ * is one table lookup and an add per term instead of a multiply. The search stops
+ * once it has found as many roots as the degree, and a linear polynomial is
+ * solved directly.
  * @tparam T Type of coefficients in the polynomial.
- * @param out Vector to store the roots found.
+ * @tparam Positions std::vector<unsigned int> or a FixedPoly of unsigned int, which also holds the per-term state.
+ * @tparam P Poly or FixedPoly.
+ * @param out Vector to store the exponents i for which alpha^i is a root.
  * @param poly Polynomial for Chien search.
- * @param max Maximum number of roots to search for.
+ * @param max Number of powers alpha^0 .. alpha^(max-1) to try.
  * @param gf Galois Field.
  */
-template <typename T>
-void Poly_ChienSearch(std::vector<unsigned int>& out, const Poly<T>& poly, int max, const GaloisField<T>& gf) {
-    Poly<T> temp(poly);
+template <typename T, typename Positions, typename P>
+void Poly_ChienSearch(Positions& out, const P& poly, int max, const GaloisField<T>& gf) {
+    const unsigned int order = gf.size() - 1;
+    size_t leading = 0;
+    while (leading < poly.size() && poly[leading] == 0)
+        leading++;
+    if (leading + 1 >= poly.size())
+        return;  // constant: no roots to find
+    const size_t degree = poly.size() - 1 - leading;
+    const T constant = poly[poly.size() - 1];
+
+    if (degree == 1) {
+        // c_1 x + c_0 = 0 at x = c_0 / c_1
+        if (constant != 0) {
+            unsigned int i = gf.logTable[gf.div(constant, poly[leading])];
+            if (i < static_cast<unsigned int>(max))
+                out.push_back(i);
+        }
+        return;
+    }
 
+    Positions logs, steps;
+    for (size_t k = 1; k <= degree; ++k) {
+        T c = poly[poly.size() - 1 - k];
+        if (c != 0) {
+            logs.push_back(gf.logTable[c]);
+            steps.push_back(k % order);
+        }
+    }
+
+    const size_t found = out.size();
     for (int i = 0; i < max; ++i) {
-        T sum = 0;
-        for (auto& coef : temp) {
-            sum ^= coef;
-            coef = gf.mult(coef, gf.powTable[poly.size() - &coef - 1]);
+        T sum = constant;
+        for (unsigned int l : logs)
+            sum ^= static_cast<T>(gf.powTable[l]);
+        for (size_t t = 0; t < logs.size(); ++t) {
+            logs[t] += steps[t];
+            logs[t] -= (logs[t] >= order) ? order : 0;
         }
-        if (sum == 0)
+        if (sum == 0) {
             out.push_back(i);
+            if (out.size() - found == degree)
+                return;
+        }
     }
 }
 
@@ -386,6 +907,177 @@ void FindPrimePolys(std::ostream& out, int fieldPower, int limit) {
         }
     }
 }
+/**
+ * @brief Build the generator polynomial (x - alpha^0)(x - alpha^1)...(x - alpha^(nsym-1)).
+ * @tparam T Type of coefficients in the polynomial.
+ * @param out Output generator, highest degree (monic) first.
+ * @param nsym Number of error correction symbols.
+ * @param gf Galois Field.
+ */
+template <typename T>
+void Poly_Generator(Poly<T>& out, int nsym, const GaloisField<T>& gf) {
+    out = Poly<T>(1, 1);
+    Poly<T> factor(2, 1);
+    for (int i = 0; i < nsym; i++) {
+        factor.coef[1] = static_cast<T>(gf.powTable[i]);
+        out.Mult(factor, gf);
+    }
+}
+
+/**
+ * @brief Systematic Reed-Solomon encoder for one (field, nsym) pair.
+ *
+ * The generator polynomial is built once. Parity comes from a linear feedback
+ * shift register: each data symbol feeds back through the generator, which is a
+ * row lookup and an XOR per parity symbol. Fields up to GF(2^8) precompute the
+ * product of every field element with every generator coefficient, so the row for
+ * a feedback value is one contiguous table; larger fields keep the logs of the
+ * coefficients instead.
+ * @tparam T Type of elements in the code.
+ */
+template <UnsignedInteger T>
+class RSEncoder {
+public:
+    /**
+     * @brief Precompute the generator and its multiply tables.
+     * @param gf Galois Field.
+     * @param nsym Number of parity symbols per codeword.
+     */
+    RSEncoder(const GaloisField<T>& gf, int nsym) : gf(gf), nsym(nsym) {
+        assert(nsym > 0 && static_cast<unsigned int>(nsym) < gf.size() - 1);
+        Poly_Generator(generator, nsym, gf);
+
+        if (gf.power() <= 8) {
+            // rows[f * nsym + j] = f * g[j + 1]: the whole register update for feedback f
+            rows.resize(static_cast<size_t>(gf.size()) * nsym);
+            for (unsigned int f = 0; f < gf.size(); ++f)
+                gf.mul_region(rows.data() + f * nsym, generator.coef.data() + 1, static_cast<T>(f), nsym);
+        } else {
+            // Zero coefficients get a log past the end of the antilog table and are skipped
+            logs.resize(nsym);
+            for (int j = 0; j < nsym; ++j)
+                logs[j] = generator[j + 1] ? gf.logTable[generator[j + 1]] : NO_LOG;
+        }
+    }
+
+    /**
+     * @brief Get the number of parity symbols.
+     * @return nsym.
+     */
+    int parity_size() const { return nsym; }
+
+    /**
+     * @brief Get the generator polynomial.
+     * @return The monic generator, highest degree first.
+     */
+    const Poly<T>& polynomial() const { return generator; }
+
+    /**
+     * @brief Compute the parity symbols of a message without allocating.
+     * @param data Message symbols; data.size() + nsym must be less than the field size.
+     * @param parity Output of nsym parity symbols (the remainder, highest degree first).
+     */
+    void parity(std::span<const T> data, std::span<T> parity) const {
+        assert(parity.size() == static_cast<size_t>(nsym) && data.size() + nsym < gf.size());
+        T* __restrict r = parity.data();
+        std::fill(r, r + nsym, T{0});
+        const size_t last = nsym - 1;
+
+        if (!rows.empty()) {
+            for (T d : data) {
+                const T* __restrict row = rows.data() + static_cast<size_t>(d ^ r[0]) * nsym;
+                // Shift and add a word at a time; each word is read before the one below it is written
+                size_t j = 0;
+                for (; j + WORD <= last; j += WORD) {
+                    uint64_t shifted, product;
+                    std::memcpy(&shifted, r + j + 1, sizeof(shifted));
+                    std::memcpy(&product, row + j, sizeof(product));
+                    shifted ^= product;
+                    std::memcpy(r + j, &shifted, sizeof(shifted));
+                }
+                for (; j < last; ++j)
+                    r[j] = r[j + 1] ^ row[j];
+                r[last] = row[last];
+            }
+            return;
+        }
+
+        for (T d : data) {
+            const T feedback = d ^ r[0];
+            if (feedback == 0) {
+                std::copy(r + 1, r + nsym, r);
+                r[last] = 0;
+                continue;
+            }
+            const unsigned int lf = gf.logTable[feedback];
+            for (size_t j = 0; j < last; ++j)
+                r[j] = r[j + 1] ^ (logs[j] != NO_LOG ? static_cast<T>(gf.powTable[logs[j] + lf]) : T{0});
+            r[last] = logs[last] != NO_LOG ? static_cast<T>(gf.powTable[logs[last] + lf]) : T{0};
+        }
+    }
+
+    /**
+     * @brief Compute parity for many codewords at once, one per column of a matrix.
+     *
+     * Row i holds symbol i of every codeword, so the shift register runs on whole
+     * rows: each step is one region multiply-add per parity row, which the SIMD
+     * kernels handle at full width.
+     * @param data Message matrix, rows * width symbols, row-major.
+     * @param rows Message length of each codeword.
+     * @param width Number of codewords.
+     * @param parity Output parity matrix, nsym * width symbols, row-major.
+     */
+    void parity_columns(const T* data, size_t rows, size_t width, T* parity) const {
+        assert(rows + nsym < gf.size());
+        std::fill(parity, parity + nsym * width, T{0});
+        std::vector<T> feedback(width);
+
+        // The register is a ring of rows; register row j lives in slot (head + j) % nsym
+        size_t head = 0;
+        for (size_t r = 0; r < rows; ++r) {
+            T* first = parity + head * width;
+            const T* row = data + r * width;
+            for (size_t w = 0; w < width; ++w)
+                feedback[w] = row[w] ^ first[w];
+
+            // The slot shifted out becomes the new last row
+            gf.mul_region(first, feedback.data(), generator[nsym], width);
+            head = (head + 1) % nsym;
+            for (int j = 0; j + 1 < nsym; ++j)
+                gf.mul_add_region(parity + ((head + j) % nsym) * width, feedback.data(), generator[j + 1], width);
+        }
+        std::rotate(parity, parity + head * width, parity + nsym * width);
+    }
+
+    /**
+     * @brief Append the parity symbols to a message.
+     * @param data Message; receives the nsym parity symbols at the end.
+     */
+    void encode(std::vector<T>& data) const {
+        const size_t length = data.size();
+        data.resize(length + nsym);
+        parity(std::span<const T>(data.data(), length), std::span<T>(data.data() + length, nsym));
+    }
+
+private:
+    static const unsigned int NO_LOG = ~0u;
+    static const size_t WORD = sizeof(uint64_t) / sizeof(T);  ///< Symbols per 64-bit word.
+
+    GaloisField<T> gf;                 ///< Field the code is over.
+    int nsym;                          ///< Parity symbols per codeword.
+    Poly<T> generator;                 ///< Monic generator polynomial.
+    std::vector<T> rows;               ///< Feedback rows for fields up to GF(2^8).
+    std::vector<unsigned int> logs;    ///< Logs of the generator coefficients for larger fields.
+};
+
+/**
+ * @brief Outcome of decoding one codeword of a batch.
+ */
+struct DecodeStatus {
+    bool ok = false;             ///< The codeword was clean or has been corrected.
+    unsigned int corrected = 0;  ///< Erasures filled plus errors corrected.
+};
+
 /**
  * @brief Template class representing the Reed-Solomon error correction code.
  * @tparam T Type of elements in the Reed-Solomon code.
@@ -405,17 +1097,25 @@ template <UnsignedInteger T>class ReedSolomon {
          * @param out Output polynomial representing the generator.
          * @param nsym Number of symbols in the error-correction code.
          */
-        void createGenerator(Poly<T>& out, int nsym) {
-            out = Poly<T>(1, 0);
-            out.coef[0] = 1;
-
-            Poly<T> factor = Poly<T>(2, 0);
-            factor.coef[0] = 1;
+        void createGenerator(Poly<T>& out, int nsym) const {
+            Poly_Generator(out, nsym, this->gf);
+        }
 
-            for (int i = 0; i < nsym; i++) {
-                factor.coef[1] = this->gf.powTable[i];
-                out.Mult(factor, this->gf);
-            }
+        /**
+         * @brief Get the encoder for a number of parity symbols.
+         *
+         * Encoders are built on first use and kept for the lifetime of this object,
+         * so the generator and its tables are computed once per nsym. Safe to call
+         * from several threads.
+         * @param nsym Number of error correction symbols.
+         * @return The cached encoder.
+         */
+        const RSEncoder<T>& encoder(int nsym) const {
+            std::lock_guard<std::mutex> lock(encodersMutex);
+            auto& slot = encoders[nsym];
+            if (!slot)
+                slot = std::make_unique<RSEncoder<T>>(this->gf, nsym);
+            return *slot;
         }
 
         /**
@@ -431,61 +1131,175 @@ template <UnsignedInteger T>class ReedSolomon {
          *
          * @note The input vector `data` will be modified to contain the encoded message.
          */
-        bool encode(std::vector<T>& data, int nsym) {
-            Poly<T> msg(data.begin(), data.end());
-            Poly<T> generator, remainder;
-            this->createGenerator(generator, nsym);
-            msg.Pad(0, nsym);
-            Poly_Div(remainder, msg, generator, this->gf);
-
-            for (size_t i = 0; i < data.size(); ++i) {
-                data[i] ^= (i < remainder.size()) ? remainder.coef[i] : 0;
-            }
+        bool encode(std::vector<T>& data, int nsym) const {
+            if (nsym <= 0 || data.size() + nsym >= this->gf.size())
+                return false;
+
+            // Systematic code: the remainder is appended as the parity symbols
+            this->encoder(nsym).encode(data);
+            return true;
+        }
+
+        /**
+         * @brief Compute the parity symbols of a message without allocating.
+         * @param data Message symbols.
+         * @param parity Output of nsym parity symbols.
+         * @param nsym Number of error correction symbols.
+         * @return True if the encoding is successful, false otherwise.
+         */
+        bool encode(std::span<const T> data, std::span<T> parity, int nsym) const {
+            if (nsym <= 0 || parity.size() != static_cast<size_t>(nsym) || data.size() + nsym >= this->gf.size())
+                return false;
+            this->encoder(nsym).parity(data, parity);
+            return true;
+        }
 
-            return true; // Assuming success
+        /**
+         * @brief Encode many codewords in parallel.
+         * @param codewords Codewords of k data symbols followed by nsym parity symbols, which are filled in.
+         * @param nsym Number of error correction symbols.
+         * @param pool Threads to run on.
+         * @return True if every codeword could be encoded.
+         */
+        bool encode_batch(std::span<const std::span<T>> codewords, int nsym, ThreadPool& pool) const {
+            if (nsym <= 0 || static_cast<size_t>(nsym) >= this->gf.size())
+                return codewords.empty();
+            // The encoder is looked up once, so the workers never take its lock
+            const RSEncoder<T>& enc = this->encoder(nsym);
+            std::atomic<bool> ok{true};
+            pool.parallel_for(codewords.size(), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    std::span<T> c = codewords[i];
+                    if (c.size() < static_cast<size_t>(nsym) || c.size() >= this->gf.size()) {
+                        ok = false;
+                        continue;
+                    }
+                    enc.parity(c.first(c.size() - nsym), c.last(nsym));
+                }
+            });
+            return ok;
+        }
+
+        /**
+         * @brief Decode many codewords in parallel, each in place.
+         * @param codewords Codewords of k data symbols followed by nsym parity symbols.
+         * @param nsym Number of error correction symbols.
+         * @param erasures Erasure positions of each codeword; may be shorter than codewords, or empty.
+         * @param pool Threads to run on.
+         * @return Status and number of corrections of each codeword.
+         */
+        std::vector<DecodeStatus> decode_batch(std::span<const std::span<T>> codewords, int nsym,
+                                               std::span<const std::span<const unsigned int>> erasures,
+                                               ThreadPool& pool) const {
+            std::vector<DecodeStatus> status(codewords.size());
+            pool.parallel_for(codewords.size(), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    std::span<T> c = codewords[i];
+                    if (c.size() <= static_cast<size_t>(nsym))
+                        continue;
+                    std::span<const unsigned int> erase = i < erasures.size() ? erasures[i] : std::span<const unsigned int>();
+                    status[i].ok = this->decode(c.data(), nullptr, c.data(), c.size() - nsym, nsym, erase, false,
+                                                &status[i].corrected);
+                }
+            });
+            return status;
         }
 
         /**
          * @brief Calculate syndromes for error detection.
-         * @param out Output polynomial containing syndromes.
+         * @param out Output polynomial: a leading 0 followed by the syndromes S_0 .. S_(nsym-1).
          * @param msg Input polynomial representing the received message.
          * @param nsym Number of symbols in the error-correction code.
          */
-        void calcSyndromes(Poly<T>& out, const Poly<T>& msg, int nsym) {
-            T temp[nsym + 1];
-
-            for (int i = 0; i < nsym; i++)
-                temp[nsym - i - 1] = msg.Eval(this->gf.powTable[i], this->gf);
+        void calcSyndromes(Poly<T>& out, const Poly<T>& msg, int nsym) const {
+            out = Poly<T>(nsym + 1, 0);
+            this->syndromes(msg.coef, std::span<T>(out.coef).subspan(1));
+        }
 
-            temp[nsym] = 0;  // pad
+        /**
+         * @brief Compute all the syndromes of a codeword in one pass over it.
+         *
+         * Each symbol advances the Horner sums of every root at once. In GF(2^8) the
+         * step for root alpha^i is a lookup in that root's product table row; other
+         * fields use the log tables.
+         * @param codeword Received codeword, highest degree first.
+         * @param out Output S_0 .. S_(nsym-1), one per element of the span.
+         * @return True if every syndrome is zero (the codeword is clean).
+         */
+        bool syndromes(std::span<const T> codeword, std::span<T> out) const {
+            const size_t nsym = out.size();
+            T* s = out.data();
+            std::fill(s, s + nsym, T{0});
+
+            if (this->gf.mult_row(1) && nsym <= 256) {
+                std::array<const uint8_t*, 256> rows;
+                for (size_t i = 0; i < nsym; ++i)
+                    rows[i] = this->gf.mult_row(static_cast<T>(this->gf.powTable[i]));
+                for (T d : codeword)
+                    for (size_t i = 0; i < nsym; ++i)
+                        s[i] = rows[i][s[i]] ^ d;
+            } else {
+                for (T d : codeword)
+                    for (size_t i = 0; i < nsym; ++i)
+                        s[i] = (s[i] ? static_cast<T>(this->gf.powTable[this->gf.logTable[s[i]] + i]) : T{0}) ^ d;
+            }
+            return std::all_of(s, s + nsym, [](T value) { return value == 0; });
+        }
 
-            out = Poly<T>(nsym + 1, temp);
+        /**
+         * @brief Compute the syndromes of many codewords at once, one per column of a matrix.
+         *
+         * The Horner step for a root runs on whole rows with the SIMD region kernels.
+         * @param data Codeword matrix, n * width symbols, row-major; row i holds symbol i of every codeword.
+         * @param n Codeword length.
+         * @param width Number of codewords.
+         * @param out Output syndromes, nsym * width symbols; row i holds S_i of every codeword.
+         * @param nsym Number of symbols in the error-correction code.
+         * @return True if every codeword is clean.
+         */
+        bool syndromes_columns(const T* data, size_t n, size_t width, T* out, int nsym) const {
+            for (int i = 0; i < nsym; ++i) {
+                T* acc = out + i * width;
+                const T root = static_cast<T>(this->gf.powTable[i]);
+                std::copy(data, data + width, acc);
+                for (size_t r = 1; r < n; ++r) {
+                    this->gf.mul_region(acc, acc, root, width);
+                    this->gf.add_region(acc, data + r * width, width);
+                }
+            }
+            return std::all_of(out, out + nsym * width, [](T value) { return value == 0; });
         }
 
         /**
          * @brief Check if syndromes indicate errors in the received message.
          * @param synd Input polynomial containing syndromes.
-         * @return True if errors are detected, false otherwise.
+         * @return True if the syndromes are all zero (no errors), false otherwise.
          */
-        bool checkSyndromes(const Poly<T>& synd) {
-            return std::all_of(synd.coef.begin(), synd.coef.end(), [](T value) { return value == 0; });
+        template <typename P>
+        bool checkSyndromes(const P& synd) const {
+            for (size_t i = 0; i < synd.size(); i++)
+                if (synd[i] != 0)
+                    return false;
+            return true;
         }
 
         /**
          * @brief Find the errata locator polynomial based on error positions.
          * @param out Output errata locator polynomial.
-         * @param errPos Positions of errors in the received message.
+         * @param coefPos Positions of errors as polynomial coefficient degrees.
          * @return True if successful, false otherwise.
          */
-        bool findErrataLocator(Poly<T>& out, const std::vector<unsigned int>& errPos) {
-            out.setCopy(1, nullptr);
-            out.coef[0] = 1;
-            Poly<T> factor(2, nullptr);
-            factor.coef[1] = 1;
-
-            for (unsigned int i : errPos) {
-                factor.coef[0] = this->gf.powTable[i];
-                Poly_Mult(&out, &out, &factor, &this->gf);
+        template <typename P, typename Positions>
+        bool findErrataLocator(P& out, const Positions& coefPos) const {
+            out = P(1, 1);
+
+            // Product of (1 + x * alpha^i) over the positions, multiplied in place
+            for (unsigned int i : coefPos) {
+                const T x = static_cast<T>(this->gf.powTable[i]);
+                out.Pad(0, 1);
+                for (size_t j = out.size() - 1; j > 0; j--)
+                    out[j] = this->gf.mult(out[j], x) ^ out[j - 1];
+                out[0] = this->gf.mult(out[0], x);
             }
 
             return true;
@@ -498,101 +1312,120 @@ template <UnsignedInteger T>class ReedSolomon {
          * @param nsym Number of symbols in the codeword.
          * @return Resultant error evaluator polynomial.
          */
-        Poly<T> findErrorEvaluator(const Poly<T>& synd, const Poly<T>& errLoc, int nsym) {
-            Poly<T> out = synd;
-            out.Mult(errLoc, this->gf);
-            out.Trim(out.size() - nsym, 0);
+        template <typename P>
+        P findErrorEvaluator(const P& synd, const P& errLoc, int nsym) const {
+            // Omega(x) = S(x) * Lambda(x) mod x^(nsym + 1), computing only the kept terms
+            const size_t a = synd.size(), b = errLoc.size();
+            if (a == 0 || b == 0)
+                return P();
+            const size_t terms = std::min(a + b - 1, static_cast<size_t>(nsym + 1));
+            P out(terms, 0);
+            for (size_t d = 0; d < terms; d++) {
+                T sum = 0;
+                for (size_t i = d + 1 > b ? d + 1 - b : 0; i <= d && i < a; i++)
+                    sum ^= this->gf.mult(synd[a - 1 - i], errLoc[b - 1 - (d - i)]);
+                out[terms - 1 - d] = sum;
+            }
             return out;
         }
 
         /**
          * @brief Correct errors in the received message based on syndromes and error positions.
-         * @param msg Received message polynomial.
+         * @param msg Received message, corrected in place.
          * @param synd Syndromes of the received message.
          * @param errPos Positions of errors in the received message.
-         * @return True if successful, false otherwise.
+         * @return True if successful, false otherwise; msg is only changed on success.
          */
-        bool correctErrata(Poly<T>& msg, const Poly<T>& synd, const std::vector<unsigned int>& errPos) {
-            std::vector<unsigned int> coefPos(0);
+        template <typename P, typename Positions>
+        bool correctErrata(std::span<T> msg, const P& synd, const Positions& errPos) const {
+            Positions coefPos;
             for (unsigned int i : errPos)
-                coefPos.push_back(msg.coef.size() - 1 - i);
+                coefPos.push_back(msg.size() - 1 - i);
 
-            Poly<T> errLoc, errEval;
+            P errLoc;
             this->findErrataLocator(errLoc, coefPos);
-            this->findErrorEvaluator(errEval, synd, errLoc, errLoc.coef.size());
-
-            std::vector<T> x(coefPos.size());
-            for (int i = 0; i < x.size(); i++)
-                x[i] = this->gf.powTable[coefPos[i]];
-
-            Poly<T> e(msg.coef.size(), 0);
-            for (int i = 0; i < x.size(); i++) {
-                T xi = this->gf.powTable[this->gf.characteristic - coefPos[i]];
+            P reversedSynd = synd;
+            reversedSynd.reverse();
+            P errEval = this->findErrorEvaluator(reversedSynd, errLoc, errLoc.size() - 1);
+
+            P x(coefPos.size(), 0);
+            for (size_t i = 0; i < x.size(); i++)
+                x[i] = static_cast<T>(this->gf.powTable[coefPos[i]]);
+
+            // Forney: e_i = X_i * Omega(X_i^-1) / Lambda'(X_i^-1)
+            P e(x.size(), 0);
+            for (size_t i = 0; i < x.size(); i++) {
+                T xiInv = this->gf.inv(x[i]);
                 T errLocPrime = 1;
 
-                for (int j = 0; j < x.size(); j++)
+                for (size_t j = 0; j < x.size(); j++)
                     if (j != i)
-                        errLocPrime = this->gf.mult(errLocPrime, this->gf.add(1, this->gf.mult(xi, x[j])));
+                        errLocPrime = this->gf.mult(errLocPrime, 1 ^ this->gf.mult(xiInv, x[j]));
 
                 if (errLocPrime == 0)
                     return false;
 
-                T y = this->gf.mult(x[i], Poly_Eval(errEval, xi, this->gf));
-                e.coef[errPos[i]] = this->gf.div(y, errLocPrime);
+                T y = this->gf.mult(x[i], errEval.Eval(xiInv, this->gf));
+                e[i] = this->gf.div(y, errLocPrime);
             }
 
-            Add(msg, msg, e);
+            for (size_t i = 0; i < e.size(); i++)
+                msg[errPos[i]] ^= e[i];
             return true;
         }
 
         /**
-         * @brief Find the error locator polynomial.
+         * @brief Find the error locator polynomial (Berlekamp-Massey).
          * @param out Output polynomial representing the error locator.
          * @param synd Input polynomial containing syndromes.
          * @param nsym Number of symbols in the error-correction code.
-         * @param eraseLoc Array of erasure positions.
+         * @param eraseLoc Erasure locator to start from, or null.
          * @param eraseCount Number of erasures.
          * @return True if the error locator is found, false otherwise.
          */
-        bool findErrorLocator(Poly<T>& out, const Poly<T>& synd, int nsym, const Poly<T>* eraseLoc, int eraseCount) {
-            Poly<T> errLoc(1, 1);
-            Poly<T> oldLoc(1, 1);
-            Poly<T> temp;
+        template <typename P>
+        bool findErrorLocator(P& out, const P& synd, int nsym, const P* eraseLoc, int eraseCount) const {
+            P errLoc(1, 1);
+            P oldLoc(1, 1);
+            P temp;
 
             if (eraseLoc) {
                 errLoc = *eraseLoc;
                 oldLoc = *eraseLoc;
             }
 
-            int syndShift = 0;
-            for (int i = nsym - eraseCount - 1; i >= 0; i--) {
-                int K = i + syndShift + eraseCount;
-                T delta = synd.coef[K];
+            int syndShift = synd.size() > static_cast<size_t>(nsym) ? synd.size() - nsym : 0;
+            for (int i = 0; i < nsym - eraseCount; i++) {
+                int K = i + syndShift + (eraseLoc ? eraseCount : 0);
+                T delta = synd[K];
 
+                // Discrepancy between the syndromes and what the current locator predicts
                 for (size_t j = 1; j < errLoc.size(); j++)
-                    delta ^= this->gf.mult(errLoc.coef[errLoc.size() - j - 1], synd.coef[K + j]);
+                    delta ^= this->gf.mult(errLoc[errLoc.size() - j - 1], synd[K - j]);
 
                 oldLoc.Pad(0, 1);
                 if (delta != 0) {
                     if (oldLoc.size() > errLoc.size()) {
                         temp = oldLoc;
                         temp.Scale(delta, this->gf);
-                        errLoc = temp.Scale(this->gf.inv(delta), this->gf);
-                    } else {
-                        temp = oldLoc;
-                        temp.Scale(delta, this->gf);
-                        errLoc.Add(temp);
+                        oldLoc = errLoc;
+                        oldLoc.Scale(this->gf.inv(delta), this->gf);
+                        errLoc = temp;
                     }
+                    temp = oldLoc;
+                    temp.Scale(delta, this->gf);
+                    errLoc.Add(temp);
                 }
             }
 
-            int leading = 0;
-            for (; errLoc.coef[leading] == 0; leading++);
+            size_t leading = 0;
+            for (; leading + 1 < errLoc.size() && errLoc[leading] == 0; leading++);
             errLoc.Trim(leading, 0);
 
             int errs = errLoc.size() - 1;
             out = errLoc;
-            if (errs * 2 - eraseCount > nsym)
+            int located = eraseLoc ? errs - eraseCount : errs;
+            if (located * 2 + eraseCount > nsym)
                 return false;
 
             return true;
@@ -602,135 +1435,258 @@ template <UnsignedInteger T>class ReedSolomon {
          * @brief Find the positions of errors in the received message.
          * @param out Output vector containing error positions.
          * @param errLoc Input polynomial representing the error locator.
-         * @param n Number of symbols in the error-correction code.
-         * @return True if errors are found, false otherwise.
+         * @param n Number of symbols in the codeword.
+         * @return True if as many errors as the locator's degree were found, false otherwise.
          */
-        bool findErrors(std::vector<unsigned int>& out, const Poly<T> errLoc, int n) {
+        template <typename Positions, typename P>
+        bool findErrors(Positions& out, const P& errLoc, int n) const {
             size_t errs = errLoc.size() - 1;
-            Poly<T> linearEq;
-
-            if (errLoc.size() == 1) {
-                // Do something special here? idk
-            } else if (errLoc.size() == 2) { // Linear equation
-                linearEq = errLoc;
-                out.push_back(this->gf.logTable[this->gf.div(linearEq.coef[0], linearEq.coef[1])]);
-            } else {
-                errLoc.reverse();
-                Poly_ChienSearch(out, errLoc, n, this->gf);
-            }
+            P reversed = errLoc;
+            reversed.reverse();
+            Poly_ChienSearch(out, reversed, n, this->gf);
 
             if (out.size() != errs)
                 return false;
 
             // Map to string pos
-            for (auto& pos : out) {
-                if (pos >= n) // Clearly something messed up
-                    return false;
-
+            for (auto& pos : out)
                 pos = n - pos - 1;
-            }
 
             return true;
         }
 
         /**
-         * @brief Forney algorithm to calculate syndromes at error positions.
+         * @brief Remove the erasures from the syndromes, leaving only the unknown errors.
          * @param synd Input polynomial containing syndromes.
-         * @param pos Vector of error positions.
-         * @param n Number of symbols in the error-correction code.
-         * @return Output polynomial containing syndromes at error positions.
+         * @param pos Vector of erasure positions.
+         * @param n Number of symbols in the codeword.
+         * @return The Forney syndromes (without the leading 0).
          */
-        Poly<T> forneySyndromes(const Poly<T>& synd, const std::vector<unsigned int>& pos, int n) {
-            Poly<T> fsynd = synd;
-            if (!pos.empty()) {
-                for (unsigned int i : pos) {
-                    T rev = static_cast<T>(n) - i - 1;
-                    T x = this->gf.powTable[rev];
-
-                    for (int j = fsynd.size() - 2; j >= 0; j--)
-                        fsynd[j + 1] = this->gf.mult(fsynd[j + 1], x) ^ fsynd[j];
-                }
+        template <typename P, typename Positions>
+        P forneySyndromes(const P& synd, const Positions& pos, int n) const {
+            P fsynd(synd.size() - 1, 0);
+            for (size_t j = 0; j < fsynd.size(); j++)
+                fsynd[j] = synd[j + 1];
+            for (unsigned int i : pos) {
+                T x = static_cast<T>(this->gf.powTable[n - i - 1]);
+                for (size_t j = 0; j + 1 < fsynd.size(); j++)
+                    fsynd[j] = this->gf.mult(fsynd[j], x) ^ fsynd[j + 1];
             }
+            return fsynd;
+        }
+
+        /**
+         * @brief Fill in erased symbols of a codeword that has no other errors.
+         *
+         * With e erasures only the first e syndromes are needed, so the cost is one
+         * O(n * e) pass plus O(e^2) for the erasure locator and Forney's formula,
+         * Y_i = Omega(X_i^-1) / prod_(j != i)(1 + X_j X_i^-1), with X_i^-1 read
+         * straight from the antilog table. Berlekamp-Massey and the Chien search are
+         * skipped, and nothing is allocated for up to 256 erasures. Errors outside the
+         * erased positions go undetected; check the syndromes afterwards if they may occur.
+         * @param codeword Codeword, highest degree first; the erased symbols are overwritten.
+         * @param nsym Number of symbols in the error-correction code.
+         * @param erasePos Erased positions, as indices into codeword.
+         * @return False if there are more than nsym erasures or the positions are invalid.
+         */
+        bool decode_erasures(std::span<T> codeword, int nsym, std::span<const unsigned int> erasePos) const {
+            const size_t n = codeword.size();
+            const size_t e = erasePos.size();
+            const unsigned int order = this->gf.size() - 1;
+            if (e > static_cast<size_t>(nsym) || n > order)
+                return false;
+            if (e == 0)
+                return true;
+
+            // Syndromes, erasure locator Lambda (lowest degree first), evaluator Omega and the locators X_i
+            std::array<T, 4 * 256 + 1> local;
+            std::vector<T> heap(e > 256 ? 4 * e + 1 : 0);
+            T* synd = e > 256 ? heap.data() : local.data();
+            T* lambda = synd + e;
+            T* omega = lambda + e + 1;
+            T* x = omega + e;
+
+            for (unsigned int p : erasePos) {
+                if (p >= n)
+                    return false;
+                codeword[p] = 0;
+            }
+            this->syndromes(codeword, std::span<T>(synd, e));
+
+            // Lambda(x) = prod (1 + X_i x)
+            std::fill(lambda, lambda + e + 1, T{0});
+            lambda[0] = 1;
+            for (size_t i = 0; i < e; ++i) {
+                x[i] = static_cast<T>(this->gf.powTable[n - 1 - erasePos[i]]);
+                for (size_t j = i + 1; j > 0; --j)
+                    lambda[j] ^= this->gf.mult(lambda[j - 1], x[i]);
+            }
+
+            // Omega(x) = S(x) Lambda(x) mod x^e
+            for (size_t m = 0; m < e; ++m) {
+                T sum = 0;
+                for (size_t l = 0; l <= m; ++l)
+                    sum ^= this->gf.mult(synd[l], lambda[m - l]);
+                omega[m] = sum;
+            }
+
+            for (size_t i = 0; i < e; ++i) {
+                const T xInv = static_cast<T>(this->gf.powTable[(order - (n - 1 - erasePos[i])) % order]);
+                T value = 0;
+                for (size_t m = e; m-- > 0;)
+                    value = this->gf.mult(value, xInv) ^ omega[m];
+                T denominator = 1;
+                for (size_t j = 0; j < e; ++j)
+                    if (j != i)
+                        denominator = this->gf.mult(denominator, 1 ^ this->gf.mult(x[j], xInv));
+                if (denominator == 0)
+                    return false;  // repeated position
+                codeword[erasePos[i]] = this->gf.div(value, denominator);
+            }
+            return true;
         }
 
         /**
          * @brief Decode a Reed-Solomon encoded message.
-         * @param wholeOut Output array for the fully decoded message.
+         *
+         * Decoding works in wholeOut when it is given, and in a stack buffer for
+         * codewords of up to 256 symbols otherwise; the intermediate polynomials are
+         * FixedPoly for up to 256 parity symbols. In those cases nothing is allocated.
+         * @param wholeOut Output array for the fully decoded message (may be data); unspecified on failure.
          * @param out Output array for the partially decoded message.
          * @param data Input array containing the received message.
          * @param k Number of symbols in the original message.
          * @param nsym Number of symbols in the error-correction code.
-         * @param erasePos Vector of erasure positions.
+         * @param erasePos Erasure positions.
          * @param debug Enable debug mode.
+         * @param corrected Output number of erasures filled plus errors corrected, or null.
          * @return True if decoding is successful, false otherwise.
          */
-        bool decode(T* wholeOut, T* out, T* data, int k, int nsym, std::vector<unsigned int> erasePos, bool debug) {
-            Poly<T> synd;
-            Poly<T> msg(k + nsym, data);
-
-            if (!erasePos.empty()) {
-                if (erasePos.size() > static_cast<size_t>(nsym)) {
-                    if (debug) std::cout << "Too many erasures to be corrected" << std::endl;
-                    return false;
-                } else {
-                    for (unsigned int i : erasePos)
-                        msg.coef[i] = 0;
-                }
+        bool decode(T* wholeOut, T* out, const T* data, int k, int nsym, std::span<const unsigned int> erasePos, bool debug,
+                    unsigned int* corrected = nullptr) const {
+            const int n = k + nsym;
+            if (corrected)
+                *corrected = 0;
+            if (nsym <= 0 || n >= static_cast<int>(this->gf.size()))
+                return false;
+            if (erasePos.size() > static_cast<size_t>(nsym)) {
+                if (debug) std::cout << "Too many erasures to be corrected" << std::endl;
+                return false;
             }
+            for (unsigned int i : erasePos)
+                if (i >= static_cast<unsigned int>(n))
+                    return false;
 
-            this->calcSyndromes(synd, msg, nsym);
+            std::array<T, 256> local;
+            std::vector<T> heap(!wholeOut && n > 256 ? n : 0);
+            std::span<T> msg = wholeOut ? std::span<T>(wholeOut, n) : n > 256 ? std::span<T>(heap) : std::span<T>(local.data(), n);
+            if (msg.data() != data)
+                std::copy(data, data + n, msg.data());
+
+            bool success;
+            if (nsym <= 32)
+                success = this->decodeWith<FixedPoly<T, 32>, FixedPoly<unsigned int, 32>>(msg, nsym, erasePos, debug, corrected);
+            else if (nsym <= 256)
+                success = this->decodeWith<FixedPoly<T, 256>, FixedPoly<unsigned int, 256>>(msg, nsym, erasePos, debug, corrected);
+            else
+                success = this->decodeWith<Poly<T>, std::vector<unsigned int>>(msg, nsym, erasePos, debug, corrected);
+
+            if (success && out)
+                std::copy(msg.begin(), msg.begin() + k, out);
+            if (!success && corrected)
+                *corrected = 0;
+            return success;
+        }
 
-            if (!this->checkSyndromes(synd)) {
-                if (debug) std::cout << "Errors detected, locating" << std::endl;
-                Poly<T> fsynd, errLoc;
-                this->forneySyndromes(fsynd, synd, erasePos, k + nsym);
-                bool canLocate = this->findErrorLocator(errLoc, fsynd, nsym, nullptr, erasePos.size());
+    private:
+        /**
+         * @brief Decode a codeword in place with the given polynomial and position list types.
+         * @tparam P Poly, or a FixedPoly with room for nsym + 1 coefficients.
+         * @tparam Positions std::vector<unsigned int>, or a FixedPoly of unsigned int with room for nsym positions.
+         * @param msg Received codeword, corrected in place.
+         * @param nsym Number of symbols in the error-correction code.
+         * @param erasePos Erasure positions, already checked to be in range.
+         * @param debug Enable debug mode.
+         * @param corrected Output number of erasures filled plus errors corrected, or null.
+         * @return True if decoding is successful, false otherwise.
+         */
+        template <typename P, typename Positions>
+        bool decodeWith(std::span<T> msg, int nsym, std::span<const unsigned int> erasePos, bool debug, unsigned int* corrected) const {
+            const int n = msg.size();
 
-                if (!canLocate) {
-                    if (debug) std::cout << "Too many errors to locate!" << std::endl;
-                    return false;
-                }
+            // A leading 0 followed by S_0 .. S_(nsym-1)
+            P synd(nsym + 1, 0);
+            std::span<T> s(&synd[1], nsym);
 
-                std::vector<unsigned int> pos;
-                canLocate = this->findErrors(pos, errLoc, k + nsym);
+            // Clean codewords, the common case, need only the syndromes
+            if (erasePos.empty() && this->syndromes(msg, s))
+                return true;
 
-                if (!canLocate || !(pos.size() || !erasePos.empty())) {
-                    if (debug) std::cout << "Errors unable to be located!" << std::endl;
-                    return false;
+            if (!erasePos.empty()) {
+                // Usually the erasures are the only damage: fill them in directly and
+                // keep the result if the codeword checks out
+                if (corrected)
+                    *corrected = erasePos.size();
+                if (this->decode_erasures(msg, nsym, erasePos) && this->syndromes(msg, s)) {
+                    if (debug) std::cout << "Erasures filled" << std::endl;
+                    return true;
                 }
+                for (unsigned int i : erasePos)
+                    msg[i] = 0;
+                if (this->syndromes(msg, s))
+                    return true;
+            }
 
-                if (debug) {
-                    if (!pos.empty()) {
-                        std::cout << "Additional errors detected at ";
-                        for (unsigned int e : pos) {
-                            std::cout << static_cast<int>(e) << ", ";
-                        }
-                    }
+            if (debug) std::cout << "Errors detected, locating" << std::endl;
+            P fsynd = this->forneySyndromes(synd, erasePos, n);
+            P errLoc;
+            bool canLocate = this->findErrorLocator(errLoc, fsynd, nsym, static_cast<const P*>(nullptr), erasePos.size());
 
-                    std::cout << "Correcting" << std::endl;
-                }
+            if (!canLocate) {
+                if (debug) std::cout << "Too many errors to locate!" << std::endl;
+                return false;
+            }
 
-                if (!erasePos.empty())
-                    pos.insert(pos.begin(), erasePos.begin(), erasePos.end());
+            Positions pos;
+            canLocate = this->findErrors(pos, errLoc, n);
 
-                bool success = this->correctErrata(msg, synd, pos);
+            if (!canLocate || !(pos.size() || !erasePos.empty())) {
+                if (debug) std::cout << "Errors unable to be located!" << std::endl;
+                return false;
+            }
 
-                if (!success) {
-                    if (debug) std::cout << "Decode failure!" << std::endl;
-                    return false;
+            if (debug) {
+                if (pos.size()) {
+                    std::cout << "Additional errors detected at ";
+                    for (unsigned int e : pos) {
+                        std::cout << static_cast<int>(e) << ", ";
+                    }
                 }
 
-                if (debug) std::cout << "Errors corrected" << std::endl;
+                std::cout << "Correcting" << std::endl;
             }
 
-            if (wholeOut)
-                std::copy(msg.data(), msg.data() + k + nsym, wholeOut);
+            // Erasures first, then the located errors
+            Positions errata;
+            for (unsigned int i : erasePos)
+                errata.push_back(i);
+            for (unsigned int i : pos)
+                errata.push_back(i);
 
-            if (out)
-                std::copy(msg.data(), msg.data() + k, out);
+            // A miscorrection leaves a codeword that still fails the check
+            if (!this->correctErrata(msg, synd, errata) || !this->syndromes(msg, s)) {
+                if (debug) std::cout << "Decode failure!" << std::endl;
+                return false;
+            }
 
+            if (debug) std::cout << "Errors corrected" << std::endl;
+            if (corrected)
+                *corrected = errata.size();
             return true;
         }
 
+        mutable std::mutex encodersMutex;                               ///< Guards encoders.
+        mutable std::map<int, std::unique_ptr<RSEncoder<T>>> encoders;  ///< Encoders by nsym, built on first use.
 };
 
+#endif // MYRSMODULE_CPP
@@ -6,7 +6,7 @@
 constexpr std::array<unsigned int, 32> primes = {
     0,          // PRIM_0
     0,          // PRIM_1
-    0,          // PRIM_2
+    0x7,        // PRIM_2
     0xb,        // PRIM_3
     0x13,       // PRIM_4
     0x25,       // PRIM_5
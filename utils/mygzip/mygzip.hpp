@@ -5,15 +5,43 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <deque>
+#include <future>
+#include <cstdint>
+#include <cstring>
 #include <zlib.h>
-
+#include "../../include/thread_pool.hpp"
+
+/**
+ * @brief Compresses files to gzip (or BGZF) in parallel and decompresses gzip files.
+ *
+ * Compression splits the input into independent blocks, deflates them on a thread
+ * pool, and writes each one as its own gzip member in input order. Concatenated
+ * members are a valid gzip file, so any gzip reader can decompress the output.
+ */
 class Gzipper {
 public:
-    Gzipper(const std::string& input_file)
+    /**
+     * @brief Output container used when compressing.
+     */
+    enum class Format {
+        Gzip, /**< Concatenated gzip members of BLOCK_SIZE input bytes */
+        Bgzf  /**< Blocked gzip: members of at most 64 KiB with a "BC" size field and an EOF block */
+    };
+
+    /**
+     * @brief Constructor.
+     * @param input_file File to compress, or to decompress if it ends in .gz.
+     * @param format Output container when compressing.
+     * @param threads Number of compression workers; 0 uses one per hardware thread.
+     * @param level zlib compression level.
+     */
+    Gzipper(const std::string& input_file, Format format = Format::Gzip, std::size_t threads = 0, int level = Z_DEFAULT_COMPRESSION)
         : input_file_(input_file),
           output_file_(determine_output_filename()),
-          input_file_stream_(input_file, std::ios::binary),
-          output_file_stream_(output_file_, std::ios::binary | std::ios::trunc) {}
+          format_(format),
+          threads_(threads),
+          level_(level) {}
 
     bool process() {
         std::cerr << "Processing file: " << input_file_ << std::endl;
@@ -21,29 +49,41 @@ public:
     }
 
 private:
-    static const std::size_t BUFFER_SIZE = 1024;
+    static const std::size_t BUFFER_SIZE = 1 << 20;         ///< Stream buffer size for file I/O.
+    static const std::size_t BLOCK_SIZE = 1 << 20;          ///< Input bytes per gzip member.
+    static const std::size_t BGZF_BLOCK_SIZE = 0xff00;      ///< Input bytes per BGZF block; fits 64 KiB even if incompressible.
+    static const std::size_t BGZF_HEADER_SIZE = 18;         ///< gzip header with the 6-byte "BC" extra field.
 
     std::string input_file_;
     std::string output_file_;
+    Format format_;
+    std::size_t threads_;
+    int level_;
     std::ifstream input_file_stream_;
     std::ofstream output_file_stream_;
-    z_stream stream_;
+    std::vector<char> input_stream_buffer_;
+    std::vector<char> output_stream_buffer_;
 
     std::string determine_output_filename() const {
         return is_gz() ? input_file_.substr(0, input_file_.find_last_of(".")) : input_file_ + ".gz";
     }
 
     bool is_gz() const {
-        return input_file_.substr(input_file_.find_last_of(".")) == ".gz";
+        auto dot = input_file_.find_last_of(".");
+        return dot != std::string::npos && input_file_.substr(dot) == ".gz";
     }
 
     bool open_files() {
+        input_stream_buffer_.resize(BUFFER_SIZE);
+        input_file_stream_.rdbuf()->pubsetbuf(input_stream_buffer_.data(), input_stream_buffer_.size());
         input_file_stream_.open(input_file_, std::ios::binary);
         if (!input_file_stream_.is_open()) {
             log_error("Error opening input file: " + input_file_);
             return false;
         }
 
+        output_stream_buffer_.resize(BUFFER_SIZE);
+        output_file_stream_.rdbuf()->pubsetbuf(output_stream_buffer_.data(), output_stream_buffer_.size());
         output_file_stream_.open(output_file_, std::ios::binary | std::ios::trunc);
         if (!output_file_stream_.is_open()) {
             log_error("Error opening output file: " + output_file_);
@@ -53,109 +93,186 @@ private:
         return true;
     }
 
-    int initialize_zlib(int window_bits) {
-        std::cerr << "Initializing zlib with window_bits: " << window_bits << std::endl;
-
-        stream_.zalloc = Z_NULL;
-        stream_.zfree = Z_NULL;
-        stream_.opaque = Z_NULL;
-
-        if (window_bits < 0)
-            window_bits = -window_bits;
-
-        return inflateInit2(&stream_, window_bits) != Z_OK ? Z_ERRNO : Z_OK;
+    void log_error(const std::string& message) {
+        std::cerr << "Error: " << message << std::endl;
     }
 
-    int finalize_processing() {
-        std::cerr << "Finalizing processing..." << std::endl;
+    static void store_le(char* p, std::uint32_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i, v >>= 8)
+            p[i] = static_cast<char>(v & 0xff);
+    }
 
-        return stream_.avail_out == 0 ? (stream_.avail_in == 0 ? Z_OK : Z_BUF_ERROR) : Z_STREAM_END;
+    /**
+     * @brief Deflate one block into a self-contained gzip member.
+     *
+     * Each worker thread keeps one deflate state per window mode and resets it
+     * between blocks instead of reallocating it.
+     * @return The member, or an empty vector on error.
+     */
+    static std::vector<char> compress_block(const std::vector<char>& in, Format format, int level) {
+        struct Deflater {
+            z_stream stream{};
+            bool ok;
+            Deflater(int level, int window_bits)
+                : ok(deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK) {}
+            ~Deflater() { if (ok) deflateEnd(&stream); }
+        };
+        // BGZF writes its own header, so it uses a raw stream; plain gzip lets zlib add the wrapper
+        thread_local Deflater gzip_deflater(level, 16 + MAX_WBITS);
+        thread_local Deflater raw_deflater(level, -MAX_WBITS);
+        Deflater& deflater = (format == Format::Bgzf) ? raw_deflater : gzip_deflater;
+        if (!deflater.ok)
+            return {};
+
+        z_stream& stream = deflater.stream;
+        deflateReset(&stream);
+
+        std::size_t header = (format == Format::Bgzf) ? BGZF_HEADER_SIZE : 0;
+        std::size_t trailer = (format == Format::Bgzf) ? 8 : 0;
+        std::vector<char> out(header + deflateBound(&stream, in.size()) + trailer);
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        stream.avail_in = static_cast<uInt>(in.size());
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + header);
+        stream.avail_out = static_cast<uInt>(out.size() - header - trailer);
+
+        if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+            return {};
+        out.resize(header + stream.total_out + trailer);
+
+        if (format == Format::Bgzf) {
+            static const unsigned char bgzf_header[BGZF_HEADER_SIZE - 2] = {
+                0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0
+            };
+            std::memcpy(out.data(), bgzf_header, sizeof(bgzf_header));
+            store_le(out.data() + 16, static_cast<std::uint32_t>(out.size() - 1), 2);
+            std::uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(in.data()), static_cast<uInt>(in.size()));
+            store_le(out.data() + out.size() - 8, crc, 4);
+            store_le(out.data() + out.size() - 4, static_cast<std::uint32_t>(in.size()), 4);
+        }
+        return out;
     }
 
-    void log_error(const std::string& message) {
-        std::cerr << "Error: " << message << std::endl;
+    bool write_block(const std::vector<char>& block) {
+        if (block.empty()) {
+            log_error("Error processing data with zlib");
+            return false;
+        }
+        output_file_stream_.write(block.data(), block.size());
+        return true;
     }
 
     bool compress() {
-        if (open_files() && initialize_zlib(Z_DEFAULT_COMPRESSION) == Z_OK) {
-            std::vector<char> buffer(BUFFER_SIZE, '\0');
-
-            do {
-                input_file_stream_.read(buffer.data(), buffer.size());
-                stream_.avail_in = static_cast<uInt>(input_file_stream_.gcount());
-                stream_.next_in = reinterpret_cast<Bytef*>(buffer.data());
-
-                int flush = Z_FINISH;
-
-                do {
-                    stream_.avail_out = buffer.size();
-                    stream_.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        if (!open_files()) {
+            log_error("Initialization failed.");
+            return false;
+        }
 
-                    int result = deflate(&stream_, flush);
+        ThreadPool pool(threads_);
+        std::cerr << "Compressing with " << pool.size() << " threads..." << std::endl;
+
+        const std::size_t block_size = (format_ == Format::Bgzf) ? BGZF_BLOCK_SIZE : BLOCK_SIZE;
+        const std::size_t max_pending = 4 * pool.size();
+        std::deque<std::future<std::vector<char>>> pending;
+        std::size_t blocks = 0;
+        bool ok = true;
+
+        // Members are written in input order while later blocks are still compressing
+        auto submit = [&](std::vector<char> block) {
+            pending.push_back(pool.submit([block = std::move(block), format = format_, level = level_] {
+                return compress_block(block, format, level);
+            }));
+        };
+
+        while (ok) {
+            std::vector<char> block(block_size);
+            input_file_stream_.read(block.data(), block.size());
+            block.resize(static_cast<std::size_t>(input_file_stream_.gcount()));
+            if (block.empty())
+                break;
+
+            submit(std::move(block));
+            blocks++;
+            while (pending.size() >= max_pending) {
+                ok &= write_block(pending.front().get());
+                pending.pop_front();
+            }
+        }
 
-                    if (result == Z_STREAM_ERROR) {
-                        log_error("Error processing data with zlib");
-                        return false;
-                    }
+        // BGZF readers expect an empty block as the end-of-file marker, and an empty
+        // input still needs one member to be a valid gzip file
+        if (format_ == Format::Bgzf || blocks == 0)
+            submit({});
 
-                    output_file_stream_.write(buffer.data(), buffer.size() - stream_.avail_out);
-                } while (stream_.avail_out == 0);
-            } while (input_file_stream_);
+        for (auto& block : pending)
+            ok &= write_block(block.get());
 
-            int deflateEndResult = deflateEnd(&stream_);
-            if (deflateEndResult == Z_OK) {
-                std::cerr << "Compression successful." << std::endl;
-                return true;
-            } else {
-                log_error("deflateEnd failed: " + std::string(zError(deflateEndResult)));
-            }
-        } else {
-            log_error("Initialization failed.");
+        output_file_stream_.flush();
+        if (!ok || !output_file_stream_) {
+            log_error("Compression failed: " + output_file_);
+            return false;
         }
-        return false;
+        std::cerr << "Compression successful." << std::endl;
+        return true;
     }
 
     bool decompress() {
         std::cerr << "Decompression..." << std::endl;
 
-        if (open_files() && initialize_zlib(-MAX_WBITS) == Z_OK) {
-            std::vector<char> buffer(BUFFER_SIZE, '\0');
-
-            do {
-                input_file_stream_.read(buffer.data(), buffer.size());
-                stream_.avail_in = static_cast<uInt>(input_file_stream_.gcount());
-                stream_.next_in = reinterpret_cast<Bytef*>(buffer.data());
-
-                int flush = Z_FINISH;
-
-                do {
-                    stream_.avail_out = buffer.size();
-                    stream_.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        z_stream stream{};
+        if (!open_files() || inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            log_error("Initialization failed.");
+            return false;
+        }
 
-                    int result = inflate(&stream_, flush);
+        std::vector<char> in(BUFFER_SIZE), out(BUFFER_SIZE);
+        bool in_member = false;
+        bool ok = true;
 
-                    if (result == Z_STREAM_ERROR) {
-                        log_error("Error processing data with zlib");
-                        return false;
-                    }
+        while (ok) {
+            input_file_stream_.read(in.data(), in.size());
+            stream.avail_in = static_cast<uInt>(input_file_stream_.gcount());
+            stream.next_in = reinterpret_cast<Bytef*>(in.data());
+            if (stream.avail_in == 0)
+                break;
 
-                    output_file_stream_.write(buffer.data(), buffer.size() - stream_.avail_out);
-                } while (stream_.avail_out == 0);
-            } while (input_file_stream_);
+            do {
+                stream.avail_out = static_cast<uInt>(out.size());
+                stream.next_out = reinterpret_cast<Bytef*>(out.data());
+
+                if (stream.avail_in > 0)
+                    in_member = true;
+                int result = inflate(&stream, Z_NO_FLUSH);
+                if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                    log_error("Error processing data with zlib: " + std::string(zError(result)));
+                    ok = false;
+                    break;
+                }
+
+                output_file_stream_.write(out.data(), out.size() - stream.avail_out);
+
+                // Concatenated members (as written by compress()) follow one another
+                if (result == Z_STREAM_END) {
+                    in_member = false;
+                    inflateReset(&stream);
+                }
+            } while (stream.avail_in > 0 || stream.avail_out == 0);
+        }
 
-            int inflateEndResult = inflateEnd(&stream_);
-            if (inflateEndResult == Z_OK) {
-                std::cerr << "Decompression successful." << std::endl;
-                return true;
-            } else {
-                log_error("inflateEnd failed: " + std::string(zError(inflateEndResult)));
-            }
-        } else {
-            log_error("Initialization failed.");
+        inflateEnd(&stream);
+        output_file_stream_.flush();
+        if (ok && !output_file_stream_) {
+            log_error("Error writing output file: " + output_file_);
+            ok = false;
         }
-        return false;
+        if (ok && in_member) {
+            log_error("Unexpected end of compressed input: " + input_file_);
+            ok = false;
+        }
+        if (ok)
+            std::cerr << "Decompression successful." << std::endl;
+        return ok;
     }
 };
 
 #endif  // MYGZIP_HPP
-
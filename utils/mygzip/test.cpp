@@ -1,37 +1,50 @@
+#include <random>
 #include "mygzip.hpp"
 
-int main() {
-    // Test string
-    std::string testString = "Hello, this is a test string for gzip compression and decompression.";
-
-    // Compress
-    Gzipper compressor("test_string.txt");
-    std::ofstream testFile("test_string.txt");
-    testFile << testString;
+// Compress with the given format, decompress, and compare against the original
+bool round_trip(const std::string& filename, const std::string& content, Gzipper::Format format) {
+    std::ofstream testFile(filename, std::ios::binary);
+    testFile << content;
     testFile.close();
 
-    if (compressor.process()) {
-        std::cout << "Compression successful." << std::endl;
-    } else {
+    Gzipper compressor(filename, format);
+    if (!compressor.process()) {
         std::cerr << "Compression failed. Check the error messages above for details." << std::endl;
-        return 1;
+        return false;
     }
 
-    // Decompress
-    Gzipper decompressor("test_string.txt.gz");
-    if (decompressor.process()) {
-        std::cout << "Decompression successful." << std::endl;
-    } else {
+    Gzipper decompressor(filename + ".gz");
+    if (!decompressor.process()) {
         std::cerr << "Decompression failed. Check the error messages above for details." << std::endl;
-        return 1;
+        return false;
     }
 
-    // Read and print the decompressed file content
-    std::ifstream decompressedFile("test_string.txt");
+    std::ifstream decompressedFile(filename, std::ios::binary);
     std::string decompressedString((std::istreambuf_iterator<char>(decompressedFile)),
                                    std::istreambuf_iterator<char>());
-    std::cout << "Decompressed content: " << decompressedString << std::endl;
-
-    return 0;
+    return decompressedString == content;
 }
 
+int main() {
+    // Test string
+    std::string testString = "Hello, this is a test string for gzip compression and decompression.";
+
+    // Several blocks of nucleotides, so members are compressed in parallel
+    std::mt19937 generator(42);
+    std::string oligos;
+    for (int i = 0; i < (3 << 20); i++)
+        oligos += "ACGT"[generator() % 4];
+
+    bool ok = true;
+    for (auto format : { Gzipper::Format::Gzip, Gzipper::Format::Bgzf }) {
+        const char* name = (format == Gzipper::Format::Gzip) ? "gzip" : "bgzf";
+        for (const auto& content : { testString, oligos, std::string() }) {
+            bool passed = round_trip("test_string.txt", content, format);
+            std::cout << name << " round trip of " << content.size() << " bytes "
+                      << (passed ? "successful." : "failed.") << std::endl;
+            ok &= passed;
+        }
+    }
+
+    return ok ? 0 : 1;
+}